@@ -0,0 +1,828 @@
+﻿#include "benchmarks.h"
+#include "math3d.h"
+#include "mesh_generators.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "mip_builder.h"
+#include "obj_importer.h"
+#include "procedural_texture.h"
+#include "scene_graph.h"
+#include "thread_pool.h"
+#include "vertex_format.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Результат каждого прогона складывается сюда, чтобы компилятор не выбросил вычисления
+static volatile float benchmarkSink = 0.0f;
+
+// Прогоняет body(iterations) и печатает время на одну операцию
+template <typename Body>
+static double measure(const char* label, int iterations, int operationsPerIteration, Body body) {
+    body(iterations / 10 + 1);  // Прогрев кэшей и предсказателя переходов
+
+    auto start = chrono::steady_clock::now();
+    body(iterations);
+    auto end = chrono::steady_clock::now();
+
+    double totalNs = chrono::duration<double, nano>(end - start).count();
+    double nsPerOp = totalNs / ((double)iterations * operationsPerIteration);
+    cout << "  " << label << ": " << nsPerOp << " ns/op" << endl;
+    return nsPerOp;
+}
+
+// Сумма всех элементов: результат используется целиком, как при загрузке в uniform
+static inline float consume(const float* m) {
+    float sum = 0.0f;
+    for (int i = 0; i < 16; i++) sum += m[i];
+    return sum;
+}
+
+static void printSpeedup(double scalarNs, double simdNs) {
+    cout << "  speedup: " << scalarNs / simdNs << "x" << endl;
+}
+
+// ==================== Математика: прежний скалярный код ====================
+// Копия построения матрицы модели тетраэдра из render() до перехода на Mat4
+static void legacyTetraModel(float rotation, float x, float y, float z, float model[16]) {
+    memset(model, 0, 16 * sizeof(float));
+    model[0] = 1.0f; model[5] = 1.0f; model[10] = 1.0f; model[15] = 1.0f;
+    model[12] = x;
+    model[13] = y;
+    model[14] = z;
+
+    float angle = rotation * 3.14159f / 180.0f;
+    float cosA = cos(angle);
+    float sinA = sin(angle);
+    model[0] = cosA;
+    model[2] = sinA;
+    model[8] = -sinA;
+    model[10] = cosA;
+
+    float tiltAngle = 45.0f * 3.14159f / 180.0f;
+    float cosTilt = cos(tiltAngle);
+    float sinTilt = sin(tiltAngle);
+
+    float temp = model[1];
+    model[1] = model[1] * cosTilt - model[2] * sinTilt;
+    model[2] = temp * sinTilt + model[2] * cosTilt;
+
+    temp = model[5];
+    model[5] = model[5] * cosTilt - model[6] * sinTilt;
+    model[6] = temp * sinTilt + model[6] * cosTilt;
+
+    temp = model[9];
+    model[9] = model[9] * cosTilt - model[10] * sinTilt;
+    model[10] = temp * sinTilt + model[10] * cosTilt;
+}
+
+static void scalarMultiply(const float a[16], const float b[16], float out[16]) {
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a[k * 4 + row] * b[col * 4 + k];
+            }
+            out[col * 4 + row] = sum;
+        }
+    }
+}
+
+static void benchmarkMath() {
+    cout << "=== Math: Mat4/Vec4 vs scalar float[16] ===" << endl;
+#if defined(MATH3D_AVX)
+    cout << "  backend: AVX" << endl;
+#elif defined(MATH3D_SSE)
+    cout << "  backend: SSE" << endl;
+#else
+    cout << "  backend: scalar" << endl;
+#endif
+
+    // 1. Матрица модели тетраэдра
+    cout << "Tetrahedron model matrix:" << endl;
+    double scalarNs = measure("legacy float[16] + cos/sin", 2000000, 1, [](int n) {
+        float model[16];
+        float sum = 0.0f;
+        for (int i = 0; i < n; i++) {
+            legacyTetraModel((float)i, 0.1f, 0.2f, -3.0f, model);
+            sum += consume(model);
+        }
+        benchmarkSink = sum;
+    });
+    const Mat4 tilt = Mat4::rotationX(radians(45.0f));
+    double simdNs = measure("composeTranslateRotateY", 2000000, 1, [&tilt](int n) {
+        float sum = 0.0f;
+        for (int i = 0; i < n; i++) {
+            float angle = radians((float)i);
+            Mat4 model = composeTranslateRotateY(Vec4(0.1f, 0.2f, -3.0f, 1.0f), tilt, cos(angle), -sin(angle));
+            sum += consume(model.m);
+        }
+        benchmarkSink = sum;
+    });
+    printSpeedup(scalarNs, simdNs);
+
+    // 2. Цепочка произведений: каждый результат - левый множитель следующего.
+    // b - чистый поворот, поэтому значения не растут
+    cout << "Chained 4x4 multiply:" << endl;
+    Mat4 a = Mat4::rotationX(0.3f) * Mat4::translation(1.0f, 2.0f, 3.0f);
+    Mat4 b = Mat4::rotationY(0.7f) * Mat4::rotationZ(0.2f);
+    scalarNs = measure("scalar", 5000000, 1, [&](int n) {
+        float lhs[16], out[16];
+        memcpy(lhs, a.m, sizeof(lhs));
+        for (int i = 0; i < n; i++) {
+            scalarMultiply(lhs, b.m, out);
+            memcpy(lhs, out, sizeof(lhs));
+        }
+        benchmarkSink = consume(lhs);
+    });
+    simdNs = measure("Mat4 operator*", 5000000, 1, [&](int n) {
+        Mat4 lhs = a;
+        for (int i = 0; i < n; i++) {
+            lhs = lhs * b;
+        }
+        benchmarkSink = consume(lhs.m);
+    });
+    printSpeedup(scalarNs, simdNs);
+
+    // 3. Пакет: projection * view * model для тысяч объектов
+    const size_t count = 10000;
+    cout << "Batch viewProjection * model (" << count << " matrices):" << endl;
+    vector<Mat4> models(count), results(count);
+    for (size_t i = 0; i < count; i++) {
+        models[i] = Mat4::translation((float)i, 0.0f, -5.0f) * Mat4::rotationY((float)i * 0.01f);
+    }
+    Mat4 viewProjection = Mat4::rotationX(0.1f) * Mat4::translation(0.0f, 0.0f, -3.0f);
+    scalarNs = measure("scalar loop", 200, (int)count, [&](int n) {
+        for (int it = 0; it < n; it++) {
+            for (size_t i = 0; i < count; i++) {
+                scalarMultiply(viewProjection.m, models[i].m, results[i].m);
+            }
+            benchmarkSink = benchmarkSink + results[it % count].m[0];
+        }
+    });
+    simdNs = measure("multiplyMat4Batch", 200, (int)count, [&](int n) {
+        for (int it = 0; it < n; it++) {
+            multiplyMat4Batch(viewProjection, models.data(), results.data(), count);
+            benchmarkSink = benchmarkSink + results[it % count].m[0];
+        }
+    });
+    printSpeedup(scalarNs, simdNs);
+
+    // Пакетное ядро должно давать тот же результат, что и скалярное
+    float maxError = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        float expected[16];
+        scalarMultiply(viewProjection.m, models[i].m, expected);
+        for (int k = 0; k < 16; k++) {
+            maxError = max(maxError, fabs(expected[k] - results[i].m[k]));
+        }
+    }
+    cout << "  max abs error vs scalar: " << maxError << endl;
+
+    // 4. Пакет: преобразование вершин
+    const size_t vertexCount = 100000;
+    cout << "Batch vertex transform (" << vertexCount << " vertices):" << endl;
+    vector<Vec4> points(vertexCount), transformed(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        points[i] = Vec4((float)i, (float)(i % 7), (float)(i % 13), 1.0f);
+    }
+    scalarNs = measure("scalar loop", 50, (int)vertexCount, [&](int n) {
+        const float* m = viewProjection.m;
+        for (int it = 0; it < n; it++) {
+            for (size_t i = 0; i < vertexCount; i++) {
+                const Vec4& v = points[i];
+                float* r = transformed[i].data();
+                for (int row = 0; row < 4; row++) {
+                    r[row] = m[row] * v.x + m[4 + row] * v.y + m[8 + row] * v.z + m[12 + row] * v.w;
+                }
+            }
+            benchmarkSink = benchmarkSink + transformed[it % vertexCount].x;
+        }
+    });
+    simdNs = measure("transformVec4Batch", 50, (int)vertexCount, [&](int n) {
+        for (int it = 0; it < n; it++) {
+            transformVec4Batch(viewProjection, points.data(), transformed.data(), vertexCount);
+            benchmarkSink = benchmarkSink + transformed[it % vertexCount].x;
+        }
+    });
+    printSpeedup(scalarNs, simdNs);
+}
+
+// ==================== Процедурные текстуры: прежние циклы ====================
+// Копии createWaterTexture()/createWoodTexture() до перехода на procedural_texture.cpp;
+// размер вынесен в параметр, координаты масштабируются к эталонным 256x256, как в новом генераторе
+static unsigned char* legacyWaterTexture(int size) {
+    unsigned char* image = new unsigned char[size * size * 3];
+    float scale = 256.0f / size;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            int index = (i * size + j) * 3;
+            float wave = sin(i * scale * 0.05f + j * scale * 0.02f) * 0.2f + 0.5f;
+            image[index] = 100 + (unsigned char)(wave * 50);
+            image[index + 1] = 200 + (unsigned char)(wave * 50);
+            image[index + 2] = 150 + (unsigned char)(wave * 100);
+        }
+    }
+    return image;
+}
+
+static unsigned char* legacyWoodTexture(int size) {
+    unsigned char* image = new unsigned char[size * size * 3];
+    float scale = 256.0f / size;
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            int index = (i * size + j) * 3;
+            float y = i * scale, x = j * scale;
+            float grain = sin(y * 0.1f) * 0.3f + 0.7f;
+            float rings = sin(sqrt((y - 128) * (y - 128) + (x - 128) * (x - 128)) * 0.05f) * 0.2f + 0.5f;
+            float pattern = (grain + rings) * 0.5f;
+            image[index] = (unsigned char)(139 * pattern);
+            image[index + 1] = (unsigned char)(69 * pattern);
+            image[index + 2] = (unsigned char)(19 * pattern);
+        }
+    }
+    return image;
+}
+
+// Наибольшее расхождение в канале и доля отличающихся байтов
+static void compareWithLegacy(const unsigned char* legacy, const TextureImage& image) {
+    size_t size = image.pixels.size();
+    int maxDiff = 0;
+    size_t differing = 0;
+    for (size_t i = 0; i < size; i++) {
+        int diff = abs((int)legacy[i] - (int)image.pixels[i]);
+        maxDiff = max(maxDiff, diff);
+        differing += diff != 0;
+    }
+    cout << "  vs legacy: max channel diff " << maxDiff << ", "
+        << 100.0 * differing / size << "% bytes differ" << endl;
+}
+
+static void benchmarkTextures() {
+    cout << "=== Procedural textures: SIMD + threads vs legacy scalar loops ===" << endl;
+    ThreadPool& pool = sharedThreadPool();
+    ThreadPool singleThread(0);
+    cout << "  threads: " << pool.threadCount() << endl;
+
+    const int sizes[] = { 256, 1024, 4096 };
+    for (int size : sizes) {
+        int texels = size * size;
+        int iterations = max(1, (1 << 22) / texels);
+        cout << "Water + wood " << size << "x" << size << ":" << endl;
+
+        double legacyNs = measure("legacy scalar", iterations, texels * 2, [&](int n) {
+            for (int it = 0; it < n; it++) {
+                unsigned char* water = legacyWaterTexture(size);
+                unsigned char* wood = legacyWoodTexture(size);
+                benchmarkSink = benchmarkSink + water[it % texels] + wood[it % texels];
+                delete[] water;
+                delete[] wood;
+            }
+        });
+        TextureImage water, wood;
+        double simdNs = measure("SIMD, 1 thread", iterations, texels * 2, [&](int n) {
+            for (int it = 0; it < n; it++) {
+                generateProceduralTexture(PATTERN_WATER, size, size, water, singleThread);
+                generateProceduralTexture(PATTERN_WOOD, size, size, wood, singleThread);
+                benchmarkSink = benchmarkSink + water.pixels[it % texels] + wood.pixels[it % texels];
+            }
+        });
+        printSpeedup(legacyNs, simdNs);
+        double parallelNs = measure("SIMD, thread pool", iterations, texels * 2, [&](int n) {
+            for (int it = 0; it < n; it++) {
+                generateProceduralTexture(PATTERN_WATER, size, size, water, pool);
+                generateProceduralTexture(PATTERN_WOOD, size, size, wood, pool);
+                benchmarkSink = benchmarkSink + water.pixels[it % texels] + wood.pixels[it % texels];
+            }
+        });
+        printSpeedup(legacyNs, parallelNs);
+
+        // Полиномиальный синус может сдвинуть округление на единицу
+        unsigned char* legacyWater = legacyWaterTexture(size);
+        unsigned char* legacyWood = legacyWoodTexture(size);
+        compareWithLegacy(legacyWater, water);
+        compareWithLegacy(legacyWood, wood);
+        delete[] legacyWater;
+        delete[] legacyWood;
+    }
+
+    // Все узоры в максимальном размере: время одной генерации
+    const int maxSize = MAX_PROCEDURAL_TEXTURE_SIZE;
+    cout << "All patterns " << maxSize << "x" << maxSize << ", thread pool:" << endl;
+    TextureImage image;
+    for (int pattern = 0; pattern < PATTERN_COUNT; pattern++) {
+        auto start = chrono::steady_clock::now();
+        generateProceduralTexture((ProceduralPattern)pattern, maxSize, maxSize, image, pool);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "  " << proceduralPatternName((ProceduralPattern)pattern) << ": " << ms << " ms, "
+            << (double)maxSize * maxSize / (ms * 1000.0) << " Mtexels/s" << endl;
+    }
+}
+
+// ==================== Мипмапы ====================
+// Прежний способ: усреднение 2x2 прямо в гамма-пространстве, по уровню за раз
+static void naiveBoxMips(const TextureImage& base, vector<TextureImage>& mips) {
+    mips.clear();
+    const TextureImage* source = &base;
+    while (source->width > 1 || source->height > 1) {
+        TextureImage target;
+        target.width = max(1, source->width / 2);
+        target.height = max(1, source->height / 2);
+        target.pixels.resize((size_t)target.width * target.height * 3);
+        for (int y = 0; y < target.height; y++) {
+            for (int x = 0; x < target.width; x++) {
+                int x0 = min(x * 2, source->width - 1), x1 = min(x * 2 + 1, source->width - 1);
+                int y0 = min(y * 2, source->height - 1), y1 = min(y * 2 + 1, source->height - 1);
+                for (int c = 0; c < 3; c++) {
+                    int sum = source->pixels[((size_t)y0 * source->width + x0) * 3 + c] +
+                        source->pixels[((size_t)y0 * source->width + x1) * 3 + c] +
+                        source->pixels[((size_t)y1 * source->width + x0) * 3 + c] +
+                        source->pixels[((size_t)y1 * source->width + x1) * 3 + c];
+                    target.pixels[((size_t)y * target.width + x) * 3 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        mips.push_back(move(target));
+        source = &mips.back();
+    }
+}
+
+static void benchmarkMips() {
+    cout << "=== Mip chains: sRGB-correct box/Kaiser vs naive gamma-space box ===" << endl;
+    ThreadPool& pool = sharedThreadPool();
+    ThreadPool singleThread(0);
+    cout << "  threads: " << pool.threadCount() << endl;
+
+    const int sizes[] = { 256, 1024, 2048 };
+    for (int size : sizes) {
+        TextureImage base;
+        generateProceduralTexture(PATTERN_MARBLE, size, size, base, pool);
+        int texels = size * size;
+        int iterations = max(1, (1 << 20) / texels);
+        vector<TextureImage> mips;
+        cout << "Marble " << size << "x" << size << " (" << mipLevelCount(size, size) << " levels):" << endl;
+
+        double naiveNs = measure("naive box, gamma space", iterations, texels, [&](int n) {
+            for (int it = 0; it < n; it++) {
+                naiveBoxMips(base, mips);
+                benchmarkSink = benchmarkSink + mips.back().pixels[0];
+            }
+        });
+        for (int filter = MIP_FILTER_BOX; filter <= MIP_FILTER_KAISER; filter++) {
+            string label = string(mipFilterName((MipFilter)filter)) + ", 1 thread";
+            double singleNs = measure(label.c_str(), iterations, texels, [&](int n) {
+                for (int it = 0; it < n; it++) {
+                    buildMipChain(base, mips, (MipFilter)filter, true, singleThread);
+                    benchmarkSink = benchmarkSink + mips.back().pixels[0];
+                }
+            });
+            printSpeedup(naiveNs, singleNs);
+            label = string(mipFilterName((MipFilter)filter)) + ", thread pool";
+            double parallelNs = measure(label.c_str(), iterations, texels, [&](int n) {
+                for (int it = 0; it < n; it++) {
+                    buildMipChain(base, mips, (MipFilter)filter, true, pool);
+                    benchmarkSink = benchmarkSink + mips.back().pixels[0];
+                }
+            });
+            printSpeedup(naiveNs, parallelNs);
+        }
+    }
+}
+
+// ==================== Упаковка вершин ====================
+// Сетка side x side вершин с рельефом, цветом по высоте и UV на всю сетку - как большой импортированный меш
+static void buildTerrainMesh(int side, vector<float>& vertices, vector<unsigned int>& indices) {
+    vertices.resize((size_t)side * side * 8);
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            float u = (float)x / (side - 1), v = (float)z / (side - 1);
+            float height = 0.2f * sin(u * 12.0f) * cos(v * 9.0f);
+            float* vertex = &vertices[((size_t)z * side + x) * 8];
+            vertex[0] = u * 200.0f - 100.0f;  // Координаты в метрах, далеко от [-1, 1]
+            vertex[1] = height * 50.0f;
+            vertex[2] = v * 200.0f - 100.0f;
+            vertex[3] = 0.5f + height;
+            vertex[4] = 0.6f;
+            vertex[5] = 0.5f - height;
+            vertex[6] = u;
+            vertex[7] = v;
+        }
+    }
+    indices.clear();
+    indices.reserve((size_t)(side - 1) * (side - 1) * 6);
+    for (int z = 0; z + 1 < side; z++) {
+        for (int x = 0; x + 1 < side; x++) {
+            unsigned int i = z * side + x;
+            unsigned int quad[6] = { i, i + side, i + 1, i + 1, i + side, i + side + 1 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// Наибольшая ошибка восстановленной позиции относительно размера меша
+static float maxPositionError(const vector<float>& vertices, const PackedMesh& mesh) {
+    float worst = 0.0f;
+    int stride = vertexStride(mesh.format);
+    for (int v = 0; v < mesh.vertexCount; v++) {
+        const int16_t* q = (const int16_t*)&mesh.vertices[(size_t)v * stride];
+        Vec4 local(max(q[0] / 32767.0f, -1.0f), max(q[1] / 32767.0f, -1.0f), max(q[2] / 32767.0f, -1.0f), 1.0f);
+        Vec4 restored = mesh.dequantize * local;
+        const float* original = &vertices[(size_t)v * 8];
+        worst = max(worst, max(fabs(restored.x - original[0]), max(fabs(restored.y - original[1]),
+            fabs(restored.z - original[2]))));
+    }
+    return worst;
+}
+
+static void benchmarkVertexFormats() {
+    cout << "=== Vertex packing: SNORM16/RGBA8/UNORM16 + 16-bit indices vs float + 32-bit ===" << endl;
+    const int sides[] = { 256, 1024 };
+    for (int side : sides) {
+        vector<float> vertices;
+        vector<unsigned int> indices;
+        buildTerrainMesh(side, vertices, indices);
+        int vertexCount = side * side;
+        int indexCount = (int)indices.size();
+        cout << "Terrain " << side << "x" << side << ": " << vertexCount << " vertices, "
+            << indexCount / 3 << " triangles" << endl;
+
+        PackedMesh mesh;
+        double nsPerVertex = measure("pack", max(1, (1 << 22) / vertexCount), vertexCount, [&](int n) {
+            for (int it = 0; it < n; it++) {
+                packMesh(vertices.data(), vertexCount, 8, indices.data(), indexCount, true, mesh);
+                benchmarkSink = benchmarkSink + mesh.vertices[it % mesh.vertices.size()];
+            }
+        });
+        cout << "  " << 1e3 / nsPerVertex << " M vertices/s" << endl;
+
+        size_t unpacked = unpackedMeshSize(vertexCount, 8, indexCount);
+        cout << "  format: " << vertexFormatName(mesh.format) << ", "
+            << (mesh.indexType == GL_UNSIGNED_SHORT ? "16-bit" : "32-bit") << " indices" << endl;
+        cout << "  memory: " << unpacked / 1024 << " KB -> " << mesh.size() / 1024 << " KB ("
+            << 100.0 * mesh.size() / unpacked << "%)" << endl;
+        // Одна отрисовка читает каждую вершину хотя бы раз и все индексы
+        cout << "  fetch per frame: vertices " << vertexStride(VERTEX_FLOAT_COLOR_UV) << " -> " << vertexStride(mesh.format)
+            << " B each, indices " << indexCount * 4 / 1024 << " -> " << mesh.indices.size() / 1024 << " KB" << endl;
+        cout << "  max position error: " << maxPositionError(vertices, mesh) << " m over a 200 m mesh" << endl;
+    }
+}
+
+// ==================== Процедурные меши ====================
+// Копия прежнего buildCircleMesh(): cos/sin и push_back без reserve
+static void legacyCircleMesh(int segments, vector<float>& vertices, vector<unsigned int>& indices) {
+    vertices.clear();
+    indices.clear();
+
+    vertices.push_back(0.0f); vertices.push_back(0.0f); vertices.push_back(0.0f);
+    vertices.push_back(1.0f); vertices.push_back(1.0f); vertices.push_back(1.0f);
+
+    for (int i = 0; i <= segments; i++) {
+        float angle = 2.0f * 3.14159f * i / segments;
+        float x = cos(angle);
+        float y = sin(angle);
+
+        float hue = angle / (2.0f * 3.14159f);
+        float h = hue * 6.0f;
+        int sector = static_cast<int>(h);
+        float fraction = h - sector;
+        float r = 0, g = 0, b = 0;
+
+        switch (sector % 6) {
+        case 0: r = 1; g = fraction; b = 0; break;
+        case 1: r = 1 - fraction; g = 1; b = 0; break;
+        case 2: r = 0; g = 1; b = fraction; break;
+        case 3: r = 0; g = 1 - fraction; b = 1; break;
+        case 4: r = fraction; g = 0; b = 1; break;
+        case 5: r = 1; g = 0; b = 1 - fraction; break;
+        }
+
+        vertices.push_back(x); vertices.push_back(y); vertices.push_back(0.0f);
+        vertices.push_back(r); vertices.push_back(g); vertices.push_back(b);
+    }
+
+    for (int i = 1; i <= segments; i++) {
+        indices.push_back(0);
+        indices.push_back(i);
+        indices.push_back(i + 1);
+    }
+    indices[indices.size() - 1] = 1;
+}
+
+// Сколько вершин в секунду дает генератор, заполняющий заранее выделенную память
+template <typename Generate>
+static void measureGenerator(const char* label, MeshSize size, Generate generate) {
+    vector<float> vertices((size_t)size.vertexCount * 8);
+    vector<unsigned int> indices(size.indexCount);
+    double ns = measure(label, max(1, (1 << 22) / size.vertexCount), size.vertexCount, [&](int n) {
+        for (int it = 0; it < n; it++) {
+            generate(vertices.data(), indices.data());
+            benchmarkSink = benchmarkSink + vertices[it % vertices.size()];
+        }
+    });
+    cout << "  " << 1e3 / ns << " M vertices/s" << endl;
+}
+
+static void benchmarkMeshGenerators() {
+    cout << "=== Mesh generators: constexpr trig/HSV into preallocated storage vs push_back ===" << endl;
+    const int segmentCounts[] = { 64, 4096 };
+    for (int segments : segmentCounts) {
+        cout << "Circle, " << segments << " segments" << endl;
+        vector<float> legacyVertices;
+        vector<unsigned int> legacyIndices;
+        double legacyNs = measure("legacy push_back", max(1, (1 << 22) / segments), segments, [&](int n) {
+            for (int it = 0; it < n; it++) {
+                legacyCircleMesh(segments, legacyVertices, legacyIndices);
+                benchmarkSink = benchmarkSink + legacyVertices[it % legacyVertices.size()];
+            }
+        });
+
+        MeshSize size = circleMeshSize(segments);
+        vector<float> vertices((size_t)size.vertexCount * 6);
+        vector<unsigned int> indices(size.indexCount);
+        double generatorNs = measure("generateCircle", max(1, (1 << 22) / segments), segments, [&](int n) {
+            for (int it = 0; it < n; it++) {
+                generateCircle(segments, vertices.data(), indices.data());
+                benchmarkSink = benchmarkSink + vertices[it % vertices.size()];
+            }
+        });
+        printSpeedup(legacyNs, generatorNs);
+
+        // Прежний круг: та же вершина i (последняя лишняя не используется), тот же цвет
+        float worst = 0.0f;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            worst = max(worst, fabs(vertices[i] - legacyVertices[i]));
+        }
+        cout << "  max difference from legacy mesh: " << worst << endl;
+    }
+
+    // Таблица, посчитанная компилятором, совпадает с генерацией во время работы
+    constexpr auto compiled = makeSphereMesh<8, 16>(1.0f);
+    vector<float> runtime(compiled.vertexCount * 8);
+    vector<unsigned int> runtimeIndices(compiled.indexCount);
+    generateSphere(1.0f, 8, 16, runtime.data(), runtimeIndices.data());
+    bool same = equal(runtime.begin(), runtime.end(), compiled.vertices)
+        && equal(runtimeIndices.begin(), runtimeIndices.end(), compiled.indices);
+    cout << "Sphere 8x16: constexpr table " << (same ? "matches" : "DIFFERS FROM") << " runtime generation" << endl;
+
+    cout << "Sphere 256x512" << endl;
+    measureGenerator("generateSphere", sphereMeshSize(256, 512), [](float* v, unsigned int* i) {
+        generateSphere(1.0f, 256, 512, v, i);
+    });
+    cout << "Torus 512x256" << endl;
+    measureGenerator("generateTorus", torusMeshSize(512, 256), [](float* v, unsigned int* i) {
+        generateTorus(1.0f, 0.3f, 512, 256, v, i);
+    });
+}
+
+// ==================== Импорт OBJ ====================
+// OBJ-текст тора с UV и нормалями: четырехугольные грани, как у типичных экспортеров
+static string buildTorusObj(int rings, int sides) {
+    MeshSize size = torusMeshSize(rings, sides);
+    vector<float> vertices((size_t)size.vertexCount * 8);
+    vector<unsigned int> indices(size.indexCount);
+    generateTorus(1.0f, 0.3f, rings, sides, vertices.data(), indices.data());
+
+    string text;
+    text.reserve((size_t)size.vertexCount * 100 + (size_t)rings * sides * 40);
+    char line[192];
+    for (int v = 0; v < size.vertexCount; v++) {
+        const float* vertex = &vertices[(size_t)v * 8];
+        // Нормаль тора - направление от окружности большого радиуса
+        float ringLength = sqrt(vertex[0] * vertex[0] + vertex[2] * vertex[2]);
+        float nx = vertex[0] - vertex[0] / ringLength, nz = vertex[2] - vertex[2] / ringLength;
+        snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+            vertex[0], vertex[1], vertex[2], vertex[6], vertex[7], nx / 0.3f, vertex[1] / 0.3f, nz / 0.3f);
+        text += line;
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < sides; s++) {
+            int a = r * (sides + 1) + s + 1, b = a + sides + 1;
+            snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                a, a, a, a + 1, a + 1, a + 1, b + 1, b + 1, b + 1, b, b, b);
+            text += line;
+        }
+    }
+    return text;
+}
+
+static void benchmarkObjImport() {
+    cout << "=== OBJ import: chunked parallel parse, per-position dedupe, direct packed write ===" << endl;
+    ThreadPool& pool = sharedThreadPool();
+    const int ringCounts[] = { 100, 1000 };
+    for (int rings : ringCounts) {
+        string text = buildTorusObj(rings, rings / 2);
+        ObjImporter importer;
+        double parseMs = 1e30, dedupeMs = 1e30;
+        for (int run = 0; run < 3; run++) {
+            importer.parse(text.data(), text.size(), pool);
+            parseMs = min(parseMs, importer.stats().parseMs);
+            dedupeMs = min(dedupeMs, importer.stats().dedupeMs);
+        }
+        const ObjImportStats& stats = importer.stats();
+        double megabytes = text.size() / (1024.0 * 1024.0);
+        cout << "Torus " << rings << "x" << rings / 2 << ": " << megabytes << " MB, " << stats.triangles
+            << " triangles, " << stats.vertices << " vertices, " << pool.threadCount() << " threads" << endl;
+        cout << "  parse: " << parseMs << " ms (" << megabytes / (parseMs / 1000.0) << " MB/s), dedupe: "
+            << dedupeMs << " ms (" << dedupeMs * 1e6 / (stats.triangles * 3.0) << " ns/corner)" << endl;
+
+        // Запись в формате арены - та же, что идет в отображенный GL-буфер
+        VertexFormat format = importer.outputFormat(true);
+        size_t indexSize = importer.indexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        vector<unsigned char> vertexData((size_t)importer.vertexCount() * vertexStride(format));
+        vector<unsigned char> indexData((size_t)importer.indexCount() * indexSize);
+        auto start = chrono::steady_clock::now();
+        importer.write(format, vertexData.data(), indexData.data(), pool);
+        double writeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        double totalMs = parseMs + dedupeMs + writeMs;
+        size_t floatBytes = (size_t)importer.vertexCount() * vertexStride(VERTEX_FLOAT_COLOR_UV)
+            + (size_t)importer.indexCount() * sizeof(uint32_t);
+        size_t packedBytes = vertexData.size() + indexData.size();
+        cout << "  write: " << writeMs << " ms; total " << megabytes / (totalMs / 1000.0) << " MB/s, "
+            << stats.triangles / (totalMs / 1000.0) / 1e6 << " M triangles/s" << endl;
+        cout << "  geometry: " << floatBytes / 1024 << " KB as float + 32-bit indices -> " << packedBytes / 1024
+            << " KB " << vertexFormatName(format) << " (" << 100.0 * packedBytes / floatBytes << "%)" << endl;
+    }
+}
+
+// ==================== Оптимизация мешей ====================
+static void measureMeshOptimization(const char* name, vector<float> vertices, vector<unsigned int> indices) {
+    MeshOptimizeReport report;
+    optimizeMesh(vertices, 8, indices, &report);
+    printOptimizeReport(name, report);
+    cout << "  " << report.milliseconds * 1e6 / report.triangles << " ns/triangle" << endl;
+}
+
+static void benchmarkMeshOptimizer() {
+    cout << "=== Mesh optimizer: Forsyth vertex cache order, overdraw clusters, fetch remap ===" << endl;
+    cout << "FIFO cache of " << VERTEX_CACHE_SIZE << " vertices, 32-byte float vertices" << endl;
+
+    MeshSize size = sphereMeshSize(128, 256);
+    vector<float> sphereVertices((size_t)size.vertexCount * 8);
+    vector<unsigned int> sphereIndices(size.indexCount);
+    generateSphere(1.0f, 128, 256, sphereVertices.data(), sphereIndices.data());
+    measureMeshOptimization("sphere 128x256, generator order", sphereVertices, sphereIndices);
+
+    size = torusMeshSize(512, 256);
+    vector<float> torusVertices((size_t)size.vertexCount * 8);
+    vector<unsigned int> torusIndices(size.indexCount);
+    generateTorus(1.0f, 0.3f, 512, 256, torusVertices.data(), torusIndices.data());
+    measureMeshOptimization("torus 512x256, generator order", torusVertices, torusIndices);
+
+    // Треугольники и вершины вперемешку - как у сканов и мешей после булевых операций
+    mt19937 random(7);
+    vector<uint32_t> triangleOrder(torusIndices.size() / 3), vertexOrder(size.vertexCount);
+    for (size_t i = 0; i < triangleOrder.size(); i++) triangleOrder[i] = (uint32_t)i;
+    for (size_t i = 0; i < vertexOrder.size(); i++) vertexOrder[i] = (uint32_t)i;
+    shuffle(triangleOrder.begin(), triangleOrder.end(), random);
+    shuffle(vertexOrder.begin(), vertexOrder.end(), random);
+    vector<unsigned int> shuffledIndices(torusIndices.size());
+    for (size_t t = 0; t < triangleOrder.size(); t++) {
+        for (int k = 0; k < 3; k++) {
+            shuffledIndices[t * 3 + k] = vertexOrder[torusIndices[triangleOrder[t] * 3 + k]];
+        }
+    }
+    vector<float> shuffledVertices(torusVertices.size());
+    remapVertexBuffer(shuffledVertices.data(), torusVertices.data(), vertexOrder.size(), 8 * sizeof(float), vertexOrder.data());
+    measureMeshOptimization("torus 512x256, shuffled", shuffledVertices, shuffledIndices);
+}
+
+// ==================== Уровни детализации ====================
+static void benchmarkMeshLods() {
+    cout << "=== Mesh LODs: quadric edge-collapse chain and triangles drawn in a dense scene ===" << endl;
+    MeshSize size = torusMeshSize(512, 256);
+    vector<float> vertices((size_t)size.vertexCount * 8);
+    vector<unsigned int> indices(size.indexCount);
+    generateTorus(1.0f, 0.3f, 512, 256, vertices.data(), indices.data());
+
+    auto start = chrono::steady_clock::now();
+    MeshLodChain chain = buildLodChain(indices, vertices.data(), 8, size.vertexCount, true);
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    printLodChain("torus 512x256", chain);
+    cout << "  built in " << buildMs << " ms (" << buildMs * 1e6 / (size.indexCount / 3) << " ns per source triangle), "
+        << 100.0 * (indices.size() - size.indexCount) / size.indexCount << "% more index memory" << endl;
+
+    // 10000 торов с габаритом 1 на расстояниях 2..200 от камеры сцен: 90° по вертикали, 600 пикселей
+    const int objectCount = 10000;
+    const float pixelsAtUnitDistance = 300.0f;
+    const float tolerances[] = { 0.5f, 1.0f, 2.0f };
+    double fullTriangles = (double)objectCount * chain.triangles(0);
+    for (float tolerance : tolerances) {
+        double drawn = 0.0;
+        for (int i = 0; i < objectCount; i++) {
+            float distance = 2.0f + 198.0f * i / (objectCount - 1);
+            drawn += chain.triangles(chain.select(pixelsAtUnitDistance / distance, tolerance));
+        }
+        cout << "  " << objectCount << " objects at 2-200 units, tolerance " << tolerance << " px: "
+            << drawn / 1e6 << " M triangles instead of " << fullTriangles / 1e6 << " M ("
+            << 100.0 * drawn / fullTriangles << "%)" << endl;
+    }
+}
+
+// ==================== Граф сцены ====================
+static void benchmarkSceneGraph() {
+    cout << "=== Scene graph: full recompute vs dirty-flag incremental update ===" << endl;
+    // Дерево с четырьмя детьми у узла: три четверти узлов - листья, глубина 9
+    const int nodeCount = 131072;
+    SceneGraph graph;
+    graph.reserve(nodeCount);
+    mt19937 random(12345);
+    uniform_real_distribution<float> angles(0.0f, 6.2831853f);
+    for (int i = 0; i < nodeCount; i++) {
+        graph.addNode(i == 0 ? -1 : (i - 1) / 4, Mat4::translation(0.0f, 1.0f, 0.0f) * Mat4::rotationY(angles(random)));
+    }
+    graph.update();
+
+    const int iterations = 20;
+    cout << "  " << nodeCount << " nodes, 4 children per node" << endl;
+    const double fractions[] = { 1.0, 0.05, 0.01, 0.001 };
+    for (double fraction : fractions) {
+        int changed = max(1, (int)(nodeCount * fraction));
+        // Узлы меняются заранее выбранными наборами: время выбора не попадает в замер
+        vector<int> nodes(changed * iterations);
+        uniform_int_distribution<int> pick(0, nodeCount - 1);
+        for (int& node : nodes) node = pick(random);
+        Mat4 local = Mat4::translation(0.0f, 1.0f, 0.0f) * Mat4::rotationY(angles(random));
+
+        // Замеряется только пересчет: запись локальных матриц нужна при любом способе.
+        // Полный пересчет идет после тех же изменений, что и update(), - с тем же состоянием кэшей
+        long long recomputed = 0;
+        double fullMs = 0.0, incrementalMs = 0.0;
+        for (int it = 0; it < iterations; it++) {
+            for (int pass = 0; pass < 2; pass++) {
+                for (int i = 0; i < changed; i++) {
+                    graph.setLocal(nodes[it * changed + i], local);
+                }
+                auto start = chrono::steady_clock::now();
+                if (pass == 0) {
+                    graph.updateAll();
+                    fullMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                }
+                else {
+                    recomputed += graph.update();
+                    incrementalMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                }
+                benchmarkSink = benchmarkSink + graph.world(nodes[it * changed]).m[12];
+            }
+        }
+        fullMs /= iterations;
+        incrementalMs /= iterations;
+        cout << "  " << fraction * 100.0 << "% nodes changed (" << changed << "): update " << incrementalMs
+            << " ms, " << recomputed / iterations << " nodes recomputed; full recompute " << fullMs << " ms ("
+            << fullMs / incrementalMs << "x)" << endl;
+    }
+}
+
+// ==================== Реестр ====================
+struct BenchmarkEntry {
+    const char* name;
+    const char* description;
+    void (*run)();
+};
+
+static const BenchmarkEntry benchmarks[] = {
+    { "math", "Mat4/Vec4 SIMD kernels vs the scalar float[16] code", benchmarkMath },
+    { "textures", "Procedural texture generator vs the legacy per-texel loops", benchmarkTextures },
+    { "vertex-formats", "Quantized vertex/index packing on a large terrain mesh: memory and fetch savings",
+        benchmarkVertexFormats },
+    { "mips", "CPU mip chain builder (box/Kaiser in linear space) vs a naive gamma-space box", benchmarkMips },
+    { "mesh-gen", "constexpr circle/cube/sphere/torus generators vs the legacy push_back circle",
+        benchmarkMeshGenerators },
+    { "obj-import", "OBJ importer on a generated torus: parse/dedupe/write throughput and packing savings",
+        benchmarkObjImport },
+    { "mesh-optimize", "Vertex cache/overdraw/fetch optimization: ACMR, ATVR and overfetch before and after",
+        benchmarkMeshOptimizer },
+    { "mesh-lod", "Quadric-error LOD chain: build time, error per level, triangles drawn by screen size",
+        benchmarkMeshLods },
+    { "scene-graph", "Scene graph transforms: full recompute vs dirty-flag update at 100%/5%/1%/0.1% changed nodes",
+        benchmarkSceneGraph },
+};
+
+void listBenchmarks() {
+    cout << "Available benchmarks:" << endl;
+    for (const BenchmarkEntry& entry : benchmarks) {
+        cout << "  " << entry.name << " - " << entry.description << endl;
+    }
+}
+
+bool runBenchmark(const char* name) {
+    bool found = false;
+    for (const BenchmarkEntry& entry : benchmarks) {
+        if (strcmp(name, "all") == 0 || strcmp(name, entry.name) == 0) {
+            entry.run();
+            found = true;
+        }
+    }
+    if (!found) {
+        cout << "Unknown benchmark: " << name << endl;
+        listBenchmarks();
+    }
+    return found;
+}
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+// ==================== Микробенчмарки ====================
+// Запускаются из режима без окна: lab12 --bench <имя>. "all" - все по очереди.
+// Возвращает false, если бенчмарк с таким именем не найден.
+bool runBenchmark(const char* name);
+
+void listBenchmarks();
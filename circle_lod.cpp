@@ -0,0 +1,165 @@
+﻿#include "circle_lod.h"
+#include "mesh_generators.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+void projectedEllipseAxes(const Mat4& modelViewProjection, int width, int height, float& major, float& minor) {
+    major = minor = 0.0f;
+    Vec4 center = modelViewProjection * Vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    if (center.w <= 0.0f) {
+        return;
+    }
+    // Образы единичных векторов по X и Y в пикселях (линейное приближение около центра)
+    Vec4 alongX = modelViewProjection * Vec4(1.0f, 0.0f, 0.0f, 1.0f);
+    Vec4 alongY = modelViewProjection * Vec4(0.0f, 1.0f, 0.0f, 1.0f);
+    float halfWidth = 0.5f * width, halfHeight = 0.5f * height;
+    float cx = center.x / center.w, cy = center.y / center.w;
+    float ux = (alongX.x / alongX.w - cx) * halfWidth, uy = (alongX.y / alongX.w - cy) * halfHeight;
+    float vx = (alongY.x / alongY.w - cx) * halfWidth, vy = (alongY.y / alongY.w - cy) * halfHeight;
+
+    // Полуоси - сингулярные числа матрицы [u v]
+    float sum = ux * ux + uy * uy + vx * vx + vy * vy;
+    float det = ux * vy - uy * vx;
+    float spread = sqrt(max(sum * sum - 4.0f * det * det, 0.0f));
+    major = sqrt(0.5f * (sum + spread));
+    minor = sqrt(max(0.5f * (sum - spread), 0.0f));
+}
+
+int circleSegmentsFor(float majorPixels, float tolerancePixels) {
+    float segments = (float)MESH_PI * sqrt(majorPixels / (2.0f * tolerancePixels));
+    return (int)min(ceil(segments), 1e6f);
+}
+
+void CircleLodCache::init(int minSegments, int maxSegments, bool quantizeVertices, bool optimizeLevels) {
+    levels.clear();
+    quantize = quantizeVertices;
+    optimize = optimizeLevels;
+    arena = nullptr;
+    building = -1;
+    builtInBackground = 0;
+    // 16, 24, 32, 48, 64... - каждый следующий уровень в sqrt(2) раз (в среднем) подробнее
+    for (int k = 0;; k++) {
+        int segments = (minSegments << (k / 2)) * (k % 2 == 1 ? 3 : 2) / 2;
+        if (segments > maxSegments) {
+            break;
+        }
+        levels.push_back(make_unique<CircleLodLevel>());
+        levels.back()->segments = segments;
+    }
+}
+
+int CircleLodCache::levelFor(int segments) const {
+    for (int i = 0; i < (int)levels.size(); i++) {
+        if (levels[i]->segments >= segments) {
+            return i;
+        }
+    }
+    return (int)levels.size() - 1;
+}
+
+void CircleLodCache::build(int index) {
+    CircleLodLevel& level = *levels[index];
+    MeshSize size = circleMeshSize(level.segments);
+    level.vertices.resize((size_t)size.vertexCount * 6);
+    level.indices.resize(size.indexCount);
+    generateCircle(level.segments, level.vertices.data(), level.indices.data());
+    pack(level);
+}
+
+void CircleLodCache::build(int index, const float* vertices, const unsigned int* indices) {
+    CircleLodLevel& level = *levels[index];
+    MeshSize size = circleMeshSize(level.segments);
+    level.vertices.assign(vertices, vertices + (size_t)size.vertexCount * 6);
+    level.indices.assign(indices, indices + size.indexCount);
+    pack(level);
+}
+
+void CircleLodCache::pack(CircleLodLevel& level) {
+    if (optimize) {
+        optimizeMesh(level.vertices, 6, level.indices, &level.optimized);
+    }
+    packMesh(level.vertices.data(), (int)level.vertices.size() / 6, 6, level.indices.data(), (int)level.indices.size(),
+        quantize, level.packed);
+    level.state.store(CIRCLE_LOD_BUILT, memory_order_release);
+}
+
+void CircleLodCache::attach(GeometryArena& target, VertexStreams vertexStreams) {
+    arena = &target;
+    streams = vertexStreams;
+
+    // Все уровни сразу: догрузка уровня не переносит буферы пула, и VAO, собранные
+    // снаружи поверх них (инстансинг), остаются действительными
+    size_t vertexCount = 0, indexBytes = 0;
+    for (const auto& level : levels) {
+        MeshSize size = circleMeshSize(level->segments);
+        vertexCount += size.vertexCount;
+        indexBytes += (size_t)size.indexCount * sizeof(unsigned int) + 3;  // + выравнивание начала
+    }
+    VertexFormat format = quantize ? VERTEX_PACKED_COLOR : VERTEX_FLOAT_COLOR;
+    arena->reserve(format, streams, vertexCount, indexBytes);
+
+    for (const auto& level : levels) {
+        if (level->state.load(memory_order_acquire) == CIRCLE_LOD_BUILT) {
+            upload(*level);
+        }
+    }
+}
+
+bool CircleLodCache::usable(const CircleLodLevel& level) const {
+    int state = level.state.load(memory_order_acquire);
+    return arena ? state == CIRCLE_LOD_UPLOADED : state >= CIRCLE_LOD_BUILT;
+}
+
+void CircleLodCache::upload(CircleLodLevel& level) {
+    level.mesh = arena->add(level.packed, streams);
+    level.state.store(CIRCLE_LOD_UPLOADED, memory_order_release);
+}
+
+const CircleLodLevel& CircleLodCache::select(int index, ThreadPool& pool) {
+    if (building >= 0 && levels[building]->state.load(memory_order_acquire) == CIRCLE_LOD_BUILT) {
+        if (arena) {
+            upload(*levels[building]);
+        }
+        building = -1;
+    }
+
+    CircleLodLevel& wanted = *levels[index];
+    if (building < 0 && wanted.state.load(memory_order_acquire) == CIRCLE_LOD_EMPTY) {
+        building = index;
+        builtInBackground++;
+        wanted.state.store(CIRCLE_LOD_BUILDING, memory_order_relaxed);
+        pool.submit([this, index] { build(index); });
+    }
+
+    // Ближайший готовый; при равном расстоянии - более подробный
+    int best = -1;
+    for (int i = 0; i < (int)levels.size(); i++) {
+        if (usable(*levels[i]) && (best < 0 || abs(i - index) <= abs(best - index))) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        // Ни одного готового уровня (не было начальной таблицы) - единственный раз ждем построения
+        pool.wait();
+        if (arena && wanted.state.load(memory_order_acquire) == CIRCLE_LOD_BUILT) {
+            upload(wanted);
+        }
+        building = -1;
+        best = index;
+    }
+    return *levels[best];
+}
+
+void CircleLodCache::printStats() const {
+    int ready = 0;
+    for (const auto& level : levels) {
+        ready += usable(*level) ? 1 : 0;
+    }
+    cout << "Circle LOD cache: " << ready << "/" << levels.size() << " levels ready ("
+        << levels.front()->segments << "-" << levels.back()->segments << " segments), "
+        << builtInBackground << " built in background" << endl;
+}
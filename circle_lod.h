@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include "geometry_arena.h"
+#include "math3d.h"
+#include "mesh_optimizer.h"
+#include "thread_pool.h"
+#include "vertex_format.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// ==================== Адаптивная тесселяция круга ====================
+// Число сегментов круга (после масштаба - эллипса) выбирается по его размеру на экране:
+// хорда отходит от дуги не дальше допуска в пикселях. При равномерном шаге dθ = 2π/N
+// у эллипса с полуосями a >= b отклонение наибольшее на концах большой оси и равно a·dθ²/8,
+// поэтому N = π·sqrt(a / (2·допуск)): вытянутость учитывается через большую полуось.
+// Нужное N округляется вверх до уровня (шаг в полоктавы: 16, 24, 32, 48, 64...).
+// Каждый уровень строится в рабочем потоке один раз и загружается в арену в заранее
+// зарезервированное место; пока нужный уровень строится, рисуется ближайший готовый.
+
+// Полуоси (в пикселях) эллипса, в который проецируется единичный круг плоскости XY
+// около его центра; 0, если центр за камерой
+void projectedEllipseAxes(const Mat4& modelViewProjection, int width, int height, float& major, float& minor);
+
+// Сколько сегментов нужно, чтобы отклонение от дуги с большой полуосью majorPixels не превышало допуск
+int circleSegmentsFor(float majorPixels, float tolerancePixels);
+
+enum CircleLodState {
+    CIRCLE_LOD_EMPTY,
+    CIRCLE_LOD_BUILDING,  // Строится в рабочем потоке
+    CIRCLE_LOD_BUILT,     // Вершины готовы, в арену еще не загружены
+    CIRCLE_LOD_UPLOADED
+};
+
+struct CircleLodLevel {
+    int segments = 0;
+    std::vector<float> vertices;  // 6 float на вершину - для программного растеризатора
+    std::vector<unsigned int> indices;
+    PackedMesh packed;
+    MeshRange mesh;
+    MeshOptimizeReport optimized;  // Если уровни оптимизируются
+    std::atomic<int> state{ CIRCLE_LOD_EMPTY };
+};
+
+class CircleLodCache {
+public:
+    // Уровни от minSegments до maxSegments; quantize - как packMesh,
+    // optimize - порядок треугольников и вершин через optimizeMesh перед упаковкой
+    void init(int minSegments, int maxSegments, bool quantize, bool optimize = false);
+
+    int levelCount() const { return (int)levels.size(); }
+    const CircleLodLevel& level(int index) const { return *levels[index]; }
+    // Наименьший уровень не меньше segments (или самый подробный)
+    int levelFor(int segments) const;
+
+    // Строит уровень в вызывающем потоке: генератором или копией готовой таблицы
+    void build(int index);
+    void build(int index, const float* vertices, const unsigned int* indices);
+
+    // Резервирует место под все уровни и загружает построенные (в потоке контекста).
+    // Без арены (программный растеризатор) уровни используются сразу после построения.
+    void attach(GeometryArena& arena, VertexStreams streams);
+
+    // Раз в кадр: загружает достроенный уровень, ставит в пул построение нужного
+    // (не больше одного за раз; у пула должны быть рабочие потоки) и возвращает ближайший к нему готовый
+    const CircleLodLevel& select(int index, ThreadPool& pool);
+
+    void printStats() const;
+
+private:
+    bool usable(const CircleLodLevel& level) const;
+    void pack(CircleLodLevel& level);
+    void upload(CircleLodLevel& level);
+
+    std::vector<std::unique_ptr<CircleLodLevel>> levels;
+    bool quantize = true;
+    bool optimize = false;
+    GeometryArena* arena = nullptr;
+    VertexStreams streams = STREAMS_INTERLEAVED;
+    int building = -1;  // Уровень, который сейчас строится в пуле
+    int builtInBackground = 0;
+};
@@ -0,0 +1,94 @@
+﻿#include "command_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+DrawPacket& CommandBuffer::push() {
+    if (used == packets.size()) {
+        packets.resize(max<size_t>(64, packets.size() * 2));
+    }
+    DrawPacket& packet = packets[used++];
+    packet = DrawPacket();
+    return packet;
+}
+
+void CommandRecorder::beginFrame(int objectCount, int grain, RecordFunction record) {
+    if (recording == 2) {
+        // Старый кадр так и не отправили - он устарел
+        waitSlot(slots[oldest]);
+        oldest = 1 - oldest;
+        recording--;
+    }
+
+    FrameSlot& slot = slots[(oldest + recording) % 2];
+    recording++;
+    grain = max(grain, 1);
+    slot.record = move(record);
+    slot.chunkCount = (max(objectCount, 0) + grain - 1) / grain;
+    if (slot.buffers.size() < (size_t)slot.chunkCount) {
+        slot.buffers.resize(slot.chunkCount);
+    }
+    slot.remaining = slot.chunkCount;
+
+    for (int chunk = 0; chunk < slot.chunkCount; chunk++) {
+        int begin = chunk * grain;
+        int end = min(begin + grain, objectCount);
+        pool.submit([this, &slot, chunk, begin, end] {
+            CommandBuffer& buffer = slot.buffers[chunk];
+            buffer.reset();
+            slot.record(begin, end, buffer);
+            if (--slot.remaining == 0) {
+                lock_guard<mutex> guard(doneLock);
+                done.notify_all();
+            }
+        });
+    }
+}
+
+void CommandRecorder::waitSlot(FrameSlot& slot) {
+    unique_lock<mutex> guard(doneLock);
+    done.wait(guard, [&slot] { return slot.remaining.load() == 0; });
+}
+
+bool CommandRecorder::submitFrame(DrawQueue& queue, const MaterialResolver& resolve) {
+    if (recording == 0 || (pipelined && recording == 1)) {
+        return false;
+    }
+
+    FrameSlot& slot = slots[oldest];
+    auto start = chrono::steady_clock::now();
+    waitSlot(slot);
+    lastWait = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    lastPackets = 0;
+    for (int chunk = 0; chunk < slot.chunkCount; chunk++) {
+        for (const DrawPacket& packet : slot.buffers[chunk]) {
+            DrawCommand command = packet.command;
+            if (packet.arrayMaterial >= 0) {
+                command.textureArray = resolve(packet.arrayMaterial);
+            }
+            queue.submit(command);
+        }
+        lastPackets += slot.buffers[chunk].size();
+    }
+    slot.record = nullptr;
+    oldest = 1 - oldest;
+    recording--;
+    return true;
+}
+
+void CommandRecorder::waitIdle() {
+    for (int i = 0; i < recording; i++) {
+        waitSlot(slots[(oldest + i) % 2]);
+    }
+}
+
+void CommandRecorder::discard() {
+    waitIdle();
+    for (FrameSlot& slot : slots) {
+        slot.record = nullptr;
+    }
+    recording = 0;
+}
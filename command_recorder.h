@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include "draw_queue.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// ==================== Запись команд в рабочих потоках ====================
+// Кадр делится на запись и отправку. Запись идет в общем пуле: объекты кадра режутся
+// на диапазоны, и каждый диапазон пишет пакеты в свой линейный буфер (без блокировок,
+// память буферов переиспользуется между кадрами). Отправку делает поток контекста GL:
+// сливает буферы в порядке диапазонов (порядок вызовов тот же, что при записи в одном
+// потоке), подставляет текстуры материалов и отдает пакеты в DrawQueue.
+// Слотов кадров два: при конвейерной записи кадр N+1 пишется, пока отправляется кадр N.
+
+// Пакет не знает имен GL: текстура задается материалом, ее имя подставит поток GL
+// при отправке (к тому времени текстура могла смениться или догрузиться)
+struct DrawPacket {
+    DrawCommand command;  // command.textureArray заполняется при отправке
+    int arrayMaterial = -1;  // Материал-массив для command.textureArray; -1 - не нужен
+};
+
+// Линейный буфер пакетов: reset() только сбрасывает счетчик
+class CommandBuffer {
+public:
+    DrawPacket& push();
+    void reset() { used = 0; }
+
+    const DrawPacket* begin() const { return packets.data(); }
+    const DrawPacket* end() const { return packets.data() + used; }
+    size_t size() const { return used; }
+
+private:
+    std::vector<DrawPacket> packets;
+    size_t used = 0;
+};
+
+class CommandRecorder {
+public:
+    // Пишет пакеты объектов [begin, end) в buffer; вызывается из рабочих потоков
+    using RecordFunction = std::function<void(int begin, int end, CommandBuffer& buffer)>;
+    // Имя текстуры GL по материалу; вызывается в потоке GL
+    using MaterialResolver = std::function<GLuint(int material)>;
+
+    explicit CommandRecorder(ThreadPool& pool) : pool(pool) {}
+    ~CommandRecorder() { waitIdle(); }
+
+    CommandRecorder(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+    // true - кадр отправляется на кадр позже своей записи (запись перекрывается с отправкой)
+    void setPipelined(bool enabled) { pipelined = enabled; }
+    bool isPipelined() const { return pipelined; }
+
+    // Запускает запись кадра из objectCount объектов диапазонами по grain.
+    // record владеет снимком данных кадра: он выполняется уже после возврата
+    void beginFrame(int objectCount, int grain, RecordFunction record);
+
+    // Ждет записи самого старого кадра и переносит его пакеты в queue. При конвейерной
+    // записи последний начатый кадр остается писаться; false - отправлять нечего
+    bool submitFrame(DrawQueue& queue, const MaterialResolver& resolve);
+
+    // Дожидается всех начатых записей (перед изменением данных, которые они читают)
+    void waitIdle();
+    // Дожидается записей и выбрасывает их (кадры рисуются в обход записи)
+    void discard();
+
+    int framesInFlight() const { return recording; }
+    // Пакетов в последнем отправленном кадре и миллисекунд ожидания записи потоком GL
+    size_t lastPacketCount() const { return lastPackets; }
+    double lastWaitMs() const { return lastWait; }
+
+private:
+    struct FrameSlot {
+        std::vector<CommandBuffer> buffers;  // По одному на диапазон
+        RecordFunction record;
+        int chunkCount = 0;
+        std::atomic<int> remaining{ 0 };
+    };
+
+    void waitSlot(FrameSlot& slot);
+
+    ThreadPool& pool;
+    FrameSlot slots[2];
+    int oldest = 0;     // Слот самого старого начатого кадра
+    int recording = 0;  // Начатые и еще не отправленные кадры
+    bool pipelined = false;
+    size_t lastPackets = 0;
+    double lastWait = 0.0;
+
+    std::mutex doneLock;
+    std::condition_variable done;
+};
@@ -0,0 +1,46 @@
+﻿#include "draw_queue.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Имена GL обрезаются до 16 бит: совпадение младших бит только хуже группирует вызовы
+uint64_t DrawQueue::sortKey(const DrawCommand& command) {
+    return (uint64_t)(command.program & 0xFFFF) << 48
+        | (uint64_t)(command.textureArray & 0xFFFF) << 32
+        | (uint64_t)(command.mesh.pool & 0xFFFF) << 16;
+}
+
+void DrawQueue::flush(const GeometryArena& arena) {
+    RenderState& state = renderState();
+    order.resize(commands.size());
+    for (size_t i = 0; i < commands.size(); i++) {
+        order[i] = (uint32_t)i;
+    }
+    if (sorting) {
+        vector<uint64_t> keys(commands.size());
+        for (size_t i = 0; i < commands.size(); i++) {
+            keys[i] = sortKey(commands[i]);
+        }
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            if (keys[a] != keys[b]) return keys[a] < keys[b];
+            if (commands[a].mesh.indexByteOffset != commands[b].mesh.indexByteOffset) {
+                return commands[a].mesh.indexByteOffset < commands[b].mesh.indexByteOffset;
+            }
+            return a < b;
+        });
+    }
+
+    for (uint32_t index : order) {
+        const DrawCommand& command = commands[index];
+        state.useProgram(command.program);
+        if (command.textureArray != 0) {
+            state.bindTextureArray(DRAW_ARRAY_UNIT, command.textureArray);
+        }
+        command.modelUniform.set(command.model * command.mesh.dequantize);
+        command.parameterUniform.set(command.parameter);
+        command.layerUniform.set(command.layers);
+        arena.draw(command.mesh);
+    }
+    commands.clear();
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "geometry_arena.h"
+#include "render_state.h"
+#include "shader_program.h"
+
+#include <cstdint>
+#include <vector>
+
+// ==================== Очередь отрисовки ====================
+// Вызовы кадра копятся в очереди и перед выполнением сортируются по 64-битному ключу
+// программа -> массив материалов -> пул арены (по 16 бит на имя GL), при равных ключах -
+// по месту меша в пуле. Материалы - слои одного GL_TEXTURE_2D_ARRAY, отдельных 2D-текстур
+// у вызовов нет. Соседние вызовы делят состояние, и RenderState пропускает
+// повторные привязки. Без сортировки вызовы идут в порядке добавления.
+
+const int DRAW_ARRAY_UNIT = 2;  // Блок массива материалов (блок 0 занят загрузкой текстур)
+
+struct DrawCommand {
+    GLuint program = 0;
+    GLuint textureArray = 0;  // GL_TEXTURE_2D_ARRAY в блоке DRAW_ARRAY_UNIT; 0 - не нужен
+    MeshRange mesh;
+    UniformMat4 modelUniform;  // Получает model * mesh.dequantize
+    Mat4 model = Mat4::identity();
+    UniformFloat parameterUniform;  // Необязательный float программы (влияние цвета, доля смешивания)
+    float parameter = 0.0f;
+    UniformInt layerUniform;  // Слои массива материалов, по 8 бит на текстуру шейдера
+    int layers = 0;
+};
+
+class DrawQueue {
+public:
+    void submit(const DrawCommand& command) { commands.push_back(command); }
+
+    // Сортирует (если включено), выполняет через renderState() и очищает очередь
+    void flush(const GeometryArena& arena);
+
+    void setSorting(bool enabled) { sorting = enabled; }
+    bool isSorting() const { return sorting; }
+    size_t size() const { return commands.size(); }
+
+private:
+    static uint64_t sortKey(const DrawCommand& command);
+
+    std::vector<DrawCommand> commands;
+    std::vector<uint32_t> order;
+    bool sorting = true;
+};
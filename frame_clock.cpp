@@ -0,0 +1,61 @@
+﻿#include "frame_clock.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+void FrameClock::start() {
+    frameStart = Clock::now();
+    nextFrameDeadline = frameStart + framePeriod;
+    accumulator = 0.0;
+    lastFrameTime = 0.0;
+}
+
+int FrameClock::beginFrame() {
+    Clock::time_point now = Clock::now();
+    lastFrameTime = chrono::duration<double>(now - frameStart).count();
+    frameStart = now;
+
+    accumulator += simulatedFrameTime > 0.0 ? simulatedFrameTime : lastFrameTime;
+
+    int steps = 0;
+    while (accumulator >= FIXED_STEP && steps < MAX_STEPS_PER_FRAME) {
+        accumulator -= FIXED_STEP;
+        steps++;
+    }
+    // Отставание больше MAX_STEPS_PER_FRAME шагов отбрасывается
+    accumulator = min(accumulator, FIXED_STEP);
+    return steps;
+}
+
+void FrameClock::waitForNextFrame() {
+    if (framePeriod == Clock::duration::zero()) {
+        return;
+    }
+
+    // Спим с запасом в пару миллисекунд (точность sleep в Windows - около 1-15 мс),
+    // остаток дожидаемся активным ожиданием
+    const Clock::duration spinMargin = chrono::milliseconds(2);
+    Clock::time_point now = Clock::now();
+    if (nextFrameDeadline - now > spinMargin) {
+        this_thread::sleep_for(nextFrameDeadline - now - spinMargin);
+    }
+    while (Clock::now() < nextFrameDeadline) {
+        this_thread::yield();
+    }
+
+    // Если кадр опоздал больше чем на период, график сдвигается, а не наверстывается
+    nextFrameDeadline += framePeriod;
+    now = Clock::now();
+    if (nextFrameDeadline < now) {
+        nextFrameDeadline = now + framePeriod;
+    }
+}
+
+void FrameClock::setFrameRateLimit(double fps) {
+    framePeriod = fps > 0.0
+        ? chrono::duration_cast<Clock::duration>(chrono::duration<double>(1.0 / fps))
+        : Clock::duration::zero();
+    nextFrameDeadline = Clock::now() + framePeriod;
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <chrono>
+
+// ==================== Часы кадров с фиксированным шагом ====================
+// Анимация продвигается шагами фиксированной длины FIXED_STEP независимо от частоты кадров:
+// beginFrame() добавляет реальное время кадра в аккумулятор и возвращает,
+// сколько шагов симуляции нужно выполнить. Остаток аккумулятора (leftover())
+// используется при отрисовке, чтобы движение было плавным между шагами.
+class FrameClock {
+public:
+    static constexpr double FIXED_STEP = 1.0 / 60.0;
+    // Не больше стольких шагов за кадр: после долгой паузы (перетаскивание окна,
+    // отладчик) анимация не пытается догнать все пропущенное время
+    static const int MAX_STEPS_PER_FRAME = 8;
+
+    void start();
+
+    // Начало кадра; возвращает число шагов симуляции по FIXED_STEP
+    int beginFrame();
+    // Ждет до начала следующего кадра, если задан лимит частоты кадров
+    void waitForNextFrame();
+
+    // Время, еще не отработанное шагами симуляции (0..FIXED_STEP), в секундах
+    double leftover() const { return accumulator; }
+    // Реальная длительность последнего кадра, в секундах
+    double frameTime() const { return lastFrameTime; }
+
+    // 0 - без ограничения (режим замеров); иначе кадры не чаще fps в секунду
+    void setFrameRateLimit(double fps);
+    // > 0 - каждый кадр считается длящимся ровно столько секунд (воспроизводимые прогоны)
+    void setSimulatedFrameTime(double seconds) { simulatedFrameTime = seconds; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point frameStart;
+    Clock::time_point nextFrameDeadline;
+    Clock::duration framePeriod = Clock::duration::zero();
+    double accumulator = 0.0;
+    double lastFrameTime = 0.0;
+    double simulatedFrameTime = 0.0;
+};
@@ -0,0 +1,234 @@
+﻿#include "geometry_arena.h"
+#include "render_state.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// Начальный размер пула; растет вдвое, но мешей сцены хватает и этого
+static const size_t INITIAL_POOL_VERTICES = 4096;
+static const size_t INITIAL_POOL_INDEX_BYTES = 64 * 1024;
+
+// Новый буфер размера newSize с содержимым старого (первые usedSize байт)
+static GLuint growBuffer(GLenum target, GLuint buffer, size_t usedSize, size_t newSize) {
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(target, grown);
+    glBufferData(target, newSize, nullptr, GL_STATIC_DRAW);
+    if (buffer != 0) {
+        if (usedSize > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, target, 0, 0, usedSize);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    return grown;
+}
+
+int GeometryArena::findPool(VertexFormat format, VertexStreams streams) {
+    for (size_t i = 0; i < pools.size(); i++) {
+        if (pools[i].format == format && pools[i].streams == streams) {
+            return (int)i;
+        }
+    }
+    Pool pool;
+    pool.format = format;
+    pool.streams = streams;
+    glGenVertexArrays(1, &pool.vao);
+    pools.push_back(pool);
+    return (int)pools.size() - 1;
+}
+
+// Вершинный буфер на capacity вершин; при SoA каждый поток атрибута переезжает на свое новое место
+void GeometryArena::growVertexBuffer(Pool& pool, size_t capacity) {
+    const VertexLayoutInfo& layout = vertexLayout(pool.format);
+    if (pool.streams == STREAMS_INTERLEAVED) {
+        pool.vertexBuffer = growBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer,
+            pool.vertexCount * layout.stride, capacity * layout.stride);
+    }
+    else {
+        GLuint grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_ARRAY_BUFFER, grown);
+        glBufferData(GL_ARRAY_BUFFER, capacity * layout.stride, nullptr, GL_STATIC_DRAW);
+        if (pool.vertexBuffer != 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, pool.vertexBuffer);
+            for (int i = 0; i < layout.attributeCount && pool.vertexCount > 0; i++) {
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER,
+                    vertexStreamOffset(layout, i, STREAMS_SOA, pool.vertexCapacity),
+                    vertexStreamOffset(layout, i, STREAMS_SOA, capacity),
+                    pool.vertexCount * layout.attributes[i].size);
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glDeleteBuffers(1, &pool.vertexBuffer);
+        }
+        pool.vertexBuffer = grown;
+    }
+    pool.vertexCapacity = capacity;
+    setVertexAttributes(layout, pool.streams, capacity);
+}
+
+// Буферы пула вмещают еще vertexCount вершин и indexBytes байт индексов.
+// VAO пула переключается на новые буферы; VAO, созданные снаружи (инстансинг),
+// нужно создавать после загрузки всех мешей
+void GeometryArena::reserve(Pool& pool, size_t vertexCount, size_t indexBytes) {
+    bool growVertices = pool.vertexCount + vertexCount > pool.vertexCapacity;
+    bool growIndices = pool.indexBytes + indexBytes > pool.indexCapacity;
+    if (!growVertices && !growIndices) {
+        return;
+    }
+
+    renderState().bindVertexArray(pool.vao);
+    if (growVertices) {
+        size_t capacity = max(pool.vertexCapacity * 2, INITIAL_POOL_VERTICES);
+        while (capacity < pool.vertexCount + vertexCount) capacity *= 2;
+        growVertexBuffer(pool, capacity);
+    }
+    if (growIndices) {
+        size_t capacity = max(pool.indexCapacity * 2, INITIAL_POOL_INDEX_BYTES);
+        while (capacity < pool.indexBytes + indexBytes) capacity *= 2;
+        // Привязка GL_ELEMENT_ARRAY_BUFFER запоминается в VAO пула
+        pool.indexBuffer = growBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer, pool.indexBytes, capacity);
+        pool.indexCapacity = capacity;
+    }
+    renderState().bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::reserve(VertexFormat format, VertexStreams streams, size_t vertexCount, size_t indexBytes) {
+    reserve(pools[findPool(format, streams)], vertexCount, indexBytes);
+}
+
+MeshRange GeometryArena::add(const PackedMesh& packed, VertexStreams streams) {
+    int poolIndex = findPool(packed.format, streams);
+    Pool& pool = pools[poolIndex];
+
+    // Смещение индексов выравнивается на 4 байта, чтобы за 16-битными могли идти 32-битные
+    size_t indexStart = (pool.indexBytes + 3) & ~(size_t)3;
+    reserve(pool, packed.vertexCount, indexStart - pool.indexBytes + packed.indices.size());
+
+    MeshRange mesh;
+    mesh.pool = poolIndex;
+    mesh.baseVertex = (GLint)pool.vertexCount;
+    mesh.vertexCount = packed.vertexCount;
+    mesh.indexByteOffset = indexStart;
+    mesh.indexCount = packed.indexCount;
+    mesh.indexType = packed.indexType;
+    mesh.dequantize = packed.dequantize;
+
+    const VertexLayoutInfo& layout = vertexLayout(pool.format);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+    if (streams == STREAMS_INTERLEAVED) {
+        glBufferSubData(GL_ARRAY_BUFFER, pool.vertexCount * layout.stride, packed.vertices.size(), packed.vertices.data());
+    }
+    else {
+        // Упакованные вершины всегда interleaved - раскладываем их по потокам атрибутов
+        vector<unsigned char> stream;
+        for (int i = 0; i < layout.attributeCount; i++) {
+            const VertexAttributeInfo& attribute = layout.attributes[i];
+            stream.resize((size_t)packed.vertexCount * attribute.size);
+            for (int v = 0; v < packed.vertexCount; v++) {
+                memcpy(&stream[(size_t)v * attribute.size],
+                    &packed.vertices[(size_t)v * layout.stride + attribute.offset], attribute.size);
+            }
+            size_t offset = vertexStreamOffset(layout, i, STREAMS_SOA, pool.vertexCapacity)
+                + pool.vertexCount * attribute.size;
+            glBufferSubData(GL_ARRAY_BUFFER, offset, stream.size(), stream.data());
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Индексный буфер меняется без VAO: привязка к GL_COPY_WRITE_BUFFER не трогает чужое состояние
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexStart, packed.indices.size(), packed.indices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    pool.vertexCount += packed.vertexCount;
+    pool.indexBytes = indexStart + packed.indices.size();
+    pool.meshCount++;
+    return mesh;
+}
+
+MeshRange GeometryArena::allocate(VertexFormat format, GLsizei vertexCount, GLsizei indexCount, GLenum indexType) {
+    int poolIndex = findPool(format, STREAMS_INTERLEAVED);
+    Pool& pool = pools[poolIndex];
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t indexStart = (pool.indexBytes + 3) & ~(size_t)3;
+    reserve(pool, vertexCount, indexStart - pool.indexBytes + indexCount * indexSize);
+
+    MeshRange mesh;
+    mesh.pool = poolIndex;
+    mesh.baseVertex = (GLint)pool.vertexCount;
+    mesh.vertexCount = vertexCount;
+    mesh.indexByteOffset = indexStart;
+    mesh.indexCount = indexCount;
+    mesh.indexType = indexType;
+
+    pool.vertexCount += vertexCount;
+    pool.indexBytes = indexStart + indexCount * indexSize;
+    pool.meshCount++;
+    return mesh;
+}
+
+// Оба буфера отображаются через копировальные точки привязки, чтобы не трогать VAO
+MeshMapping GeometryArena::map(const MeshRange& mesh) {
+    const Pool& pool = pools[mesh.pool];
+    size_t stride = vertexStride(pool.format);
+    size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+
+    MeshMapping mapping;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+    mapping.vertices = glMapBufferRange(GL_COPY_WRITE_BUFFER, mesh.baseVertex * stride, mesh.vertexCount * stride, access);
+    glBindBuffer(GL_COPY_READ_BUFFER, pool.indexBuffer);
+    mapping.indices = glMapBufferRange(GL_COPY_READ_BUFFER, mesh.indexByteOffset, mesh.indexCount * indexSize, access);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return mapping;
+}
+
+void GeometryArena::unmap(const MeshRange& mesh) {
+    const Pool& pool = pools[mesh.pool];
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryArena::setupVertexAttributes(const MeshRange& mesh) const {
+    const Pool& pool = pools[mesh.pool];
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+    setVertexAttributes(vertexLayout(pool.format), pool.streams, pool.vertexCapacity);
+}
+
+void GeometryArena::draw(const MeshRange& mesh) const {
+    renderState().bindVertexArray(pools[mesh.pool].vao);
+    renderState().countDraw();
+    glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, mesh.indexType, mesh.indexOffset(), mesh.baseVertex);
+}
+
+void GeometryArena::destroy() {
+    for (Pool& pool : pools) {
+        renderState().forgetVertexArray(pool.vao);
+        glDeleteVertexArrays(1, &pool.vao);
+        glDeleteBuffers(1, &pool.vertexBuffer);
+        glDeleteBuffers(1, &pool.indexBuffer);
+    }
+    pools.clear();
+}
+
+void GeometryArena::printStats() const {
+    for (const Pool& pool : pools) {
+        size_t stride = vertexStride(pool.format);
+        cout << "Geometry pool " << vertexFormatName(pool.format) << " (" << stride << " B/vertex, "
+            << (pool.streams == STREAMS_SOA ? "SoA" : "interleaved") << "): "
+            << pool.meshCount << " meshes, " << pool.vertexCount << "/" << pool.vertexCapacity << " vertices, "
+            << pool.indexBytes << "/" << pool.indexCapacity << " index bytes, "
+            << (pool.vertexCapacity * stride + pool.indexCapacity) / 1024 << " KB" << endl;
+    }
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include "platform.h"
+#include "math3d.h"
+#include "vertex_format.h"
+
+#include <cstddef>
+#include <vector>
+
+// ==================== Арена геометрии ====================
+// Вершины и индексы всех мешей лежат в нескольких больших буферах - по одному пулу на формат
+// вершин. Меш - это диапазон в пуле: рисуется через glDrawElementsBaseVertex, поэтому индексы
+// остаются локальными (от 0), а у всех мешей одного формата общий VAO.
+// Индексный буфер адресуется в байтах: 16- и 32-битные индексы разных мешей лежат в нем вперемешку.
+// Вершины пула лежат вперемешку или потоками атрибутов (SoA) - это выбирается при добавлении меша.
+
+struct MeshRange {
+    int pool = -1;
+    GLint baseVertex = 0;
+    GLsizei vertexCount = 0;
+    size_t indexByteOffset = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    Mat4 dequantize = Mat4::identity();  // Умножается справа на матрицу модели
+
+    bool empty() const { return indexCount == 0; }
+    const void* indexOffset() const { return (const void*)indexByteOffset; }
+
+    // Часть индексов того же меша (например, уровень детализации) с теми же вершинами
+    MeshRange subrange(GLsizei firstIndex, GLsizei count) const {
+        MeshRange range = *this;
+        range.indexByteOffset += (size_t)firstIndex * (indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+        range.indexCount = count;
+        return range;
+    }
+};
+
+struct MeshMapping {
+    void* vertices = nullptr;
+    void* indices = nullptr;
+};
+
+class GeometryArena {
+public:
+    // Копирует меш в пул его формата и раскладки потоков; при нехватке места буферы пула растут вдвое
+    MeshRange add(const PackedMesh& mesh, VertexStreams streams = STREAMS_INTERLEAVED);
+
+    // Место еще под vertexCount вершин и indexBytes байт индексов: меши, добавленные
+    // в эти пределы позже, не переносят буферы пула
+    void reserve(VertexFormat format, VertexStreams streams, size_t vertexCount, size_t indexBytes);
+
+    // Место под меш без данных (в interleaved-пуле формата): вершины и индексы потом пишутся
+    // прямо в буферы через map() - из любых потоков, пока диапазон отображен
+    MeshRange allocate(VertexFormat format, GLsizei vertexCount, GLsizei indexCount, GLenum indexType);
+    MeshMapping map(const MeshRange& mesh);
+    void unmap(const MeshRange& mesh);
+
+    GLuint vao(const MeshRange& mesh) const { return pools[mesh.pool].vao; }
+    GLuint vertexBuffer(const MeshRange& mesh) const { return pools[mesh.pool].vertexBuffer; }
+    GLuint indexBuffer(const MeshRange& mesh) const { return pools[mesh.pool].indexBuffer; }
+    VertexFormat format(const MeshRange& mesh) const { return pools[mesh.pool].format; }
+    VertexStreams streams(const MeshRange& mesh) const { return pools[mesh.pool].streams; }
+
+    // Атрибуты вершин пула меша в текущем VAO (для VAO, собранных снаружи, например с инстансингом)
+    void setupVertexAttributes(const MeshRange& mesh) const;
+
+    // Привязывает VAO пула и рисует диапазон
+    void draw(const MeshRange& mesh) const;
+
+    void destroy();
+
+    // Пулы, меши и заполнение буферов
+    void printStats() const;
+
+private:
+    struct Pool {
+        VertexFormat format = VERTEX_FLOAT_COLOR;
+        VertexStreams streams = STREAMS_INTERLEAVED;
+        GLuint vao = 0, vertexBuffer = 0, indexBuffer = 0;
+        size_t vertexCount = 0, vertexCapacity = 0;
+        size_t indexBytes = 0, indexCapacity = 0;  // В байтах
+        int meshCount = 0;
+    };
+
+    int findPool(VertexFormat format, VertexStreams streams);
+    void growVertexBuffer(Pool& pool, size_t capacity);
+    void reserve(Pool& pool, size_t vertexCount, size_t indexBytes);
+
+    std::vector<Pool> pools;
+};
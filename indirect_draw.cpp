@@ -0,0 +1,84 @@
+﻿#include "indirect_draw.h"
+#include "render_state.h"
+
+#include <iostream>
+
+using namespace std;
+
+bool IndirectDrawList::create(bool forceLoop) {
+    bool baseInstance = hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance");
+    multiDraw = !forceLoop && (hasGLVersion(4, 3) || hasGLExtension("GL_ARB_multi_draw_indirect"));
+    if (!baseInstance && !multiDraw) {
+        cout << "Indirect draws unavailable: no GL_ARB_base_instance" << endl;
+        return false;
+    }
+    if (multiDraw) {
+        glGenBuffers(1, &buffer);
+    }
+    cout << "Indirect draws: " << (multiDraw ? "glMultiDrawElementsIndirect" : "loop fallback") << endl;
+    return true;
+}
+
+void IndirectDrawList::destroy() {
+    if (buffer != 0) {
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+    commands.clear();
+    capacity = 0;
+}
+
+void IndirectDrawList::clear() {
+    commands.clear();
+    dirty = true;
+}
+
+void IndirectDrawList::add(const MeshRange& mesh, GLuint baseInstance, GLuint instanceCount) {
+    DrawElementsIndirectCommand command;
+    command.count = (GLuint)mesh.indexCount;
+    command.instanceCount = instanceCount;
+    command.firstIndex = (GLuint)(mesh.indexByteOffset / (mesh.indexType == GL_UNSIGNED_SHORT ? 2 : 4));
+    command.baseVertex = mesh.baseVertex;
+    command.baseInstance = baseInstance;
+    commands.push_back(command);
+    dirty = true;
+}
+
+// Команды меняются только вместе с набором объектов, поэтому буфер перезаписывается целиком
+void IndirectDrawList::upload() {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+    GLsizeiptr bytes = (GLsizeiptr)(commands.size() * sizeof(DrawElementsIndirectCommand));
+    if (commands.size() > capacity) {
+        capacity = commands.size();
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, bytes, commands.data(), GL_STATIC_DRAW);
+    }
+    else {
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+    }
+    dirty = false;
+}
+
+void IndirectDrawList::draw(size_t first, size_t count, GLenum indexType) {
+    if (count == 0) {
+        return;
+    }
+    if (multiDraw) {
+        if (dirty) {
+            upload();
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, (const void*)(first * sizeof(DrawElementsIndirectCommand)),
+            (GLsizei)count, 0);
+        renderState().countDraw();
+        return;
+    }
+
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    for (size_t i = first; i < first + count; i++) {
+        const DrawElementsIndirectCommand& command = commands[i];
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (GLsizei)command.count, indexType,
+            (const void*)(command.firstIndex * indexSize), (GLsizei)command.instanceCount, command.baseVertex,
+            command.baseInstance);
+        renderState().countDraw();
+    }
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "platform.h"
+#include "geometry_arena.h"
+
+#include <vector>
+
+// ==================== Непрямая отрисовка ====================
+// Команды отрисовки - записи DrawElementsIndirectCommand: CPU пишет их в буфер
+// GL_DRAW_INDIRECT_BUFFER, и все объекты диапазона рисуются одним glMultiDrawElementsIndirect.
+// Данные объекта выбираются по номеру вызова: baseInstance команды сдвигает атрибуты
+// экземпляра (glVertexAttribDivisor = 1), поэтому шейдеры инстансинга подходят без изменений.
+// Без GL 4.3 / ARB_multi_draw_indirect команды выполняются циклом
+// glDrawElementsInstancedBaseVertexBaseInstance (GL 4.2 / ARB_base_instance).
+
+// Раскладка записи фиксирована спецификацией GL
+struct DrawElementsIndirectCommand {
+    GLuint count = 0;
+    GLuint instanceCount = 1;
+    GLuint firstIndex = 0;  // В индексах, не в байтах
+    GLint baseVertex = 0;
+    GLuint baseInstance = 0;  // Номер вызова: откуда брать атрибуты экземпляра
+};
+
+class IndirectDrawList {
+public:
+    // false - нет даже baseInstance, путь недоступен. forceLoop - цикл вместо
+    // glMultiDrawElementsIndirect даже при его наличии (для сравнения)
+    bool create(bool forceLoop = false);
+    void destroy();
+
+    void clear();
+    void add(const MeshRange& mesh, GLuint baseInstance, GLuint instanceCount = 1);
+    size_t size() const { return commands.size(); }
+
+    // Команды [first, first + count): привязанный VAO содержит их индексы и атрибуты,
+    // у всех команд один пул арены и тип индексов
+    void draw(size_t first, size_t count, GLenum indexType);
+
+    bool isMultiDraw() const { return multiDraw; }
+
+private:
+    void upload();
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    GLuint buffer = 0;
+    size_t capacity = 0;  // В командах
+    bool dirty = false;   // Команды изменились после последней загрузки
+    bool multiDraw = false;
+};
@@ -0,0 +1,87 @@
+﻿#include "instance_stream.h"
+
+#include <iostream>
+
+using namespace std;
+
+void InstanceStream::create(GLsizeiptr frameCapacity, bool allowPersistent) {
+    persistent = allowPersistent && (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage"));
+    allocate(frameCapacity);
+    cout << "Instance stream: " << (persistent ? "persistent mapping" : "buffer orphaning")
+        << ", " << frameCapacity / 1024 << " KB per frame" << endl;
+}
+
+void InstanceStream::allocate(GLsizeiptr frameCapacity) {
+    destroy();
+    // Сегменты выравниваются по 256 байт, чтобы смещение кадра годилось для любых атрибутов
+    capacity = (frameCapacity + 255) & ~(GLsizeiptr)255;
+
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, capacity * FRAMES_IN_FLIGHT, nullptr, flags);
+        persistentPtr = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, capacity * FRAMES_IN_FLIGHT, flags);
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceStream::destroy() {
+    for (GLsync& sync : fences) {
+        if (sync) {
+            glDeleteSync(sync);
+            sync = nullptr;
+        }
+    }
+    if (bufferId != 0) {
+        if (persistentPtr) {
+            glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            persistentPtr = nullptr;
+        }
+        glDeleteBuffers(1, &bufferId);
+        bufferId = 0;
+    }
+}
+
+void* InstanceStream::map(GLsizeiptr size) {
+    if (size > capacity) {
+        // Буфер растет с запасом, чтобы не пересоздавать его на каждом шаге
+        allocate(size + size / 2);
+    }
+
+    if (persistent) {
+        segment = (segment + 1) % FRAMES_IN_FLIGHT;
+        // Ждем, пока GPU дочитает данные, записанные в этот сегмент FRAMES_IN_FLIGHT кадров назад
+        if (fences[segment]) {
+            glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fences[segment]);
+            fences[segment] = nullptr;
+        }
+        return persistentPtr + segment * capacity;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    return glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+GLintptr InstanceStream::unmap() {
+    if (persistent) {
+        return segment * capacity;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, bufferId);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return 0;
+}
+
+void InstanceStream::fence() {
+    if (persistent) {
+        fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include "platform.h"
+
+// ==================== Потоковый буфер данных экземпляров ====================
+// Данные, которые CPU переписывает каждый кадр (матрицы и оттенки экземпляров).
+// Если есть ARB_buffer_storage, буфер отображается в память один раз (persistent mapping)
+// и делится на сегменты по числу кадров в полете; сегмент переиспользуется после его fence.
+// Иначе каждый кадр буфер "осиротевает" (glBufferData(nullptr)) и отображается заново.
+class InstanceStream {
+public:
+    static const int FRAMES_IN_FLIGHT = 3;
+
+    // allowPersistent = false принудительно включает режим с "осиротением" (для сравнения)
+    void create(GLsizeiptr frameCapacity, bool allowPersistent = true);
+    void destroy();
+
+    // Возвращает указатель для записи size байт данных текущего кадра
+    void* map(GLsizeiptr size);
+    // Завершает запись; возвращает смещение данных кадра в буфере
+    GLintptr unmap();
+    // Ставится после команд рисования, читающих данные кадра
+    void fence();
+
+    GLuint buffer() const { return bufferId; }
+    bool isPersistent() const { return persistent; }
+
+private:
+    void allocate(GLsizeiptr frameCapacity);
+
+    GLuint bufferId = 0;
+    GLsizeiptr capacity = 0;  // Размер одного сегмента
+    bool persistent = false;
+    unsigned char* persistentPtr = nullptr;
+    GLsync fences[FRAMES_IN_FLIGHT] = {};
+    int segment = 0;
+};
@@ -1,34 +1,151 @@
 ﻿#define _CRT_SECURE_NO_WARNINGS
 
-#include <windows.h>
-#include <GL/glew.h>
-#include <GL/gl.h>
+#include "platform.h"
+#include "math3d.h"
+#include "shader_program.h"
+#include "program_cache.h"
+#include "instance_stream.h"
+#include "geometry_arena.h"
+#include "mesh_generators.h"
+#include "circle_lod.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "draw_queue.h"
+#include "command_recorder.h"
+#include "indirect_draw.h"
+#include "scene_graph.h"
+#include "obj_importer.h"
+#include "frame_clock.h"
+#include "procedural_texture.h"
+#include "texture_streamer.h"
+#include "texture_cache.h"
+#include "mip_builder.h"
+#include "texture_image.h"
+#include "thread_pool.h"
+#include "task_graph.h"
+#include "soft_raster.h"
+#include "benchmarks.h"
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <deque>
 #include <algorithm>
-
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <random>
+
+// Без stb_image (например, в сборке CMake без этого заголовка) текстуры создаются программно
+#ifndef LAB12_NO_STB_IMAGE
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#endif
 
 using namespace std;
 
 // ==================== Глобальные переменные ====================
+#ifdef _WIN32
 HWND g_hWnd;
 HDC g_hDC;
 HGLRC g_hRC;
+#endif
 
 int currentScene = 1;
-float tetraX = 0.0f, tetraY = 0.0f, tetraZ = -3.0f;
 float colorInfluence = 0.5f;  // Влияние цвета на текстуру (0..1)
 float textureMixRatio = 0.5f; // Смешивание двух текстур (0..1)
-float circleScaleX = 1.0f, circleScaleY = 1.0f;
-
-GLuint textureWater, textureWood;
-GLuint programTet, programCubeTex, programCubeTwoTex, programCircle;
-GLuint tetraVAO, tetraVBO, tetraEBO;
-GLuint cubeVAO, cubeVBO, cubeEBO;
-GLuint circleVAO, circleVBO, circleEBO;
+float sceneRotation[6] = { 0 };  // Угол автоповорота объекта каждой сцены (градусы)
+const float rotationSpeed = 60.0f;  // Скорость автоповорота, градусов в секунду
+FrameClock frameClock;
+const float clearColor[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
+
+// Копии текстур в памяти для программного растеризатора
+TextureImage waterImage, woodImage;
+int proceduralTextureSize = PROCEDURAL_REFERENCE_SIZE;  // Сторона программных текстур
+
+// Текстуры грузятся асинхронно; до готовности вместо них привязывается заглушка
+TextureStreamer textureStreamer;
+double textureUploadBudgetMs = 2.0;  // Время на копирование текстур в начале кадра
+// Материалы в одном GL_TEXTURE_2D_ARRAY (слой - Material): кубики всех сцен
+// выбирают текстуру номером слоя, а не отдельной привязкой
+int materialArray = -1;
+ProceduralPattern cubeTexturePattern = PATTERN_WATER;
+bool textureCacheEnabled = true;  // Сжатие в BC1 и дисковый кэш
+const char* textureCacheDirectory = "texture_cache";
+MipFilter textureMipFilter = MIP_FILTER_KAISER;
+
+// Бинарники шейдерных программ между запусками
+bool programCacheEnabled = true;
+const char* programCacheDirectory = "shader_cache";
+
+ShaderProgram programTet, programCubeTex, programCubeTwoTex, programCircle;
+UniformBuffer cameraBuffer;
+
+// Дескрипторы uniform-переменных (ищутся один раз после компоновки)
+UniformMat4 tetModel, cubeTexModel, cubeTwoTexModel, circleModel;
+UniformFloat cubeTexColorInfluence, cubeTwoTexMixRatio;
+UniformInt cubeTexLayers, cubeTwoTexLayers;
+
+// Вызовы отрисовки кадра: сортируются по программе, текстурам и мешу (draw_queue.h)
+DrawQueue drawQueue;
+
+// Пакеты вызовов пишутся в общем пуле, отправляет их поток GL (command_recorder.h)
+CommandRecorder commandRecorder(sharedThreadPool());
+deque<CameraBlock> recordedCameras;  // Камеры записанных, но еще не отправленных кадров
+const int RECORD_GRAIN = 256;  // Объектов на буфер записи
+
+// Материалы пакетов: имя текстуры подставляется при отправке. Материал - он же слой массива
+enum Material {
+    MATERIAL_WATER,
+    MATERIAL_WOOD,
+    MATERIAL_COUNT
+};
+const int MATERIAL_ARRAY = MATERIAL_COUNT;  // Весь массив материалов
+
+// Все меши в общих буферах, по пулу на формат вершин
+GeometryArena geometryArena;
+MeshRange tetraMesh, cubeMesh;
+bool vertexQuantization = true;  // SNORM16/RGBA8/UNORM16 вместо float
+VertexStreams meshVertexStreams = STREAMS_INTERLEAVED;  // Все атрибуты каждой вершины рядом или потоками
+PackedMesh tetraPacked, cubePacked;  // Упакованы в потоках пула, загружаются в контексте
+bool meshOptimization = false;  // Порядок треугольников и вершин под кэши перед упаковкой (mesh_optimizer.h)
+MeshOptimizeReport cubeOptimized, importOptimized;
+
+// Сцена 4: число сегментов круга зависит от его размера на экране
+CircleLodCache circleLod;
+float circleTolerance = 0.125f;  // Отклонение хорды от дуги, пикселей (0 - всегда circleSegments)
+int circleDrawnSegments = 0;
+
+// Сцены 2 и 3: меш из OBJ-файла вместо куба
+const char* importMeshPath = nullptr;
+ObjImporter meshImporter;
+MeshRange importedMesh;  // Все уровни детализации; рисуется подсписок индексов одного из них
+MeshLodChain importedLods;
+float meshLodTolerance = 1.0f;  // Ошибка уровня на экране, пикселей (0 - всегда полная детализация)
+int importedLodDrawn = -1;
+
+// Сцена 5: стресс-тест с инстансингом
+struct InstanceData {
+    Mat4 model;
+    float tint[4];
+};
+
+const int maxStressInstances = 1 << 22;
+int stressInstanceCount = 10000;
+bool stressPersistentMapping = true;
+bool stressSeparateDraws = false;  // По вызову на объект через очередь вместо инстансинга
+bool stressIndirect = false;       // По команде на объект в буфере непрямой отрисовки
+bool stressIndirectLoop = false;   // Команды циклом, даже если есть glMultiDrawElementsIndirect
+IndirectDrawList stressIndirectDraws;
+double stressSubmitMs = 0.0;  // Время потока GL на вызовы отрисовки сцены 5 (копится, сбрасывает бенчмарк)
+vector<Mat4> stressBaseRotation;  // Постоянные наклон и масштаб каждого экземпляра
+vector<Vec4> stressPositions;
+vector<Vec4> stressTints;
+InstanceStream stressStream;
+GLuint cubeInstancedVAO, tetraInstancedVAO;
+ShaderProgram programInstancedTex, programInstancedColor;
+UniformFloat instancedColorInfluence;
 
 int windowWidth = 800;
 int windowHeight = 600;
@@ -42,24 +159,27 @@ const char* vertexShaderSource =
 "out vec3 ourColor;\n"
 "out vec2 TexCoord;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+"layout (std140) uniform Camera {\n"
+"    mat4 view;\n"
+"    mat4 projection;\n"
+"};\n"
 "void main() {\n"
 "    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
 "    ourColor = aColor;\n"
 "    TexCoord = aTexCoord;\n"
 "}\n";
 
-// ФРАГМЕНТНЫЙ ШЕЙДЕР для сцены 2: текстура меняет цвет под влиянием цвета вершин
+// ФРАГМЕНТНЫЙ ШЕЙДЕР для сцены 2: текстура (слой массива материалов) меняет цвет под влиянием цвета вершин
 const char* fragmentShaderSource =
 "#version 330 core\n"
 "in vec3 ourColor;\n"
 "in vec2 TexCoord;\n"
 "out vec4 FragColor;\n"
-"uniform sampler2D texture1;\n"
+"uniform sampler2DArray materials;\n"
+"uniform int materialLayers;\n"
 "uniform float colorInfluence;\n"
 "void main() {\n"
-"    vec4 texColor = texture(texture1, TexCoord);\n"
+"    vec4 texColor = texture(materials, vec3(TexCoord, float(materialLayers)));\n"
 "    // Текстура умножается на цвет вершин, а не заменяется им\n"
 "    // colorInfluence = 0.0: текстура без изменений\n"
 "    // colorInfluence = 0.5: текстура * цвет на 50%\n"
@@ -68,18 +188,18 @@ const char* fragmentShaderSource =
 "    FragColor = vec4(tintedColor, texColor.a);\n"
 "}\n";
 
-// ФРАГМЕНТНЫЙ ШЕЙДЕР для сцены 3: только смешивание двух текстур
+// ФРАГМЕНТНЫЙ ШЕЙДЕР для сцены 3: только смешивание двух текстур - слоев массива материалов
 const char* fragmentTwoTextures =
 "#version 330 core\n"
 "in vec3 ourColor;\n"
 "in vec2 TexCoord;\n"
 "out vec4 FragColor;\n"
-"uniform sampler2D texture1;\n"
-"uniform sampler2D texture2;\n"
+"uniform sampler2DArray materials;\n"
+"uniform int materialLayers;  // Слой первой текстуры - младший байт, второй - следующий\n"
 "uniform float mixRatio;\n"
 "void main() {\n"
-"    vec4 tex1 = texture(texture1, TexCoord);\n"
-"    vec4 tex2 = texture(texture2, TexCoord);\n"
+"    vec4 tex1 = texture(materials, vec3(TexCoord, float(materialLayers & 255)));\n"
+"    vec4 tex2 = texture(materials, vec3(TexCoord, float(materialLayers >> 8)));\n"
 "    // Просто смешиваем две текстуры\n"
 "    FragColor = mix(tex1, tex2, mixRatio);\n"
 "}\n";
@@ -90,8 +210,10 @@ const char* vertexShaderSimple =
 "layout (location = 1) in vec3 aColor;\n"
 "out vec3 ourColor;\n"
 "uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+"layout (std140) uniform Camera {\n"
+"    mat4 view;\n"
+"    mat4 projection;\n"
+"};\n"
 "void main() {\n"
 "    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
 "    ourColor = aColor;\n"
@@ -105,586 +227,1019 @@ const char* fragmentShaderSimple =
 "    FragColor = vec4(ourColor, 1.0);\n"
 "}\n";
 
-// ==================== Вспомогательные функции ====================
-GLuint compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
-    glCompileShader(shader);
-
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        cout << "Shader compilation error:\n" << infoLog << endl;
-    }
-    return shader;
-}
-
-GLuint createProgram(const char* vertexSrc, const char* fragmentSrc) {
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSrc);
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSrc);
-    GLuint program = glCreateProgram();
-
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
-
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        cout << "Program linking error:\n" << infoLog << endl;
-    }
+// ВЕРШИННЫЙ ШЕЙДЕР для сцены 5: матрица модели и оттенок - атрибуты экземпляра
+const char* vertexShaderInstanced =
+"#version 330 core\n"
+"layout (location = 0) in vec3 aPos;\n"
+"layout (location = 1) in vec3 aColor;\n"
+"layout (location = 2) in vec2 aTexCoord;\n"
+"layout (location = 3) in mat4 aModel;\n"
+"layout (location = 7) in vec4 aTint;\n"
+"out vec3 ourColor;\n"
+"out vec2 TexCoord;\n"
+"out vec4 instanceTint;\n"
+"layout (std140) uniform Camera {\n"
+"    mat4 view;\n"
+"    mat4 projection;\n"
+"};\n"
+"void main() {\n"
+"    gl_Position = projection * view * aModel * vec4(aPos, 1.0);\n"
+"    ourColor = aColor;\n"
+"    TexCoord = aTexCoord;\n"
+"    instanceTint = aTint;\n"
+"}\n";
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+// Кубики: текстура с цветом вершин, как в сцене 2, плюс оттенок экземпляра.
+// Текстура - слой массива материалов из альфа-канала оттенка
+const char* fragmentInstancedTexture =
+"#version 330 core\n"
+"in vec3 ourColor;\n"
+"in vec2 TexCoord;\n"
+"in vec4 instanceTint;\n"
+"out vec4 FragColor;\n"
+"uniform sampler2DArray materials;\n"
+"uniform float colorInfluence;\n"
+"void main() {\n"
+"    vec4 texColor = texture(materials, vec3(TexCoord, instanceTint.a));\n"
+"    vec3 tintedColor = mix(texColor.rgb, texColor.rgb * ourColor, colorInfluence);\n"
+"    FragColor = vec4(tintedColor * instanceTint.rgb, texColor.a);\n"
+"}\n";
 
-    return program;
-}
+// Тетраэдры: цвет вершин с оттенком экземпляра
+const char* fragmentInstancedColor =
+"#version 330 core\n"
+"in vec3 ourColor;\n"
+"in vec4 instanceTint;\n"
+"out vec4 FragColor;\n"
+"void main() {\n"
+"    FragColor = vec4(ourColor * instanceTint.rgb, 1.0);\n"
+"}\n";
 
-GLuint loadTextureFromFile(const char* filename, bool flipY = true) {
+// ==================== Вспомогательные функции ====================
+// Загружает изображение в память, не обращаясь к OpenGL
+bool loadTextureImage(const char* filename, TextureImage& image, bool flipY = true) {
+#ifdef LAB12_NO_STB_IMAGE
+    cout << "Failed to load texture: " << filename << " (built without stb_image)" << endl;
+    return false;
+#else
+    // stbi_set_flip_vertically_on_load - глобальный флаг, а загрузка идет из потоков декодера,
+    // поэтому строки переворачиваются вручную
     int width, height, channels;
-    stbi_set_flip_vertically_on_load(flipY);
-    unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
-    if (!image) {
+    unsigned char* data = stbi_load(filename, &width, &height, &channels, 0);
+    if (!data) {
         cout << "Failed to load texture: " << filename << endl;
-        return 0;
+        return false;
     }
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    GLenum format = GL_RGB;
-    if (channels == 4) format = GL_RGBA;
-    else if (channels == 1) format = GL_RED;
-
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image);
-
-    // Улучшенная фильтрация для устранения зернистости
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glGenerateMipmap(GL_TEXTURE_2D);
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.pixels.assign(data, data + width * height * channels);
+    if (flipY) {
+        size_t rowBytes = (size_t)width * channels;
+        for (int y = 0; y < height / 2; y++) {
+            swap_ranges(image.pixels.begin() + y * rowBytes, image.pixels.begin() + (y + 1) * rowBytes,
+                image.pixels.begin() + (height - 1 - y) * rowBytes);
+        }
+    }
 
-    stbi_image_free(image);
+    stbi_image_free(data);
     cout << "Loaded texture: " << filename << " (" << width << "x" << height << ", channels: " << channels << ")" << endl;
-    return texture;
+    return true;
+#endif
 }
 
 // Создаем простые тестовые текстуры программно (если файлы не найдены)
-GLuint createWaterTexture() {
-    const int width = 256, height = 256;
-    unsigned char* image = new unsigned char[width * height * 3];
+// Процедурная текстура размером proceduralTextureSize x proceduralTextureSize
+void createProceduralImage(ProceduralPattern pattern, const char* label, TextureImage& image) {
+    auto start = chrono::steady_clock::now();
+    generateProceduralTexture(pattern, proceduralTextureSize, proceduralTextureSize, image);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "Created " << label << " texture (" << image.width << "x" << image.height << ") in "
+        << ms << " ms" << endl;
+}
 
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            int index = (i * width + j) * 3;
+// Источник текстуры: файл name.jpg/name.png, если он есть, иначе процедурный узор
+struct TextureSource {
+    string name;
+    string file;
+    ProceduralPattern pattern;
+};
+
+TextureSource findTextureSource(const char* name, ProceduralPattern fallback) {
+    TextureSource source{ name, "", fallback };
+#ifndef LAB12_NO_STB_IMAGE
+    for (const char* extension : { ".jpg", ".png" }) {
+        string file = string(name) + extension;
+        if (FILE* f = fopen(file.c_str(), "rb")) {
+            fclose(f);
+            source.file = file;
+            break;
+        }
+    }
+#endif
+    return source;
+}
 
-            // Простая синяя текстура с легкими волнами
-            float wave = sin(i * 0.05f + j * 0.02f) * 0.2f + 0.5f;
+// Загружает файл, если не получится - создает узор. Возвращает true, если изображение взято из файла.
+bool loadSourceImage(const TextureSource& source, TextureImage& image) {
+    if (!source.file.empty() && loadTextureImage(source.file.c_str(), image, false)) {
+        return true;
+    }
+    createProceduralImage(source.pattern, source.name.c_str(), image);
+    return false;
+}
 
-            unsigned char blue = 150 + (unsigned char)(wave * 100);
-            unsigned char green = 200 + (unsigned char)(wave * 50);
-            unsigned char red = 100 + (unsigned char)(wave * 50);
+// Ключ кэша: хеш содержимого файла или параметров генератора
+uint64_t textureSourceKey(const TextureSource& source) {
+    if (!source.file.empty()) {
+        MappedFile file;
+        if (file.open(source.file.c_str())) {
+            return hashBytes(file.data(), file.size());
+        }
+    }
+    const int parameters[] = { (int)source.pattern, proceduralTextureSize, PROCEDURAL_TEXTURE_VERSION };
+    return hashBytes(parameters, sizeof(parameters));
+}
+
+// Мипмапы строятся на CPU для всех текстур; цветные текстуры хранятся в sRGB
+void buildTextureMips(DecodedTexture& decoded) {
+    auto start = chrono::steady_clock::now();
+    buildMipChain(decoded.image, decoded.mips, textureMipFilter, true, sharedThreadPool());
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Built " << decoded.mips.size() << " mip levels (" << mipFilterName(textureMipFilter) << ") in "
+        << ms << " ms" << endl;
+}
 
-            image[index] = red;
-            image[index + 1] = green;
-            image[index + 2] = blue;
+// Изображение источника; layerSize > 0 - приведенное к слою массива layerSize x layerSize в RGB
+void loadLayerImage(const TextureSource& source, int layerSize, TextureImage& image) {
+    loadSourceImage(source, image);
+    if (layerSize <= 0) {
+        return;
+    }
+    if (image.channels != 3) {
+        // Слои массива в одном формате: альфа отбрасывается, яркость повторяется в RGB
+        TextureImage rgb;
+        rgb.width = image.width;
+        rgb.height = image.height;
+        rgb.channels = 3;
+        rgb.pixels.resize((size_t)image.width * image.height * 3);
+        for (size_t i = 0; i < (size_t)image.width * image.height; i++) {
+            for (int ch = 0; ch < 3; ch++) {
+                rgb.pixels[i * 3 + ch] = image.pixels[i * image.channels + (image.channels >= 3 ? ch : 0)];
+            }
         }
+        image = move(rgb);
     }
+    if (image.width != layerSize || image.height != layerSize) {
+        TextureImage resized;
+        resampleImage(image, layerSize, layerSize, resized, textureMipFilter, true, sharedThreadPool());
+        cout << "Texture " << source.name << " resized " << image.width << "x" << image.height << " -> "
+            << layerSize << "x" << layerSize << " for the material array" << endl;
+        image = move(resized);
+    }
+}
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+// Декодирование через кэш: готовый DDS отображается в память, иначе источник
+// декодируется, сжимается в BC1 и сохраняется для следующих запусков.
+// layerSize > 0 - текстура для слоя массива (см. loadLayerImage)
+bool decodeTextureSource(const TextureSource& source, DecodedTexture& decoded, int layerSize = 0) {
+    if (!textureCacheEnabled || !textureStreamer.supportsCompression()) {
+        loadLayerImage(source, layerSize, decoded.image);
+        buildTextureMips(decoded);
+        return true;
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Мипмапы из кэша зависят от фильтра, поэтому он входит в ключ, как и размер слоя
+    uint64_t key = textureSourceKey(source);
+    key = hashBytes(&textureMipFilter, sizeof(textureMipFilter), key);
+    if (layerSize > 0) {
+        key = hashBytes(&layerSize, sizeof(layerSize), key);
+    }
+    string path = textureCachePath(textureCacheDirectory, source.name, key);
+    if (loadCompressedTexture(path, key, decoded.compressed)) {
+        cout << "Texture cache hit: " << path << endl;
+        return true;
+    }
 
-    delete[] image;
-    cout << "Created water texture (256x256)" << endl;
-    return texture;
+    loadLayerImage(source, layerSize, decoded.image);
+    buildTextureMips(decoded);
+    auto start = chrono::steady_clock::now();
+    compressTextureBC1(decoded.image, decoded.mips, decoded.compressed, sharedThreadPool());
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    bool saved = saveCompressedTexture(path, key, decoded.compressed);
+    cout << "Texture cache miss: " << source.name << " compressed to BC1 in " << ms << " ms"
+        << (saved ? ", saved to " + path : ", cache not writable") << endl;
+    // Загружаются только сжатые блоки
+    decoded.image = TextureImage();
+    decoded.mips.clear();
+    return true;
 }
 
-GLuint createWoodTexture() {
-    const int width = 256, height = 256;
-    unsigned char* image = new unsigned char[width * height * 3];
+// Слой массива материалов: изображение приводится к размеру массива при декодировании
+void requestMaterialLayer(Material material, const char* name, ProceduralPattern fallback) {
+    TextureSource source = findTextureSource(name, fallback);
+    int layerSize = proceduralTextureSize;
+    string label = string("materials/") + name;
+    textureStreamer.requestLayer(materialArray, material, label.c_str(), [source, layerSize](DecodedTexture& decoded) {
+        return decodeTextureSource(source, decoded, layerSize);
+    });
+}
 
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            int index = (i * width + j) * 3;
+// Замена текстуры кубиков (вместо воды) на лету - новый слой MATERIAL_WATER для всех сцен:
+// старый остается, пока новый не загрузится
+void requestCubeTexture(ProceduralPattern pattern) {
+    cubeTexturePattern = pattern;
+    requestMaterialLayer(MATERIAL_WATER, proceduralPatternName(pattern), pattern);
+}
 
-            // Простая коричневая текстура дерева
-            float grain = sin(i * 0.1f) * 0.3f + 0.7f;
-            float rings = sin(sqrt((i - 128) * (i - 128) + (j - 128) * (j - 128)) * 0.05f) * 0.2f + 0.5f;
-            float pattern = (grain + rings) * 0.5f;
+// Раз в кадр: копирование загруженных текстур
+void updateTextures() {
+    textureStreamer.update(textureUploadBudgetMs);
+}
 
-            unsigned char red = (unsigned char)(139 * pattern);
-            unsigned char green = (unsigned char)(69 * pattern);
-            unsigned char blue = (unsigned char)(19 * pattern);
+// ==================== Геометрия ====================
+// Вершины тетраэдра с цветами - специально повернуты для лучшего обзора
+const float tetraVertices[] = {
+    // Верхняя вершина
+    0.0f,  0.5f,  0.0f,   1.0f, 0.0f, 0.0f,  // Красный
+    // Основание - треугольник
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,  // Зеленый
+    0.5f, -0.5f, -0.5f,   0.0f, 0.0f, 1.0f,  // Синий
+    0.0f, -0.5f,  0.5f,   1.0f, 1.0f, 0.0f   // Желтый
+};
+
+const unsigned int tetraIndices[] = {
+    0, 1, 2,  // Передняя грань
+    0, 2, 3,  // Правая грань
+    0, 3, 1,  // Левая грань
+    1, 3, 2   // Основание
+};
+
+// Куб и круг считает компилятор: вершины, UV и HSV-градиент уже лежат в готовых массивах
+constexpr auto cubeMeshData = makeCubeMesh(1.0f);
+
+// Круг из 64 сегментов с градиентом Hue по краю - начальный уровень детализации
+const int circleSegments = 64;
+constexpr auto circleMeshData = makeCircleMesh<circleSegments>();
 
-            image[index] = red;
-            image[index + 1] = green;
-            image[index + 2] = blue;
-        }
+// ==================== Инициализация объектов ====================
+// Упаковка не трогает GL и идет в рабочих потоках
+void packSolidMeshes() {
+    packMesh(tetraVertices, 4, 6, tetraIndices, 12, vertexQuantization, tetraPacked);
+    if (!meshOptimization) {
+        packMesh(cubeMeshData.vertices, cubeMeshData.vertexCount, cubeMeshData.floatsPerVertex,
+            cubeMeshData.indices, cubeMeshData.indexCount, vertexQuantization, cubePacked);
+        return;
     }
+    // Таблицы генератора неизменяемые - оптимизируется копия
+    vector<float> vertices(cubeMeshData.vertices, cubeMeshData.vertices + cubeMeshData.vertexCount * cubeMeshData.floatsPerVertex);
+    vector<unsigned int> indices(cubeMeshData.indices, cubeMeshData.indices + cubeMeshData.indexCount);
+    optimizeMesh(vertices, cubeMeshData.floatsPerVertex, indices, &cubeOptimized);
+    packMesh(vertices.data(), (int)vertices.size() / cubeMeshData.floatsPerVertex, cubeMeshData.floatsPerVertex,
+        indices.data(), (int)indices.size(), vertexQuantization, cubePacked);
+}
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+// Остальные уровни круга строятся по требованию во время отрисовки
+void packCircleMesh() {
+    circleLod.init(16, 1024, vertexQuantization, meshOptimization);
+    circleLod.build(circleLod.levelFor(circleSegments), circleMeshData.vertices, circleMeshData.indices);
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+void initTetrahedron() {
+    tetraMesh = geometryArena.add(tetraPacked, meshVertexStreams);
+}
 
-    delete[] image;
-    cout << "Created wood texture (256x256)" << endl;
-    return texture;
+void initTexturedCube() {
+    cubeMesh = geometryArena.add(cubePacked, meshVertexStreams);
 }
 
-GLuint loadWaterTexture() {
-    // Пробуем загрузить из файла, если не получится - создадим
-    GLuint tex = loadTextureFromFile("water.jpg", false);
-    if (tex == 0) {
-        tex = loadTextureFromFile("water.png", false);
+void initCircle() {
+    circleLod.attach(geometryArena, meshVertexStreams);
+}
+
+// Разбор в рабочем потоке, запись вершин прямо в отображенные буферы арены - в контексте
+void parseImportedMesh() {
+    if (meshImporter.load(importMeshPath, sharedThreadPool()) && meshOptimization) {
+        meshImporter.optimize(vertexStride(meshImporter.outputFormat(vertexQuantization)), importOptimized);
     }
-    if (tex == 0) {
-        tex = createWaterTexture();
+    if (meshImporter.vertexCount() > 0) {
+        meshImporter.buildLods(meshOptimization);
     }
-    return tex;
 }
 
-GLuint loadWoodTexture() {
-    // Пробуем загрузить из файла, если не получится - создадим
-    GLuint tex = loadTextureFromFile("wood.jpg", false);
-    if (tex == 0) {
-        tex = loadTextureFromFile("wood.png", false);
+void initImportedMesh() {
+    if (meshImporter.vertexCount() == 0) {
+        return;
     }
-    if (tex == 0) {
-        tex = createWoodTexture();
+    importedMesh = meshImporter.upload(geometryArena, vertexQuantization, sharedThreadPool());
+    meshImporter.printStats(importMeshPath);
+    if (meshOptimization) {
+        printOptimizeReport(importMeshPath, importOptimized);
     }
-    return tex;
+    printLodChain(importMeshPath, meshImporter.lods());
+    importedLods = meshImporter.lods();
+    meshImporter.release();
 }
 
-// ==================== Инициализация объектов ====================
-void initTetrahedron() {
-    // Вершины тетраэдра с цветами - специально повернуты для лучшего обзора
-    float vertices[] = {
-        // Верхняя вершина
-        0.0f,  0.5f,  0.0f,   1.0f, 0.0f, 0.0f,  // Красный
-        // Основание - треугольник
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,  // Зеленый
-        0.5f, -0.5f, -0.5f,   0.0f, 0.0f, 1.0f,  // Синий
-        0.0f, -0.5f,  0.5f,   1.0f, 1.0f, 0.0f   // Желтый
-    };
+// Куб сцен 2 и 3 или импортированный меш - уровень детализации по размеру на экране
+// (меш вписан в единичный куб, так что пиксели на единицу модели - пиксели на габарит)
+MeshRange texturedMesh(const Mat4& modelViewProjection) {
+    if (importedMesh.empty()) {
+        return cubeMesh;
+    }
+    float major = 0.0f, minor = 0.0f;
+    projectedEllipseAxes(modelViewProjection, windowWidth, windowHeight, major, minor);
+    int level = meshLodTolerance > 0.0f ? importedLods.select(major, meshLodTolerance) : 0;
+    if (level != importedLodDrawn) {
+        importedLodDrawn = level;
+        cout << "Mesh LOD: level " << level << ", " << importedLods.triangles(level) << " triangles ("
+            << major << " px per unit)" << endl;
+    }
+    const MeshLod& lod = importedLods.levels[level];
+    return importedMesh.subrange(lod.firstIndex, lod.indexCount);
+}
 
-    unsigned int indices[] = {
-        0, 1, 2,  // Передняя грань
-        0, 2, 3,  // Правая грань
-        0, 3, 1,  // Левая грань
-        1, 3, 2   // Основание
-    };
+// Сколько памяти (и чтения при выборке вершин) сэкономила упаковка
+void reportMeshPacking() {
+    const PackedMesh& circlePacked = circleLod.level(circleLod.levelFor(circleSegments)).packed;
+    const PackedMesh* meshes[] = { &tetraPacked, &cubePacked, &circlePacked };
+    const int floatsPerVertex[] = { 6, 8, 6 };
+    size_t unpacked = 0, packed = 0;
+    for (int i = 0; i < 3; i++) {
+        unpacked += unpackedMeshSize(meshes[i]->vertexCount, floatsPerVertex[i], meshes[i]->indexCount);
+        packed += meshes[i]->size();
+    }
+    cout << "Mesh packing: " << unpacked << " B -> " << packed << " B ("
+        << 100.0 * packed / unpacked << "%), cube vertex " << vertexStride(VERTEX_FLOAT_COLOR_UV) << " B -> "
+        << vertexStride(cubePacked.format) << " B, "
+        << (cubePacked.indexType == GL_UNSIGNED_SHORT ? "16-bit" : "32-bit") << " indices" << endl;
+    if (meshOptimization) {
+        printOptimizeReport("cube", cubeOptimized);
+        printOptimizeReport("circle", circleLod.level(circleLod.levelFor(circleSegments)).optimized);
+    }
+}
 
-    glGenVertexArrays(1, &tetraVAO);
-    glGenBuffers(1, &tetraVBO);
-    glGenBuffers(1, &tetraEBO);
+// ==================== Стресс-сцена с инстансингом ====================
+// Раскладывает count объектов в куб [-1, 1]^3 перед камерой: первая половина - кубики,
+// вторая - тетраэдры. У каждого экземпляра свой наклон и оттенок, вращаются все вместе.
+void buildStressInstances(int count) {
+    // Конвейерная запись может еще читать расстановку прошлого кадра
+    commandRecorder.waitIdle();
+    stressInstanceCount = count;
+    stressBaseRotation.resize(count);
+    stressPositions.resize(count);
+    stressTints.resize(count);
+
+    int side = max(1, (int)ceil(cbrt((double)count)));
+    float spacing = 2.0f / side;
+    float size = spacing * 0.6f;
+
+    mt19937 random(12345);
+    uniform_real_distribution<float> angle(0.0f, 2.0f * MATH3D_PI);
+    uniform_real_distribution<float> tint(0.4f, 1.0f);
+
+    // Кубики занимают четные ячейки сетки, тетраэдры - нечетные, чтобы формы перемешались
+    int cubeCount = (count + 1) / 2;
+    for (int i = 0; i < count; i++) {
+        int cell = i < cubeCount ? 2 * i : 2 * (i - cubeCount) + 1;
+        int gx = cell % side;
+        int gy = (cell / side) % side;
+        int gz = cell / (side * side);
+        stressPositions[i] = Vec4(-1.0f + spacing * (gx + 0.5f), -1.0f + spacing * (gy + 0.5f),
+            -1.0f + spacing * (gz + 0.5f), 1.0f);
+        // Обратное преобразование упакованных позиций входит в постоянную часть матрицы
+        const Mat4& dequantize = i < cubeCount ? cubePacked.dequantize : tetraPacked.dequantize;
+        stressBaseRotation[i] = Mat4::rotationX(angle(random)) * Mat4::rotationZ(angle(random))
+            * Mat4::scale(size, size, size) * dequantize;
+        // Альфа оттенка кубика - слой массива материалов: вода и дерево через один
+        // (у тетраэдров не используется)
+        float layer = i < cubeCount ? (float)(i % 2 == 0 ? MATERIAL_WATER : MATERIAL_WOOD) : 1.0f;
+        stressTints[i] = Vec4(tint(random), tint(random), tint(random), layer);
+    }
 
-    glBindVertexArray(tetraVAO);
+    cout << "Stress scene: " << count << " instances (" << cubeCount << " cubes, "
+        << count - cubeCount << " tetrahedra)" << endl;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, tetraVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+// Атрибуты экземпляра (матрица - 4 столбца по vec4, оттенок) из потокового буфера
+void setInstanceAttributes(GLintptr offset) {
+    glBindBuffer(GL_ARRAY_BUFFER, stressStream.buffer());
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(offset + column * 4 * sizeof(float)));
+    }
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        (void*)(offset + offsetof(InstanceData, tint)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tetraEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+// VAO с вершинами и индексами пула арены, в котором лежит меш, и атрибутами экземпляров
+GLuint createInstancedVAO(const MeshRange& mesh) {
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    renderState().bindVertexArray(vao);
 
-    // Позиции вершин
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    geometryArena.setupVertexAttributes(mesh);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometryArena.indexBuffer(mesh));
 
-    // Цвета вершин
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    for (int attribute = 3; attribute <= 7; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
 
-    glBindVertexArray(0);
+    renderState().bindVertexArray(0);
+    return vao;
 }
 
-void initTexturedCube() {
-    float vertices[] = {
-        // Передняя грань
-        -0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f,  // Нижний левый
-         0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,  // Нижний правый
-         0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f,  // Верхний правый
-        -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f,  // Верхний левый
-
-        // Задняя грань
-        -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.0f,  1.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f, 0.0f, 1.0f,  0.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,  1.0f, 1.0f,
-
-        // Верхняя грань
-        -0.5f,  0.5f, -0.5f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f,
-
-        // Нижняя грань
-        -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f,
-
-        // Левая грань
-        -0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f,
-
-        // Правая грань
-         0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 1.0f,  1.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f
-    };
-
-    unsigned int indices[] = {
-        // Передняя грань
-        0, 1, 2,
-        2, 3, 0,
+// Буферы стресс-сцены: экземпляры уже расставлены buildStressInstances(), меши загружены
+void initStressScene() {
+    stressStream.create(stressInstanceCount * sizeof(InstanceData), stressPersistentMapping);
 
-        // Задняя грань
-        4, 5, 6,
-        6, 7, 4,
-
-        // Верхняя грань
-        8, 9, 10,
-        10, 11, 8,
+    cubeInstancedVAO = createInstancedVAO(cubeMesh);
+    tetraInstancedVAO = createInstancedVAO(tetraMesh);
+    if (stressIndirect && !stressIndirectDraws.create(stressIndirectLoop)) {
+        stressIndirect = false;
+    }
+}
 
-        // Нижняя грань
-        12, 13, 14,
-        14, 15, 12,
+// Команды непрямой отрисовки: кубики, затем тетраэдры. Атрибуты тетраэдров начинаются
+// со своей половины буфера экземпляров, поэтому baseInstance - номер объекта в своей половине
+void buildStressIndirect(int cubeCount, int tetraCount) {
+    stressIndirectDraws.clear();
+    for (int i = 0; i < cubeCount; i++) {
+        stressIndirectDraws.add(cubeMesh, i);
+    }
+    for (int i = 0; i < tetraCount; i++) {
+        stressIndirectDraws.add(tetraMesh, i);
+    }
+}
 
-        // Левая грань
-        16, 17, 18,
-        18, 19, 16,
+const char* stressSubmissionName() {
+    if (stressSeparateDraws) return "per-object draws";
+    if (stressIndirect) return stressIndirectDraws.isMultiDraw() ? "multi-draw indirect" : "indirect loop";
+    return "instanced";
+}
 
-        // Правая грань
-        20, 21, 22,
-        22, 23, 20
-    };
+// ==================== Шейдерные программы сцены ====================
+// Все программы сцены: сборка запускается разом, а дожидаться ее можно позже
+ShaderProgram* const scenePrograms[] = {
+    &programTet, &programCubeTex, &programCubeTwoTex, &programCircle, &programInstancedTex, &programInstancedColor
+};
+
+void beginPrograms() {
+    ProgramCache& programCache = sharedProgramCache();
+    programCache.open(programCacheEnabled ? programCacheDirectory : nullptr);
+
+    // Тетраэдр и круг используют одну и ту же программу
+    programTet.begin(vertexShaderSimple, fragmentShaderSimple);
+    programCubeTex.begin(vertexShaderSource, fragmentShaderSource);
+    programCubeTwoTex.begin(vertexShaderSource, fragmentTwoTextures);
+    programCircle.begin(vertexShaderSimple, fragmentShaderSimple);
+    programInstancedTex.begin(vertexShaderInstanced, fragmentInstancedTexture);
+    programInstancedColor.begin(vertexShaderInstanced, fragmentInstancedColor);
+}
 
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &cubeVBO);
-    glGenBuffers(1, &cubeEBO);
+bool programsReady() {
+    for (ShaderProgram* program : scenePrograms) {
+        if (!program->isReady()) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    glBindVertexArray(cubeVAO);
+void finishPrograms() {
+    for (ShaderProgram* program : scenePrograms) {
+        program->finish();
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // Матрицы камеры общие для всех программ и лежат в одном буфере
+    cameraBuffer.create(sizeof(CameraBlock), CAMERA_BLOCK_BINDING);
+    for (ShaderProgram* program : scenePrograms) {
+        program->bindUniformBlock("Camera", CAMERA_BLOCK_BINDING);
+    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    tetModel = programTet.mat4Uniform("model");
+    cubeTexModel = programCubeTex.mat4Uniform("model");
+    cubeTexColorInfluence = programCubeTex.floatUniform("colorInfluence");
+    cubeTexLayers = programCubeTex.intUniform("materialLayers");
+    cubeTwoTexModel = programCubeTwoTex.mat4Uniform("model");
+    cubeTwoTexMixRatio = programCubeTwoTex.floatUniform("mixRatio");
+    cubeTwoTexLayers = programCubeTwoTex.intUniform("materialLayers");
+    circleModel = programCircle.mat4Uniform("model");
+    instancedColorInfluence = programInstancedTex.floatUniform("colorInfluence");
+
+    // Текстурные блоки не меняются, задаем их один раз
+    programCubeTex.setSampler("materials", DRAW_ARRAY_UNIT, GL_SAMPLER_2D_ARRAY);
+    programCubeTwoTex.setSampler("materials", DRAW_ARRAY_UNIT, GL_SAMPLER_2D_ARRAY);
+    programInstancedTex.setSampler("materials", DRAW_ARRAY_UNIT, GL_SAMPLER_2D_ARRAY);
+}
 
-    // Позиции вершин
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+void initTextures() {
+    // Загрузка текстур в фоне: декодер - половина ядер, но не больше двух потоков
+    int decoderThreads = max(1, min(2, (int)thread::hardware_concurrency() / 2));
+    textureStreamer.create(decoderThreads, 4 * 1024 * 1024);
+    // Слой - размер процедурных текстур: файлы другого размера пересчитываются под него
+    materialArray = textureStreamer.createArray("materials", proceduralTextureSize, proceduralTextureSize, MATERIAL_COUNT);
+    requestMaterialLayer(MATERIAL_WATER, "water", PATTERN_WATER);
+    requestMaterialLayer(MATERIAL_WOOD, "wood", PATTERN_WOOD);
+}
 
-    // Цвета вершин
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+// ==================== Инициализация OpenGL ====================
+// Запуск - граф этапов: CPU-работа идет в пуле потоков, вызовы GL - в этом потоке,
+// а программы собираются драйвером, пока загружаются буферы
+void initOpenGL() {
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+    TaskGraph startup;
+    int linkPrograms = startup.add("link programs", TASK_CONTEXT, beginPrograms);
+    // Декодирование текстур идет в потоках загрузчика, сюда входит только постановка в очередь
+    startup.add("request textures", TASK_CONTEXT, initTextures);
+    int solidMeshes = startup.add("pack meshes", TASK_WORKER, packSolidMeshes);
+    int circleMeshBuilt = startup.add("circle mesh", TASK_WORKER, packCircleMesh);
+    // Матрицы экземпляров включают обратное преобразование упакованных позиций
+    int stressInstances = startup.add("stress instances", TASK_WORKER,
+        [] { buildStressInstances(stressInstanceCount); }, { solidMeshes });
+    int tetrahedron = startup.add("tetrahedron upload", TASK_CONTEXT, initTetrahedron, { solidMeshes });
+    int cube = startup.add("cube upload", TASK_CONTEXT, initTexturedCube, { solidMeshes });
+    int circle = startup.add("circle upload", TASK_CONTEXT, initCircle, { circleMeshBuilt });
+    vector<int> meshUploads = { stressInstances, tetrahedron, cube, circle };
+    if (importMeshPath) {
+        int importParsed = startup.add("import parse", TASK_WORKER, parseImportedMesh);
+        meshUploads.push_back(startup.add("import upload", TASK_CONTEXT, initImportedMesh, { importParsed, cube }));
+    }
+    // VAO экземпляров ссылаются на буферы арены, поэтому создаются после загрузки всех мешей
+    startup.add("stress buffers", TASK_CONTEXT, initStressScene, meshUploads);
+    int ready = startup.addWait("programs ready", programsReady, { linkPrograms });
+    int uniforms = startup.add("program uniforms", TASK_CONTEXT, finishPrograms, { ready });
+    // Бинарники сохраняются последними: к этому моменту все программы уже собраны
+    startup.add("save program binaries", TASK_CONTEXT, [] { sharedProgramCache().flush(); }, { uniforms });
+    startup.run(sharedThreadPool());
+
+    // Холодный запуск - все программы компилируются, теплый - все загружены из бинарников
+    const ProgramCache& programCache = sharedProgramCache();
+    const ProgramCacheStats& programs = programCache.stats();
+    const char* startupKind = programs.compiled == 0 ? "warm" : programs.loaded == 0 ? "cold" : "partial";
+    cout << "Programs: " << programs.requests << " requested, " << programs.unique << " unique, "
+        << programs.loaded << " from binary cache, " << programs.compiled << " compiled, "
+        << programs.rejected << " rejected, " << programs.ms << " ms"
+        << (programCache.supportsBinaries() ? "" : ", program binaries unsupported")
+        << (programCache.compilesInParallel() ? ", parallel compile" : "") << endl;
+    startup.printReport(string("Startup (") + startupKind + ")");
+    reportMeshPacking();
+    geometryArena.printStats();
+    circleLod.printStats();
+    cout << "OpenGL initialized successfully!" << endl;
+}
 
-    // Текстурные координаты
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+// ==================== Отрисовка ====================
+// Показ готового кадра: в окне - смена буферов, без окна - ожидание конца рендеринга в FBO
+void presentFrame() {
+#ifdef _WIN32
+    SwapBuffers(g_hDC);
+#else
+    finishHeadlessFrame();
+#endif
+}
 
-    glBindVertexArray(0);
+// Матрица проекции, общая для всех сцен
+Mat4 cameraProjection() {
+    float aspect = (float)windowWidth / (float)windowHeight;
+    Mat4 projection = Mat4::zero();
+    projection.m[0] = 1.0f / aspect;
+    projection.m[5] = 1.0f;
+    projection.m[10] = -1.0f / (10.0f - 0.1f);
+    projection.m[11] = -1.0f;
+    projection.m[14] = -(10.0f * 0.1f) / (10.0f - 0.1f);
+    return projection;
 }
 
-void initCircle() {
-    const int segments = 64;
-    vector<float> vertices;
-    vector<unsigned int> indices;
+Mat4 cameraView() {
+    return Mat4::translation(0.0f, 0.0f, -3.0f);  // Отодвигаем камеру назад
+}
 
-    // Центр круга - белый
-    vertices.push_back(0.0f); vertices.push_back(0.0f); vertices.push_back(0.0f);
-    vertices.push_back(1.0f); vertices.push_back(1.0f); vertices.push_back(1.0f);
+// Небольшой постоянный наклон тетраэдра, чтобы было видно, что это тетраэдр
+const Mat4 tetraTilt = Mat4::rotationX(radians(45.0f));
 
-    // Вершины окружности с градиентом Hue
-    for (int i = 0; i <= segments; i++) {
-        float angle = 2.0f * 3.14159f * i / segments;
-        float x = cos(angle);
-        float y = sin(angle);
+// Шаг анимации фиксированной длины: вращается только объект текущей сцены
+void updateAnimation(double dt) {
+    sceneRotation[currentScene] += rotationSpeed * (float)dt;
+}
 
-        // Преобразование угла в цвет HSV -> RGB
-        float hue = angle / (2.0f * 3.14159f);  // 0 to 1
-        float h = hue * 6.0f;
-        int sector = static_cast<int>(h);
-        float fraction = h - sector;
-        float r = 0, g = 0, b = 0;
+// Выполняет шаги анимации, накопившиеся с прошлого кадра
+void advanceAnimation() {
+    int steps = frameClock.beginFrame();
+    for (int i = 0; i < steps; i++) {
+        updateAnimation(FrameClock::FIXED_STEP);
+    }
+}
 
-        switch (sector % 6) {
-        case 0: r = 1; g = fraction; b = 0; break;
-        case 1: r = 1 - fraction; g = 1; b = 0; break;
-        case 2: r = 0; g = 1; b = fraction; break;
-        case 3: r = 0; g = 1 - fraction; b = 1; break;
-        case 4: r = fraction; g = 0; b = 1; break;
-        case 5: r = 1; g = 0; b = 1 - fraction; break;
-        }
+// Угол для отрисовки: состояние последнего шага плюс время, еще не отработанное шагами
+float sceneAngle(int scene) {
+    float angle = sceneRotation[scene];
+    if (scene == currentScene) {
+        angle += rotationSpeed * (float)frameClock.leftover();
+    }
+    return radians(angle);
+}
 
-        vertices.push_back(x); vertices.push_back(y); vertices.push_back(0.0f);
-        vertices.push_back(r); vertices.push_back(g); vertices.push_back(b);
+// ==================== Граф сцены ====================
+// Объекты сцен 1-4 - узлы графа. Клавиши и автоповорот меняют локальные матрицы узлов,
+// мировые пересчитываются только у измененных узлов и их потомков. Положение тетраэдра
+// и масштаб круга хранятся только в локальных матрицах своих узлов.
+// Кубики стресс-сцены в граф не входят: они поворачиваются все и каждый кадр
+SceneGraph sceneGraph;
+int tetraAnchorNode = -1;  // Положение тетраэдра (клавиши W/S/A/D/Q/E), родитель его узла
+int sceneNodes[6] = { -1, -1, -1, -1, -1, -1 };  // Объект сцены 1-4
+float sceneNodeAngles[6] = { 0 };  // Угол, по которому построена локальная матрица объекта
+
+// Локальная матрица вращающегося объекта сцены 1-3: поворот вокруг оси Y
+// (по часовой стрелке, если смотреть сверху), у тетраэдра с наклоном
+Mat4 sceneLocalMatrix(int scene, float angle) {
+    float cosA = cos(angle);
+    float sinA = -sin(angle);
+    if (scene == 1) {
+        // Перенос дает родительский узел: здесь наклон * поворот
+        return composeTranslateRotateY(Vec4(0.0f, 0.0f, 0.0f, 1.0f), tetraTilt, cosA, sinA);
     }
+    return Mat4::rotationY(cosA, sinA);
+}
 
-    // Индексы для треугольников
-    for (int i = 1; i <= segments; i++) {
-        indices.push_back(0);          // Центр
-        indices.push_back(i);          // Текущая вершина
-        indices.push_back(i + 1);      // Следующая вершина
+// Строится до разбора аргументов: они пишут прямо в узлы
+void initSceneGraph() {
+    sceneGraph.clear();
+    tetraAnchorNode = sceneGraph.addNode(-1, Mat4::translation(0.0f, 0.0f, -3.0f));
+    for (int scene = 1; scene <= 3; scene++) {
+        sceneNodeAngles[scene] = sceneAngle(scene);
+        sceneNodes[scene] = sceneGraph.addNode(scene == 1 ? tetraAnchorNode : -1,
+            sceneLocalMatrix(scene, sceneNodeAngles[scene]));
     }
-    indices[indices.size() - 1] = 1;  // Замыкаем круг
+    // Градиентный круг не вращается, только масштабируется (по Z масштаб фиксирован)
+    sceneNodes[4] = sceneGraph.addNode(-1);
+    sceneGraph.update();
+}
 
-    glGenVertexArrays(1, &circleVAO);
-    glGenBuffers(1, &circleVBO);
-    glGenBuffers(1, &circleEBO);
+void moveTetrahedron(float dx, float dy, float dz) {
+    Mat4 local = sceneGraph.local(tetraAnchorNode);
+    local.m[12] += dx;
+    local.m[13] += dy;
+    local.m[14] += dz;
+    sceneGraph.setLocal(tetraAnchorNode, local);
+}
 
-    glBindVertexArray(circleVAO);
+void setCircleScale(float x, float y) {
+    sceneGraph.setLocal(sceneNodes[4], Mat4::scale(x, y, 1.0f));
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+// Изменение масштаба круга клавишами: не меньше 0.1 по каждой оси
+void scaleCircle(float dx, float dy) {
+    const Mat4& local = sceneGraph.local(sceneNodes[4]);
+    float x = max(local.m[0] + dx, 0.1f);
+    float y = max(local.m[5] + dy, 0.1f);
+    setCircleScale(x, y);
+    cout << "Circle scale: " << x << " x " << y << endl;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, circleEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+// Матрица модели объекта сцены с учетом текущего угла автоповорота
+Mat4 sceneModelMatrix(int scene) {
+    int node = sceneNodes[scene];
+    if (scene != 4) {
+        float angle = sceneAngle(scene);
+        if (angle != sceneNodeAngles[scene]) {
+            sceneNodeAngles[scene] = angle;
+            sceneGraph.setLocal(node, sceneLocalMatrix(scene, angle));
+        }
+    }
+    sceneGraph.update();
+    return sceneGraph.world(node);
+}
 
-    // Позиции вершин
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+// Уровень детализации круга по его размеру на экране; о смене уровня сообщается в консоль.
+// Уровни строятся в общем пуле: у пула программного растеризатора может не быть рабочих потоков
+const CircleLodLevel& selectCircleLod(const Mat4& modelViewProjection) {
+    float major = 0.0f, minor = 0.0f;
+    projectedEllipseAxes(modelViewProjection, windowWidth, windowHeight, major, minor);
+    int segments = circleTolerance > 0.0f ? circleSegmentsFor(major, circleTolerance) : circleSegments;
+    const CircleLodLevel& level = circleLod.select(circleLod.levelFor(segments), sharedThreadPool());
+    if (level.segments != circleDrawnSegments) {
+        circleDrawnSegments = level.segments;
+        cout << "Circle LOD: " << level.segments << " segments (ellipse " << major << " x " << minor << " px)" << endl;
+    }
+    return level;
+}
 
-    // Цвета вершин
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+// Снимок кадра для записи: запись идет в рабочих потоках и при конвейерной записи
+// заканчивается после возврата из render(), поэтому все, что меняется между кадрами, копируется
+struct FrameSnapshot {
+    int scene = 1;
+    Mat4 model = Mat4::identity();  // Сцены 1-4
+    MeshRange mesh;                 // Выбранный уровень детализации (сцены 1-4)
+    int objectCount = 0;            // Сцена 5: кубики и тетраэдры вперемешку
+    int cubeCount = 0;
+    float cosA = 1.0f, sinA = 0.0f;
+    float colorInfluence = 0.0f;
+    float textureMixRatio = 0.0f;
+};
+
+// Сцены 1-4: единственный объект
+void recordSceneObject(const FrameSnapshot& frame, CommandBuffer& buffer) {
+    DrawPacket& packet = buffer.push();
+    DrawCommand& draw = packet.command;
+    draw.model = frame.model;
+    draw.mesh = frame.mesh;
+    if (frame.scene == 1) {
+        // Градиентный тетраэдр
+        draw.program = programTet.id();
+        draw.modelUniform = tetModel;
+    }
+    else if (frame.scene == 2) {
+        // Кубик с текстурой воды и цветом вершин
+        draw.program = programCubeTex.id();
+        packet.arrayMaterial = MATERIAL_ARRAY;
+        draw.layerUniform = cubeTexLayers;
+        draw.layers = MATERIAL_WATER;
+        draw.modelUniform = cubeTexModel;
+        draw.parameterUniform = cubeTexColorInfluence;
+        draw.parameter = frame.colorInfluence;
+    }
+    else if (frame.scene == 3) {
+        // Кубик с двумя смешанными текстурами: вода и дерево - слои одного массива
+        draw.program = programCubeTwoTex.id();
+        packet.arrayMaterial = MATERIAL_ARRAY;
+        draw.layerUniform = cubeTwoTexLayers;
+        draw.layers = MATERIAL_WATER | MATERIAL_WOOD << 8;
+        draw.modelUniform = cubeTwoTexModel;
+        draw.parameterUniform = cubeTwoTexMixRatio;
+        draw.parameter = frame.textureMixRatio;
+    }
+    else {
+        // Градиентный круг
+        draw.program = programCircle.id();
+        draw.modelUniform = circleModel;
+    }
+}
 
-    glBindVertexArray(0);
+// Сцена 5 по вызову на объект - проверка кэша состояния и сортировки на многих вызовах.
+// Кубики и тетраэдры идут вперемешку (объект 2k - кубик k, 2k + 1 - тетраэдр k), у кубиков
+// чередуются вода и дерево (слои массива - меняется только uniform): без сортировки почти
+// каждый вызов меняет программу и VAO
+void recordStressObjects(const FrameSnapshot& frame, int begin, int end, CommandBuffer& buffer) {
+    for (int object = begin; object < end; object++) {
+        int k = object / 2;
+        int index = object % 2 == 0 ? k : frame.cubeCount + k;
+        if (index >= frame.objectCount) {
+            continue;
+        }
+        DrawPacket& packet = buffer.push();
+        DrawCommand& draw = packet.command;
+        draw.model = composeTranslateRotateY(stressPositions[index], stressBaseRotation[index], frame.cosA, frame.sinA);
+        if (object % 2 == 0) {
+            draw.program = programCubeTex.id();
+            packet.arrayMaterial = MATERIAL_ARRAY;
+            draw.layerUniform = cubeTexLayers;
+            draw.layers = k % 2 == 0 ? MATERIAL_WATER : MATERIAL_WOOD;
+            draw.mesh = cubeMesh;
+            draw.modelUniform = cubeTexModel;
+            draw.parameterUniform = cubeTexColorInfluence;
+            draw.parameter = frame.colorInfluence;
+        }
+        else {
+            draw.program = programTet.id();
+            draw.mesh = tetraMesh;
+            draw.modelUniform = tetModel;
+        }
+        // stressBaseRotation уже включает обратное преобразование упакованных позиций
+        // (как матрицы экземпляров), второй раз flush() его применять не должен
+        draw.mesh.dequantize = Mat4::identity();
+    }
 }
 
-// ==================== Инициализация OpenGL ====================
-void initOpenGL() {
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+// Снимок кадра и запуск его записи. Уровни детализации выбираются здесь, в потоке GL:
+// выбор печатает в консоль и может запустить построение уровня круга
+void recordFrame(const CameraBlock& camera) {
+    FrameSnapshot frame;
+    frame.scene = currentScene;
+    frame.colorInfluence = colorInfluence;
+    frame.textureMixRatio = textureMixRatio;
+    int objectCount = 1;
+    if (currentScene == 5) {
+        float angle = sceneAngle(5);
+        frame.cosA = cos(angle);
+        frame.sinA = -sin(angle);
+        frame.objectCount = stressInstanceCount;
+        frame.cubeCount = (stressInstanceCount + 1) / 2;
+        objectCount = frame.cubeCount * 2;
+    }
+    else {
+        // Автоповорот объекта текущей сцены (угол продвигает advanceAnimation())
+        frame.model = sceneModelMatrix(currentScene);
+        Mat4 modelViewProjection = camera.projection * camera.view * frame.model;
+        if (currentScene == 1) {
+            frame.mesh = tetraMesh;
+        }
+        else if (currentScene == 4) {
+            // Сегментов круга столько, сколько нужно при его размере на экране
+            frame.mesh = selectCircleLod(modelViewProjection).mesh;
+        }
+        else {
+            frame.mesh = texturedMesh(modelViewProjection);
+        }
+    }
 
-    // Создание шейдерных программ
-    programTet = createProgram(vertexShaderSimple, fragmentShaderSimple);
-    programCubeTex = createProgram(vertexShaderSource, fragmentShaderSource);
-    programCubeTwoTex = createProgram(vertexShaderSource, fragmentTwoTextures);
-    programCircle = createProgram(vertexShaderSimple, fragmentShaderSimple);
+    recordedCameras.push_back(camera);
+    commandRecorder.beginFrame(objectCount, RECORD_GRAIN, [frame](int begin, int end, CommandBuffer& buffer) {
+        if (frame.scene == 5) {
+            recordStressObjects(frame, begin, end, buffer);
+        }
+        else {
+            recordSceneObject(frame, buffer);
+        }
+    });
+}
 
-    // Загрузка текстур
-    textureWater = loadWaterTexture();
-    textureWood = loadWoodTexture();
+// Все материалы - слои одного массива, отдельных текстур у них нет
+GLuint materialTexture(int material) {
+    return material == MATERIAL_ARRAY ? textureStreamer.texture(materialArray) : 0;
+}
 
-    // Инициализация геометрии
-    initTetrahedron();
-    initTexturedCube();
-    initCircle();
+// Сцена 5: матрицы всех экземпляров пишутся прямо в отображенный буфер,
+// затем кубики и тетраэдры рисуются двумя вызовами glDrawElementsInstanced
+// (или по команде непрямой отрисовки на объект с теми же атрибутами)
+void renderStressScene() {
+    float angle = sceneAngle(5);
+    float cosA = cos(angle);
+    float sinA = -sin(angle);
+
+    int count = stressInstanceCount;
+    InstanceData* instances = (InstanceData*)stressStream.map(count * sizeof(InstanceData));
+    sharedThreadPool().parallelFor(count, 4096, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            instances[i].model = composeTranslateRotateY(stressPositions[i], stressBaseRotation[i], cosA, sinA);
+            memcpy(instances[i].tint, stressTints[i].data(), sizeof(instances[i].tint));
+        }
+    });
+    GLintptr offset = stressStream.unmap();
 
-    cout << "OpenGL initialized successfully!" << endl;
+    int cubeCount = (count + 1) / 2;
+    int tetraCount = count - cubeCount;
+    if (stressIndirect && stressIndirectDraws.size() != (size_t)count) {
+        buildStressIndirect(cubeCount, tetraCount);
+    }
+
+    auto submitStart = chrono::steady_clock::now();
+    programInstancedTex.use();
+    instancedColorInfluence.set(colorInfluence);
+    renderState().bindTextureArray(DRAW_ARRAY_UNIT, textureStreamer.texture(materialArray));
+    renderState().bindVertexArray(cubeInstancedVAO);
+    setInstanceAttributes(offset);
+    if (stressIndirect) {
+        stressIndirectDraws.draw(0, cubeCount, cubeMesh.indexType);
+    }
+    else {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cubeMesh.indexCount, cubeMesh.indexType, cubeMesh.indexOffset(),
+            cubeCount, cubeMesh.baseVertex);
+        renderState().countDraw();
+    }
+
+    if (tetraCount > 0) {
+        programInstancedColor.use();
+        renderState().bindVertexArray(tetraInstancedVAO);
+        setInstanceAttributes(offset + cubeCount * sizeof(InstanceData));
+        if (stressIndirect) {
+            stressIndirectDraws.draw(cubeCount, tetraCount, tetraMesh.indexType);
+        }
+        else {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, tetraMesh.indexCount, tetraMesh.indexType,
+                tetraMesh.indexOffset(), tetraCount, tetraMesh.baseVertex);
+            renderState().countDraw();
+        }
+    }
+    stressSubmitMs += chrono::duration<double, milli>(chrono::steady_clock::now() - submitStart).count();
+
+    stressStream.fence();
 }
 
-// ==================== Отрисовка ====================
 void render() {
+    // Матрицы камеры кадра
+    CameraBlock camera;
+    camera.view = cameraView();
+    camera.projection = cameraProjection();
+
+    // Запись идет в пуле, пока поток GL копирует текстуры. Инстансинг сцены 5 пишет
+    // экземпляры прямо в отображенный буфер и в записи не участвует
+    bool recorded = currentScene != 5 || stressSeparateDraws;
+    if (recorded) {
+        recordFrame(camera);
+    }
+    else {
+        commandRecorder.discard();
+        recordedCameras.clear();
+    }
+
+    updateTextures();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Устанавливаем viewport
     glViewport(0, 0, windowWidth, windowHeight);
 
-    // Создаем матрицы проекции и вида
-    float aspect = (float)windowWidth / (float)windowHeight;
-    float projection[16] = { 0 };
-    projection[0] = 1.0f / aspect;
-    projection[5] = 1.0f;
-    projection[10] = -1.0f / (10.0f - 0.1f);
-    projection[11] = -1.0f;
-    projection[14] = -(10.0f * 0.1f) / (10.0f - 0.1f);
-    projection[15] = 0.0f;
-
-    float view[16] = { 0 };
-    view[0] = 1.0f; view[5] = 1.0f; view[10] = 1.0f; view[15] = 1.0f;
-    view[14] = -3.0f;  // Отодвигаем камеру назад
+    if (!recorded) {
+        // Матрицы камеры загружаются один раз за кадр (и только если изменились)
+        cameraBuffer.update(&camera, sizeof(camera));
+        renderStressScene();
+    }
+    else if (commandRecorder.submitFrame(drawQueue, materialTexture)) {
+        // При конвейерной записи отправляется предыдущий кадр - с его камерой
+        cameraBuffer.update(&recordedCameras.front(), sizeof(CameraBlock));
+        recordedCameras.pop_front();
+        auto submitStart = chrono::steady_clock::now();
+        drawQueue.flush(geometryArena);
+        if (currentScene == 5) {
+            stressSubmitMs += chrono::duration<double, milli>(chrono::steady_clock::now() - submitStart).count();
+        }
+    }
+
+    presentFrame();
+}
+
+// ==================== Программная отрисовка ====================
+// Загрузка данных сцен в память без создания контекста OpenGL
+void initSoftware() {
+    loadSourceImage(findTextureSource("water", PATTERN_WATER), waterImage);
+    loadSourceImage(findTextureSource("wood", PATTERN_WOOD), woodImage);
+    packCircleMesh();
+    cout << "Software renderer initialized successfully!" << endl;
+}
+
+// Та же сцена, что и в render(), но на программном растеризаторе
+void renderSoftware(SoftFramebuffer& framebuffer, ThreadPool& pool) {
+    SoftDrawCall draw;
+    draw.projection = cameraProjection();
+    draw.view = cameraView();
+
+    draw.model = sceneModelMatrix(currentScene);
 
     if (currentScene == 1) {
-        // Градиентный тетраэдр
-        glUseProgram(programTet);
-
-        // Матрица модели тетраэдра
-        float model[16] = { 0 };
-        model[0] = 1.0f; model[5] = 1.0f; model[10] = 1.0f; model[15] = 1.0f;
-
-        // Позиция
-        model[12] = tetraX;
-        model[13] = tetraY;
-        model[14] = tetraZ;
-
-        // Автоповорот тетраэдра для лучшего обзора
-        static float rotation = 0.0f;
-        rotation += 1.0f;
-        float angle = rotation * 3.14159f / 180.0f;
-        float cosA = cos(angle);
-        float sinA = sin(angle);
-
-        // Поворот вокруг оси Y
-        model[0] = cosA;
-        model[2] = sinA;
-        model[8] = -sinA;
-        model[10] = cosA;
-
-        // Добавляем небольшой наклон, чтобы было видно, что это тетраэдр
-        float tiltAngle = 45.0f * 3.14159f / 180.0f;
-        float cosTilt = cos(tiltAngle);
-        float sinTilt = sin(tiltAngle);
-
-        float temp = model[1];
-        model[1] = model[1] * cosTilt - model[2] * sinTilt;
-        model[2] = temp * sinTilt + model[2] * cosTilt;
-
-        temp = model[5];
-        model[5] = model[5] * cosTilt - model[6] * sinTilt;
-        model[6] = temp * sinTilt + model[6] * cosTilt;
-
-        temp = model[9];
-        model[9] = model[9] * cosTilt - model[10] * sinTilt;
-        model[10] = temp * sinTilt + model[10] * cosTilt;
-
-        // Передаем матрицы в шейдер
-        GLint modelLoc = glGetUniformLocation(programTet, "model");
-        GLint viewLoc = glGetUniformLocation(programTet, "view");
-        GLint projLoc = glGetUniformLocation(programTet, "projection");
-
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view);
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, projection);
-
-        // Отрисовываем тетраэдр
-        glBindVertexArray(tetraVAO);
-        glDrawElements(GL_TRIANGLES, 12, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-    }
-    else if (currentScene == 2) {
-        // Кубик с текстурой воды и цветом вершин
-        glUseProgram(programCubeTex);
-
-        float model[16] = { 0 };
-        model[0] = 1.0f; model[5] = 1.0f; model[10] = 1.0f; model[15] = 1.0f;
-
-        // Автоповорот кубика
-        static float rotation = 0.0f;
-        rotation += 1.0f;
-        float angle = rotation * 3.14159f / 180.0f;
-        float cosA = cos(angle);
-        float sinA = sin(angle);
-        model[0] = cosA;
-        model[2] = sinA;
-        model[8] = -sinA;
-        model[10] = cosA;
-
-        GLint modelLoc = glGetUniformLocation(programCubeTex, "model");
-        GLint viewLoc = glGetUniformLocation(programCubeTex, "view");
-        GLint projLoc = glGetUniformLocation(programCubeTex, "projection");
-        GLint colorInfLoc = glGetUniformLocation(programCubeTex, "colorInfluence");
-
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view);
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, projection);
-        glUniform1f(colorInfLoc, colorInfluence);
-
-        // Активируем текстуру воды
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureWater);
-        GLint texLoc = glGetUniformLocation(programCubeTex, "texture1");
-        glUniform1i(texLoc, 0);
-
-        // Отрисовываем кубик
-        glBindVertexArray(cubeVAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-    }
-    else if (currentScene == 3) {
-        // Кубик с двумя смешанными текстурами (вода + дерево)
-        glUseProgram(programCubeTwoTex);
-
-        float model[16] = { 0 };
-        model[0] = 1.0f; model[5] = 1.0f; model[10] = 1.0f; model[15] = 1.0f;
-
-        // Автоповорот кубика
-        static float rotation = 0.0f;
-        rotation += 1.0f;
-        float angle = rotation * 3.14159f / 180.0f;
-        float cosA = cos(angle);
-        float sinA = sin(angle);
-        model[0] = cosA;
-        model[2] = sinA;
-        model[8] = -sinA;
-        model[10] = cosA;
-
-        GLint modelLoc = glGetUniformLocation(programCubeTwoTex, "model");
-        GLint viewLoc = glGetUniformLocation(programCubeTwoTex, "view");
-        GLint projLoc = glGetUniformLocation(programCubeTwoTex, "projection");
-        GLint mixRatioLoc = glGetUniformLocation(programCubeTwoTex, "mixRatio");
-
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view);
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, projection);
-        glUniform1f(mixRatioLoc, textureMixRatio);
-
-        // Активируем текстуру воды (texture1)
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureWater);
-        GLint tex1Loc = glGetUniformLocation(programCubeTwoTex, "texture1");
-        glUniform1i(tex1Loc, 0);
-
-        // Активируем текстуру дерева (texture2)
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, textureWood);
-        GLint tex2Loc = glGetUniformLocation(programCubeTwoTex, "texture2");
-        glUniform1i(tex2Loc, 1);
-
-        // Отрисовываем кубик
-        glBindVertexArray(cubeVAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-    }
-    else if (currentScene == 4) {
-        // Градиентный круг (статичный)
-        glUseProgram(programCircle);
-
-        float model[16] = { 0 };
-        model[0] = circleScaleX;
-        model[5] = circleScaleY;
-        model[10] = 1.0f;  // Фиксированный масштаб по Z
-        model[15] = 1.0f;
-
-        GLint modelLoc = glGetUniformLocation(programCircle, "model");
-        GLint viewLoc = glGetUniformLocation(programCircle, "view");
-        GLint projLoc = glGetUniformLocation(programCircle, "projection");
-
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, model);
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, view);
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, projection);
-
-        // Отрисовываем круг
-        glBindVertexArray(circleVAO);
-        glDrawElements(GL_TRIANGLES, 64 * 3, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        draw.vertices = tetraVertices;
+        draw.floatsPerVertex = 6;
+        draw.vertexCount = 4;
+        draw.indices = tetraIndices;
+        draw.indexCount = 12;
+        draw.shader = SOFT_SHADER_VERTEX_COLOR;
+    }
+    else if (currentScene == 2 || currentScene == 3) {
+        draw.vertices = cubeMeshData.vertices;
+        draw.floatsPerVertex = cubeMeshData.floatsPerVertex;
+        draw.vertexCount = cubeMeshData.vertexCount;
+        draw.indices = cubeMeshData.indices;
+        draw.indexCount = cubeMeshData.indexCount;
+        draw.texture1 = &waterImage;
+        if (currentScene == 2) {
+            draw.shader = SOFT_SHADER_TINTED_TEXTURE;
+            draw.colorInfluence = colorInfluence;
+        }
+        else {
+            draw.shader = SOFT_SHADER_TWO_TEXTURES;
+            draw.texture2 = &woodImage;
+            draw.mixRatio = textureMixRatio;
+        }
+    }
+    else {
+        const CircleLodLevel& circle = selectCircleLod(draw.projection * draw.view * draw.model);
+        draw.vertices = circle.vertices.data();
+        draw.floatsPerVertex = 6;
+        draw.vertexCount = (int)circle.vertices.size() / 6;
+        draw.indices = circle.indices.data();
+        draw.indexCount = (int)circle.indices.size();
+        draw.shader = SOFT_SHADER_VERTEX_COLOR;
     }
 
-    SwapBuffers(g_hDC);
+    softRender(framebuffer, clearColor, &draw, 1, pool);
+}
+
+#ifdef _WIN32
+// ==================== Темп кадров ====================
+bool vsyncEnabled = true;
+bool vsyncSupported = false;
+bool uncappedFrameRate = false;  // Режим замеров: без vsync и без ограничения частоты
+const double frameRateLimit = 60.0;  // Если vsync недоступен или выключен
+
+// Ограничение частоты кадров таймером нужно, только когда кадры не ограничивает vsync
+void applyFramePacing() {
+    bool vsync = vsyncEnabled && vsyncSupported && !uncappedFrameRate;
+    if (vsyncSupported) {
+        wglSwapIntervalEXT(vsync ? 1 : 0);
+    }
+    frameClock.setFrameRateLimit(vsync || uncappedFrameRate ? 0.0 : frameRateLimit);
+    cout << "Frame pacing: " << (uncappedFrameRate ? "uncapped" : vsync ? "vsync" : "60 FPS timer") << endl;
+}
+
+void setVSync(bool enabled) {
+    vsyncEnabled = enabled;
+    applyFramePacing();
 }
 
 // ==================== Обработка сообщений Windows ====================
@@ -694,7 +1249,6 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         windowWidth = LOWORD(lParam);
         windowHeight = HIWORD(lParam);
         glViewport(0, 0, windowWidth, windowHeight);
-        InvalidateRect(hWnd, NULL, FALSE);
         return 0;
 
     case WM_CLOSE:
@@ -708,14 +1262,15 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         case '2': currentScene = 2; break;
         case '3': currentScene = 3; break;
         case '4': currentScene = 4; break;
+        case '5': currentScene = 5; break;
 
             // Движение тетраэдра (сцена 1)
-        case 'W': tetraY += 0.1f; break;
-        case 'S': tetraY -= 0.1f; break;
-        case 'A': tetraX -= 0.1f; break;
-        case 'D': tetraX += 0.1f; break;
-        case 'Q': tetraZ += 0.1f; break;
-        case 'E': tetraZ -= 0.1f; break;
+        case 'W': moveTetrahedron(0.0f, 0.1f, 0.0f); break;
+        case 'S': moveTetrahedron(0.0f, -0.1f, 0.0f); break;
+        case 'A': moveTetrahedron(-0.1f, 0.0f, 0.0f); break;
+        case 'D': moveTetrahedron(0.1f, 0.0f, 0.0f); break;
+        case 'Q': moveTetrahedron(0.0f, 0.0f, 0.1f); break;
+        case 'E': moveTetrahedron(0.0f, 0.0f, -0.1f); break;
 
             // Влияние цвета на текстуру (сцена 2)
         case VK_OEM_PLUS:
@@ -740,32 +1295,48 @@ LRESULT CALLBACK WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             break;
 
             // Масштабирование круга (сцена 4)
-        case 'X':
-            circleScaleX += 0.1f;
-            cout << "Circle scale X: " << circleScaleX << endl;
+        case 'X': scaleCircle(0.1f, 0.0f); break;
+        case 'C': scaleCircle(-0.1f, 0.0f); break;
+        case 'Y': scaleCircle(0.0f, 0.1f); break;
+        case 'U': scaleCircle(0.0f, -0.1f); break;
+
+            // Число экземпляров в стресс-сцене (сцена 5)
+        case 'I':
+            buildStressInstances(min(stressInstanceCount * 2, maxStressInstances));
             break;
-        case 'C':
-            circleScaleX = max(circleScaleX - 0.1f, 0.1f);
-            cout << "Circle scale X: " << circleScaleX << endl;
+        case 'O':
+            buildStressInstances(max(stressInstanceCount / 2, 1));
             break;
-        case 'Y':
-            circleScaleY += 0.1f;
-            cout << "Circle scale Y: " << circleScaleY << endl;
+
+            // Текстура кубиков: вода, мрамор, шахматка, плазма
+        case 'T': {
+            static const ProceduralPattern cycle[] = { PATTERN_WATER, PATTERN_MARBLE, PATTERN_CHECKER, PATTERN_PLASMA };
+            int next = 0;
+            for (int i = 0; i < 4; i++) {
+                if (cycle[i] == cubeTexturePattern) next = (i + 1) % 4;
+            }
+            requestCubeTexture(cycle[next]);
+            cout << "Cube texture: " << proceduralPatternName(cycle[next]) << endl;
+            break;
+        }
+
+            // Частота кадров
+        case 'V':
+            setVSync(!vsyncEnabled);
             break;
-        case 'U':
-            circleScaleY = max(circleScaleY - 0.1f, 0.1f);
-            cout << "Circle scale Y: " << circleScaleY << endl;
+        case 'B':
+            uncappedFrameRate = !uncappedFrameRate;
+            applyFramePacing();
             break;
 
         case VK_ESCAPE:
             PostQuitMessage(0);
             break;
         }
-        InvalidateRect(hWnd, NULL, FALSE);
         return 0;
 
     case WM_PAINT:
-        render();
+        // Кадры рисует только главный цикл; здесь лишь подтверждаем перерисовку
         ValidateRect(hWnd, NULL);
         return 0;
     }
@@ -794,7 +1365,7 @@ bool createWindow(HINSTANCE hInstance, int nCmdShow) {
     g_hWnd = CreateWindowEx(
         0,
         L"OpenGLWindow",
-        L"OpenGL VBO Demo - 4 Scenes (Press 1-4 to switch, ESC to exit)",
+        L"OpenGL VBO Demo - 5 Scenes (Press 1-5 to switch, ESC to exit)",
         WS_OVERLAPPEDWINDOW,
         CW_USEDEFAULT, CW_USEDEFAULT,
         800, 600,
@@ -873,6 +1444,7 @@ bool createWindow(HINSTANCE hInstance, int nCmdShow) {
 
 // ==================== Главная функция ====================
 int main() {
+    initSceneGraph();
     // Создаем консоль для отладки
     AllocConsole();
     FILE* conout;
@@ -884,7 +1456,14 @@ int main() {
     cout << "Scene 2: Cube with water texture (+/- to adjust color influence: текстура умножается на цвет вершин)" << endl;
     cout << "Scene 3: Cube mixing water and wood textures (M/N to adjust mix ratio: 0=вода, 1=дерево)" << endl;
     cout << "Scene 4: Static gradient circle (X/C for X scale, Y/U for Y scale)" << endl;
-    cout << "Press 1-4 to switch scenes, ESC to exit" << endl;
+    cout << "Scene 5: Instanced stress test (I/O to double/halve the instance count)" << endl;
+    cout << "T cycles the cube texture (water/marble/checker/plasma)" << endl;
+    cout << "V toggles vsync, B toggles uncapped frame rate (benchmark)" << endl;
+    cout << "Press 1-5 to switch scenes, ESC to exit" << endl;
+    cout << "lab12.exe mesh.obj shows the mesh instead of the cube in scenes 2 and 3" << endl;
+    if (__argc > 1) {
+        importMeshPath = __argv[1];
+    }
 
     HINSTANCE hInstance = GetModuleHandle(NULL);
     int nCmdShow = SW_SHOW;
@@ -902,12 +1481,15 @@ int main() {
     // Инициализация OpenGL
     initOpenGL();
 
-    // Принудительная первая отрисовка
-    render();
+    vsyncSupported = WGLEW_EXT_swap_control != 0;
+    applyFramePacing();
+    frameClock.start();
 
-    // Главный цикл
+    // Главный цикл: один кадр за итерацию
     MSG msg = {};
     bool running = true;
+    int fpsFrames = 0;
+    double fpsTime = 0.0;
 
     while (running) {
         // Обработка сообщений
@@ -919,18 +1501,297 @@ int main() {
             DispatchMessage(&msg);
         }
 
-        // Отрисовка
-        render();
+        if (!running) {
+            break;
+        }
 
-        // Небольшая задержка для снижения нагрузки на CPU
-        Sleep(16);
+        // Анимация по реальному времени, затем ровно одна отрисовка
+        advanceAnimation();
+        render();
+        frameClock.waitForNextFrame();
+
+        // Раз в секунду - средняя частота кадров
+        fpsFrames++;
+        fpsTime += frameClock.frameTime();
+        if (fpsTime >= 1.0) {
+            cout << "FPS: " << fpsFrames / fpsTime << ", frame time " << fpsTime * 1000.0 / fpsFrames << " ms" << endl;
+            fpsFrames = 0;
+            fpsTime = 0.0;
+        }
     }
 
     // Очистка
+    textureStreamer.destroy();
+    geometryArena.destroy();
     wglMakeCurrent(NULL, NULL);
     wglDeleteContext(g_hRC);
     ReleaseDC(g_hWnd, g_hDC);
 
     FreeConsole();
     return 0;
-}
\ No newline at end of file
+}
+#else
+// ==================== Режим без окна (Linux) ====================
+struct HeadlessOptions {
+    int frames = 300;
+    int warmup = 5;           // Кадры до замеров: llvmpipe компилирует шейдеры при первой отрисовке
+    int scene = 0;            // 0 - прогнать все сцены подряд
+    const char* output = nullptr;
+    bool software = false;    // Программный растеризатор вместо OpenGL
+    int threads = 0;          // Потоки растеризатора, 0 - по числу ядер
+    const char* bench = nullptr;  // Имя микробенчмарка (см. benchmarks.cpp)
+    double fps = 0.0;         // Лимит частоты кадров, 0 - без ограничения
+    bool realtime = false;    // Анимация по реальным часам, а не ровно FIXED_STEP за кадр
+    bool streamTextures = false;  // Не ждать загрузки текстур перед замерами
+    const char* cubeTexture = nullptr;  // Узор для кубиков вместо воды
+    const char* optimizeInput = nullptr;   // --optimize-obj: оптимизировать OBJ-файл без отрисовки
+    const char* optimizeOutput = nullptr;
+};
+
+const int softwareSceneCount = 4;  // Стресс-сцену программный растеризатор не рисует
+const int sceneCount = 5;
+
+static bool parseHeadlessArgs(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--frames") == 0 && hasValue) options.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && hasValue) options.warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width") == 0 && hasValue) windowWidth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && hasValue) windowHeight = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--scene") == 0 && hasValue) options.scene = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--output") == 0 && hasValue) options.output = argv[++i];
+        else if (strcmp(argv[i], "--software") == 0) options.software = true;
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench") == 0 && hasValue) options.bench = argv[++i];
+        else if (strcmp(argv[i], "--instances") == 0 && hasValue) stressInstanceCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--orphan") == 0) stressPersistentMapping = false;
+        else if (strcmp(argv[i], "--stress-draws") == 0) stressSeparateDraws = true;
+        else if (strcmp(argv[i], "--stress-indirect") == 0) stressIndirect = true;
+        else if (strcmp(argv[i], "--indirect-loop") == 0) stressIndirectLoop = true;
+        else if (strcmp(argv[i], "--no-draw-sort") == 0) drawQueue.setSorting(false);
+        else if (strcmp(argv[i], "--pipelined-recording") == 0) commandRecorder.setPipelined(true);
+        else if (strcmp(argv[i], "--fps") == 0 && hasValue) options.fps = atof(argv[++i]);
+        else if (strcmp(argv[i], "--realtime") == 0) options.realtime = true;
+        else if (strcmp(argv[i], "--texture-size") == 0 && hasValue) proceduralTextureSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stream-textures") == 0) options.streamTextures = true;
+        else if (strcmp(argv[i], "--upload-budget") == 0 && hasValue) textureUploadBudgetMs = atof(argv[++i]);
+        else if (strcmp(argv[i], "--cube-texture") == 0 && hasValue) options.cubeTexture = argv[++i];
+        else if (strcmp(argv[i], "--no-texture-cache") == 0) textureCacheEnabled = false;
+        else if (strcmp(argv[i], "--no-program-cache") == 0) programCacheEnabled = false;
+        else if (strcmp(argv[i], "--float-vertices") == 0) vertexQuantization = false;
+        else if (strcmp(argv[i], "--vertex-streams") == 0 && hasValue) {
+            meshVertexStreams = strcmp(argv[++i], "soa") == 0 ? STREAMS_SOA : STREAMS_INTERLEAVED;
+        }
+        else if (strcmp(argv[i], "--import") == 0 && hasValue) importMeshPath = argv[++i];
+        else if (strcmp(argv[i], "--optimize-meshes") == 0) meshOptimization = true;
+        else if (strcmp(argv[i], "--lod-tolerance") == 0 && hasValue) meshLodTolerance = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--optimize-obj") == 0 && i + 2 < argc) {
+            options.optimizeInput = argv[++i];
+            options.optimizeOutput = argv[++i];
+        }
+        else if (strcmp(argv[i], "--circle-tolerance") == 0 && hasValue) circleTolerance = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--circle-scale") == 0 && hasValue) {
+            // "3x1" - масштаб по X и Y, "2" - по обеим осям
+            const char* scale = argv[++i];
+            float x = (float)atof(scale);
+            const char* separator = strchr(scale, 'x');
+            setCircleScale(x, separator ? (float)atof(separator + 1) : x);
+        }
+        else if (strcmp(argv[i], "--mip-filter") == 0 && hasValue) {
+            textureMipFilter = strcmp(argv[++i], "box") == 0 ? MIP_FILTER_BOX : MIP_FILTER_KAISER;
+        }
+        else {
+            cout << "Usage: " << argv[0] << " [--frames N] [--warmup N] [--width W] [--height H] [--scene 1-5] [--output file.ppm]"
+                << " [--software [--threads N]] [--instances N [--orphan] [--stress-draws [--no-draw-sort]] [--stress-indirect [--indirect-loop]]] [--pipelined-recording]"
+                << " [--fps N] [--realtime] [--texture-size N] [--stream-textures] [--upload-budget ms]"
+                << " [--cube-texture pattern] [--no-texture-cache] [--mip-filter box|kaiser]"
+                << " [--no-program-cache] [--float-vertices] [--vertex-streams interleaved|soa]"
+                << " [--circle-tolerance px] [--circle-scale XxY] [--import mesh.obj] [--lod-tolerance px] [--optimize-meshes]"
+                << " [--optimize-obj in.obj out.obj] [--bench name|all]" << endl;
+            listBenchmarks();
+            return false;
+        }
+    }
+    return options.frames > 0 && options.warmup >= 0 && windowWidth > 0 && windowHeight > 0
+        && options.scene >= 0 && options.scene <= (options.software ? softwareSceneCount : sceneCount)
+        && options.threads >= 0 && options.fps >= 0.0 && textureUploadBudgetMs >= 0.0
+        && proceduralTextureSize > 0 && proceduralTextureSize <= MAX_PROCEDURAL_TEXTURE_SIZE
+        && stressInstanceCount > 0 && stressInstanceCount <= maxStressInstances;
+}
+
+// Прогоняет сцену заданное число кадров и печатает статистику времени кадра.
+// Кадр - тот же, что в оконном цикле: шаги анимации, одна отрисовка, ожидание лимита частоты
+static void benchmarkScene(int scene, int frames, int warmup, const function<void()>& renderFrame) {
+    currentScene = scene;
+    auto runFrame = [&] {
+        advanceAnimation();
+        renderFrame();
+        frameClock.waitForNextFrame();
+    };
+
+    frameClock.start();
+    for (int i = 0; i < warmup; i++) {
+        runFrame();
+    }
+
+    vector<double> frameTimes;
+    frameTimes.reserve(frames);
+    renderState().resetCounters();
+    double recordWait = 0.0;
+    stressSubmitMs = 0.0;
+
+    for (int i = 0; i < frames; i++) {
+        auto start = chrono::steady_clock::now();
+        runFrame();
+        auto end = chrono::steady_clock::now();
+        frameTimes.push_back(chrono::duration<double, milli>(end - start).count());
+        recordWait += commandRecorder.lastWaitMs();
+    }
+
+    double total = 0.0;
+    for (double t : frameTimes) total += t;
+    sort(frameTimes.begin(), frameTimes.end());
+
+    double average = total / frames;
+    double p95 = frameTimes[min((size_t)(frames * 0.95), frameTimes.size() - 1)];
+    cout << "Scene " << scene << ": " << frames << " frames, avg " << average << " ms"
+        << ", min " << frameTimes.front() << " ms"
+        << ", p95 " << p95 << " ms"
+        << ", max " << frameTimes.back() << " ms"
+        << ", " << 1000.0 / average << " FPS" << endl;
+    renderState().printStats(frames);
+    if (scene != 5 || stressSeparateDraws) {
+        cout << "  Command recording: " << commandRecorder.lastPacketCount() << " packets/frame, GL thread waited "
+            << recordWait / frames << " ms/frame" << (commandRecorder.isPipelined() ? " (pipelined)" : "") << endl;
+    }
+    if (scene == 5) {
+        cout << "  " << stressInstanceCount << " instances, "
+            << stressInstanceCount / (average / 1000.0) / 1e6 << " M instances/s (" << stressSubmissionName() << ", "
+            << (stressStream.isPersistent() ? "persistent mapping" : "buffer orphaning") << ")" << endl;
+        // Сколько объектов в секунду успевает отдать драйверу поток GL без учета растеризации.
+        // Вызовов меньше объектов: инстансинг и glMultiDrawElementsIndirect рисуют многие за вызов
+        double submitMs = stressSubmitMs / frames;
+        cout << "  draw submission: " << submitMs << " ms/frame, "
+            << stressInstanceCount / (submitMs / 1000.0) / 1e6 << " M objects/s, "
+            << renderState().counters().draws / frames << " draw calls/frame" << endl;
+    }
+}
+
+// Все сцены или одна выбранная
+static void benchmarkScenes(const HeadlessOptions& options, int lastScene, const function<void()>& renderFrame) {
+    // По умолчанию каждый кадр продвигает анимацию ровно на один шаг:
+    // картинка N-го кадра не зависит от скорости машины
+    frameClock.setSimulatedFrameTime(options.realtime ? 0.0 : FrameClock::FIXED_STEP);
+    frameClock.setFrameRateLimit(options.fps);
+    if (options.scene != 0) {
+        benchmarkScene(options.scene, options.frames, options.warmup, renderFrame);
+    }
+    else {
+        for (int scene = 1; scene <= lastScene; scene++) {
+            benchmarkScene(scene, options.frames, options.warmup, renderFrame);
+        }
+    }
+}
+
+// Оптимизация OBJ-файла заранее: результат загружается без --optimize-meshes
+// с тем же порядком треугольников и вершин
+static int runOptimizeObj(const HeadlessOptions& options) {
+    ObjImporter importer;
+    if (!importer.load(options.optimizeInput, sharedThreadPool())) {
+        return -1;
+    }
+    MeshOptimizeReport report;
+    importer.optimize(vertexStride(importer.outputFormat(vertexQuantization)), report);
+    importer.printStats(options.optimizeInput);
+    printOptimizeReport(options.optimizeInput, report);
+    if (!importer.save(options.optimizeOutput)) {
+        return -1;
+    }
+    cout << "Saved optimized mesh to " << options.optimizeOutput << endl;
+    return 0;
+}
+
+// Программный растеризатор: контекст OpenGL не нужен
+static int runSoftware(const HeadlessOptions& options) {
+    int threads = options.threads > 0 ? options.threads : max(1, (int)thread::hardware_concurrency());
+    ThreadPool pool(threads - 1);
+    cout << "Software rasterizer: " << windowWidth << "x" << windowHeight
+        << ", " << pool.threadCount() << " threads" << endl;
+
+    initSoftware();
+
+    SoftFramebuffer framebuffer;
+    framebuffer.resize(windowWidth, windowHeight);
+    benchmarkScenes(options, softwareSceneCount, [&] { renderSoftware(framebuffer, pool); });
+
+    if (options.output) {
+        if (saveSoftFramebufferPPM(framebuffer, options.output)) {
+            cout << "Saved last frame to " << options.output << endl;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    initSceneGraph();
+    HeadlessOptions options;
+    if (!parseHeadlessArgs(argc, argv, options)) {
+        return -1;
+    }
+
+    cout << "=== OpenGL VBO Demo (headless) ===" << endl;
+
+    if (options.bench) {
+        return runBenchmark(options.bench) ? 0 : -1;
+    }
+
+    if (options.optimizeInput) {
+        return runOptimizeObj(options);
+    }
+
+    if (options.software) {
+        return runSoftware(options);
+    }
+
+    if (!createHeadlessContext(windowWidth, windowHeight)) {
+        cout << "Failed to create headless context" << endl;
+        return -1;
+    }
+
+    cout << "OpenGL version: " << glGetString(GL_VERSION) << endl;
+    cout << "OpenGL renderer: " << glGetString(GL_RENDERER) << endl;
+    cout << "GLSL version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
+    cout << "Framebuffer: " << windowWidth << "x" << windowHeight << endl;
+
+    initOpenGL();
+    if (options.cubeTexture) {
+        int pattern = 0;
+        while (pattern < PATTERN_COUNT && strcmp(proceduralPatternName((ProceduralPattern)pattern), options.cubeTexture) != 0) {
+            pattern++;
+        }
+        if (pattern == PATTERN_COUNT) {
+            cout << "Unknown texture pattern: " << options.cubeTexture << endl;
+            return -1;
+        }
+        requestCubeTexture((ProceduralPattern)pattern);
+    }
+    // По умолчанию кадры считаются с уже загруженными текстурами, чтобы картинка была воспроизводимой
+    if (!options.streamTextures) {
+        textureStreamer.finish();
+        updateTextures();
+    }
+    benchmarkScenes(options, sceneCount, render);
+    circleLod.printStats();
+
+    if (options.output) {
+        if (saveFramebufferPPM(options.output)) {
+            cout << "Saved last frame to " << options.output << endl;
+        }
+    }
+
+    textureStreamer.destroy();
+    geometryArena.destroy();
+    destroyHeadlessContext();
+    return 0;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,261 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH3D_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define MATH3D_AVX 1
+#include <immintrin.h>
+#endif
+
+// ==================== Векторы и матрицы ====================
+// Матрицы хранятся по столбцам (column-major), как их принимает glUniformMatrix4fv
+// с transpose = GL_FALSE: m[12], m[13], m[14] - перенос.
+// Данные выровнены на 16 байт, чтобы столбцы загружались одной SSE-инструкцией.
+
+// Полная точность float. Прежний код сцен брал 3.14159f, поэтому углы поворота
+// (и матрицы) отличаются от него примерно на 1e-6 относительной величины
+const float MATH3D_PI = 3.14159265358979f;
+
+inline float radians(float degrees) {
+    return degrees * (MATH3D_PI / 180.0f);
+}
+
+struct alignas(16) Vec4 {
+    float x, y, z, w;
+
+    Vec4() : x(0.0f), y(0.0f), z(0.0f), w(0.0f) {}
+    Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+
+    const float* data() const { return &x; }
+    float* data() { return &x; }
+};
+
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return Vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return Vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+inline Vec4 operator*(const Vec4& a, float s) { return Vec4(a.x * s, a.y * s, a.z * s, a.w * s); }
+inline float dot(const Vec4& a, const Vec4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+struct alignas(16) Mat4 {
+    float m[16];
+
+    const float* data() const { return m; }
+    float* data() { return m; }
+    float* column(int index) { return &m[index * 4]; }
+    const float* column(int index) const { return &m[index * 4]; }
+
+    static Mat4 zero() {
+        Mat4 r;
+        for (int i = 0; i < 16; i++) r.m[i] = 0.0f;
+        return r;
+    }
+
+    static Mat4 identity() {
+        Mat4 r = zero();
+        r.m[0] = r.m[5] = r.m[10] = r.m[15] = 1.0f;
+        return r;
+    }
+
+    static Mat4 translation(float x, float y, float z) {
+        Mat4 r = identity();
+        r.m[12] = x; r.m[13] = y; r.m[14] = z;
+        return r;
+    }
+
+    static Mat4 scale(float x, float y, float z) {
+        Mat4 r = zero();
+        r.m[0] = x; r.m[5] = y; r.m[10] = z; r.m[15] = 1.0f;
+        return r;
+    }
+
+    // Повороты по заранее посчитанным cos/sin - без вызова тригонометрии
+    static Mat4 rotationX(float cosA, float sinA) {
+        Mat4 r = identity();
+        r.m[5] = cosA;  r.m[6] = sinA;
+        r.m[9] = -sinA; r.m[10] = cosA;
+        return r;
+    }
+
+    static Mat4 rotationY(float cosA, float sinA) {
+        Mat4 r = identity();
+        r.m[0] = cosA; r.m[2] = -sinA;
+        r.m[8] = sinA; r.m[10] = cosA;
+        return r;
+    }
+
+    static Mat4 rotationZ(float cosA, float sinA) {
+        Mat4 r = identity();
+        r.m[0] = cosA;  r.m[1] = sinA;
+        r.m[4] = -sinA; r.m[5] = cosA;
+        return r;
+    }
+
+    static Mat4 rotationX(float angle) { return rotationX(std::cos(angle), std::sin(angle)); }
+    static Mat4 rotationY(float angle) { return rotationY(std::cos(angle), std::sin(angle)); }
+    static Mat4 rotationZ(float angle) { return rotationZ(std::cos(angle), std::sin(angle)); }
+};
+
+// ==================== Произведения ====================
+inline Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+#ifdef MATH3D_SSE
+    __m128 a0 = _mm_load_ps(&a.m[0]);
+    __m128 a1 = _mm_load_ps(&a.m[4]);
+    __m128 a2 = _mm_load_ps(&a.m[8]);
+    __m128 a3 = _mm_load_ps(&a.m[12]);
+    for (int j = 0; j < 4; j++) {
+        const float* bc = &b.m[j * 4];
+        __m128 c = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+        c = _mm_add_ps(c, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+        c = _mm_add_ps(c, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+        c = _mm_add_ps(c, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+        _mm_store_ps(&r.m[j * 4], c);
+    }
+#else
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            r.m[j * 4 + i] = a.m[i] * b.m[j * 4] + a.m[4 + i] * b.m[j * 4 + 1]
+                + a.m[8 + i] * b.m[j * 4 + 2] + a.m[12 + i] * b.m[j * 4 + 3];
+        }
+    }
+#endif
+    return r;
+}
+
+inline Vec4 operator*(const Mat4& a, const Vec4& v) {
+    Vec4 r;
+#ifdef MATH3D_SSE
+    __m128 c = _mm_mul_ps(_mm_load_ps(&a.m[0]), _mm_set1_ps(v.x));
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_load_ps(&a.m[4]), _mm_set1_ps(v.y)));
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_load_ps(&a.m[8]), _mm_set1_ps(v.z)));
+    c = _mm_add_ps(c, _mm_mul_ps(_mm_load_ps(&a.m[12]), _mm_set1_ps(v.w)));
+    _mm_store_ps(r.data(), c);
+#else
+    for (int i = 0; i < 4; i++) {
+        r.data()[i] = a.m[i] * v.x + a.m[4 + i] * v.y + a.m[8 + i] * v.z + a.m[12 + i] * v.w;
+    }
+#endif
+    return r;
+}
+
+// ==================== Составные преобразования ====================
+// T * R * S одной функцией: перенос и масштаб подставляются в столбцы R без умножений матриц
+inline Mat4 composeTRS(const Vec4& translation, const Mat4& rotation, const Vec4& scale) {
+    Mat4 r;
+#ifdef MATH3D_SSE
+    _mm_store_ps(&r.m[0], _mm_mul_ps(_mm_load_ps(&rotation.m[0]), _mm_set1_ps(scale.x)));
+    _mm_store_ps(&r.m[4], _mm_mul_ps(_mm_load_ps(&rotation.m[4]), _mm_set1_ps(scale.y)));
+    _mm_store_ps(&r.m[8], _mm_mul_ps(_mm_load_ps(&rotation.m[8]), _mm_set1_ps(scale.z)));
+#else
+    for (int i = 0; i < 4; i++) {
+        r.m[i] = rotation.m[i] * scale.x;
+        r.m[4 + i] = rotation.m[4 + i] * scale.y;
+        r.m[8 + i] = rotation.m[8 + i] * scale.z;
+    }
+#endif
+    r.m[12] = translation.x;
+    r.m[13] = translation.y;
+    r.m[14] = translation.z;
+    r.m[15] = 1.0f;
+    return r;
+}
+
+// T * base * Ry без умножения матриц. base - чистый поворот (без переноса),
+// например заранее посчитанный постоянный наклон
+inline Mat4 composeTranslateRotateY(const Vec4& translation, const Mat4& base, float cosA, float sinA) {
+    Mat4 r;
+    // Ry меняет только столбцы 0 и 2: col0' = c * col0 - s * col2, col2' = s * col0 + c * col2
+#ifdef MATH3D_SSE
+    __m128 c0 = _mm_load_ps(&base.m[0]);
+    __m128 c2 = _mm_load_ps(&base.m[8]);
+    __m128 vc = _mm_set1_ps(cosA), vs = _mm_set1_ps(sinA);
+    _mm_store_ps(&r.m[0], _mm_sub_ps(_mm_mul_ps(c0, vc), _mm_mul_ps(c2, vs)));
+    _mm_store_ps(&r.m[4], _mm_load_ps(&base.m[4]));
+    _mm_store_ps(&r.m[8], _mm_add_ps(_mm_mul_ps(c0, vs), _mm_mul_ps(c2, vc)));
+#else
+    for (int i = 0; i < 4; i++) {
+        r.m[i] = base.m[i] * cosA - base.m[8 + i] * sinA;
+        r.m[4 + i] = base.m[4 + i];
+        r.m[8 + i] = base.m[i] * sinA + base.m[8 + i] * cosA;
+    }
+#endif
+    r.m[12] = translation.x;
+    r.m[13] = translation.y;
+    r.m[14] = translation.z;
+    r.m[15] = 1.0f;
+    return r;
+}
+
+// ==================== Пакетные операции ====================
+// out[i] = lhs * rhs[i], например view * projection для тысяч матриц моделей.
+// Массивы должны быть выровнены на 16 байт (Mat4 это гарантирует).
+inline void multiplyMat4Batch(const Mat4& lhs, const Mat4* rhs, Mat4* out, size_t count) {
+#if defined(MATH3D_AVX)
+    // Два столбца результата за инструкцию: столбцы lhs продублированы в обеих половинах регистра
+    __m256 a0 = _mm256_broadcast_ps((const __m128*)&lhs.m[0]);
+    __m256 a1 = _mm256_broadcast_ps((const __m128*)&lhs.m[4]);
+    __m256 a2 = _mm256_broadcast_ps((const __m128*)&lhs.m[8]);
+    __m256 a3 = _mm256_broadcast_ps((const __m128*)&lhs.m[12]);
+    for (size_t i = 0; i < count; i++) {
+        for (int j = 0; j < 16; j += 8) {
+            __m256 b = _mm256_loadu_ps(&rhs[i].m[j]);
+            __m256 c = _mm256_mul_ps(a0, _mm256_permute_ps(b, 0x00));
+            c = _mm256_add_ps(c, _mm256_mul_ps(a1, _mm256_permute_ps(b, 0x55)));
+            c = _mm256_add_ps(c, _mm256_mul_ps(a2, _mm256_permute_ps(b, 0xAA)));
+            c = _mm256_add_ps(c, _mm256_mul_ps(a3, _mm256_permute_ps(b, 0xFF)));
+            _mm256_storeu_ps(&out[i].m[j], c);
+        }
+    }
+#elif defined(MATH3D_SSE)
+    __m128 a0 = _mm_load_ps(&lhs.m[0]);
+    __m128 a1 = _mm_load_ps(&lhs.m[4]);
+    __m128 a2 = _mm_load_ps(&lhs.m[8]);
+    __m128 a3 = _mm_load_ps(&lhs.m[12]);
+    for (size_t i = 0; i < count; i++) {
+        for (int j = 0; j < 16; j += 4) {
+            __m128 b = _mm_load_ps(&rhs[i].m[j]);
+            __m128 c = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, 0x00));
+            c = _mm_add_ps(c, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, 0x55)));
+            c = _mm_add_ps(c, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, 0xAA)));
+            c = _mm_add_ps(c, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, 0xFF)));
+            _mm_store_ps(&out[i].m[j], c);
+        }
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        out[i] = lhs * rhs[i];
+    }
+#endif
+}
+
+// out[i] = m * in[i]
+inline void transformVec4Batch(const Mat4& m, const Vec4* in, Vec4* out, size_t count) {
+#if defined(MATH3D_AVX)
+    // Два вектора за итерацию
+    __m256 c0 = _mm256_broadcast_ps((const __m128*)&m.m[0]);
+    __m256 c1 = _mm256_broadcast_ps((const __m128*)&m.m[4]);
+    __m256 c2 = _mm256_broadcast_ps((const __m128*)&m.m[8]);
+    __m256 c3 = _mm256_broadcast_ps((const __m128*)&m.m[12]);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m256 v = _mm256_loadu_ps(in[i].data());
+        __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_permute_ps(v, 0x55)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_permute_ps(v, 0xAA)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(c3, _mm256_permute_ps(v, 0xFF)));
+        _mm256_storeu_ps(out[i].data(), r);
+    }
+    for (; i < count; i++) {
+        out[i] = m * in[i];
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        out[i] = m * in[i];
+    }
+#endif
+}
@@ -0,0 +1,272 @@
+﻿#pragma once
+
+// ==================== Процедурные меши ====================
+// Генераторы круга, куба, сферы и тора. Все они constexpr: одни и те же функции
+// заполняют массивы при компиляции (makeCircleMesh<64>() и т.п. - готовая таблица в .rodata)
+// и во время работы - для произвольной тесселяции в заранее выделенную память за один проход.
+// Размер памяти под меш заранее дает *MeshSize(). Вершины - float: позиция + цвет (6 на вершину),
+// у куба, сферы и тора еще UV (8 на вершину). Треугольники обходятся против часовой стрелки снаружи.
+
+struct MeshSize {
+    int vertexCount;
+    int indexCount;
+};
+
+// ==================== constexpr-тригонометрия ====================
+// std::sin/cos не constexpr, поэтому ряд Тейлора после приведения угла к [-pi/4, pi/4].
+// Считается в double: ошибка меньше точности float во всем диапазоне.
+// Генераторы зовут ряд только для шага угла, дальше вершины идут поворотом (MeshRotation).
+
+constexpr double MESH_PI = 3.14159265358979323846;
+
+constexpr double meshSinCos(double x, bool cosine) {
+    const double halfPi = MESH_PI / 2.0;
+    long quadrant = (long)(x / halfPi + (x >= 0.0 ? 0.5 : -0.5));
+    double r = x - quadrant * halfPi;
+    double r2 = r * r;
+    double s = r * (1.0 - r2 / 6.0 * (1.0 - r2 / 20.0 * (1.0 - r2 / 42.0 * (1.0 - r2 / 72.0 * (1.0 - r2 / 110.0)))));
+    double c = 1.0 - r2 / 2.0 * (1.0 - r2 / 12.0 * (1.0 - r2 / 30.0 * (1.0 - r2 / 56.0 * (1.0 - r2 / 90.0))));
+    if (cosine) quadrant += 1;  // cos(x) = sin(x + pi/2)
+    switch (quadrant & 3) {
+    case 0: return s;
+    case 1: return c;
+    case 2: return -s;
+    default: return -c;
+    }
+}
+
+constexpr float meshSin(float angle) { return (float)meshSinCos(angle, false); }
+constexpr float meshCos(float angle) { return (float)meshSinCos(angle, true); }
+
+// Углы 0, step, 2*step, ...: каждый следующий - поворот предыдущего на step (4 умножения).
+// В double накопленная ошибка за тысячи шагов остается далеко за пределами точности float.
+struct MeshRotation {
+    double cosine = 1.0, sine = 0.0;
+    double stepCos = 1.0, stepSin = 0.0;
+
+    constexpr explicit MeshRotation(double step) : stepCos(meshSinCos(step, true)), stepSin(meshSinCos(step, false)) {}
+
+    constexpr float cos() const { return (float)cosine; }
+    constexpr float sin() const { return (float)sine; }
+
+    constexpr void next() {
+        double c = cosine * stepCos - sine * stepSin;
+        sine = sine * stepCos + cosine * stepSin;
+        cosine = c;
+    }
+
+    // Шов: замыкающая вершина совпадает с первой бит в бит
+    constexpr void restart() {
+        cosine = 1.0;
+        sine = 0.0;
+    }
+};
+
+// Оттенок (0..1, по кругу) в RGB при полной насыщенности и яркости
+constexpr void hueToRgb(float hue, float* rgb) {
+    float h = hue * 6.0f;
+    int sector = static_cast<int>(h);
+    float fraction = h - sector;
+    float r = 0, g = 0, b = 0;
+    switch (sector % 6) {
+    case 0: r = 1; g = fraction; b = 0; break;
+    case 1: r = 1 - fraction; g = 1; b = 0; break;
+    case 2: r = 0; g = 1; b = fraction; break;
+    case 3: r = 0; g = 1 - fraction; b = 1; break;
+    case 4: r = fraction; g = 0; b = 1; break;
+    case 5: r = 1; g = 0; b = 1 - fraction; break;
+    }
+    rgb[0] = r;
+    rgb[1] = g;
+    rgb[2] = b;
+}
+
+// ==================== Генераторы ====================
+
+// Единичный круг в плоскости XY: белый центр и segments вершин по краю с градиентом оттенка
+constexpr MeshSize circleMeshSize(int segments) {
+    return { segments + 1, segments * 3 };
+}
+
+constexpr void generateCircle(int segments, float* vertices, unsigned int* indices) {
+    float* vertex = vertices;
+    vertex[0] = 0.0f; vertex[1] = 0.0f; vertex[2] = 0.0f;
+    vertex[3] = 1.0f; vertex[4] = 1.0f; vertex[5] = 1.0f;
+    vertex += 6;
+    MeshRotation rotation(2.0 * MESH_PI / segments);
+    for (int i = 0; i < segments; i++, vertex += 6, rotation.next()) {
+        vertex[0] = rotation.cos();
+        vertex[1] = rotation.sin();
+        vertex[2] = 0.0f;
+        hueToRgb((float)i / segments, vertex + 3);
+    }
+    for (int i = 0; i < segments; i++) {
+        indices[i * 3 + 0] = 0;
+        indices[i * 3 + 1] = i + 1;
+        indices[i * 3 + 2] = i + 1 < segments ? i + 2 : 1;  // Замыкаем круг
+    }
+}
+
+// Куб со стороной size: у каждой грани свои 4 вершины (красный, зеленый, синий, желтый) и UV на всю грань
+constexpr MeshSize cubeMeshSize() {
+    return { 24, 36 };
+}
+
+constexpr void generateCube(float size, float* vertices, unsigned int* indices) {
+    // Грань: ось нормали и ее знак, оси u и v, зеркальность текстуры по u
+    struct CubeFace { int axis; float sign; int uAxis; int vAxis; bool mirrorU; };
+    const CubeFace faces[6] = {
+        { 2,  1.0f, 0, 1, false },  // Передняя
+        { 2, -1.0f, 0, 1, true },   // Задняя
+        { 1,  1.0f, 0, 2, false },  // Верхняя
+        { 1, -1.0f, 0, 2, false },  // Нижняя
+        { 0, -1.0f, 2, 1, false },  // Левая
+        { 0,  1.0f, 2, 1, false },  // Правая
+    };
+    const float corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+    const float colors[4][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 1, 1, 0 } };
+    float half = size * 0.5f;
+
+    for (int f = 0; f < 6; f++) {
+        const CubeFace& face = faces[f];
+        for (int c = 0; c < 4; c++) {
+            float* vertex = vertices + (f * 4 + c) * 8;
+            vertex[face.axis] = face.sign * half;
+            vertex[face.uAxis] = (corners[c][0] * 2.0f - 1.0f) * half;
+            vertex[face.vAxis] = (corners[c][1] * 2.0f - 1.0f) * half;
+            vertex[3] = colors[c][0];
+            vertex[4] = colors[c][1];
+            vertex[5] = colors[c][2];
+            vertex[6] = face.mirrorU ? 1.0f - corners[c][0] : corners[c][0];
+            vertex[7] = corners[c][1];
+        }
+        // Углы идут против часовой стрелки в осях (u, v): снаружи это так, только если
+        // u x v смотрит вдоль нормали грани, иначе треугольники обходятся в обратном порядке
+        bool outward = ((face.uAxis + 1) % 3 == face.vAxis) == (face.sign > 0.0f);
+        unsigned int base = f * 4;
+        unsigned int second = outward ? base + 1 : base + 3;
+        unsigned int fourth = outward ? base + 3 : base + 1;
+        unsigned int* face6 = indices + f * 6;
+        face6[0] = base; face6[1] = second; face6[2] = base + 2;
+        face6[3] = base + 2; face6[4] = fourth; face6[5] = base;
+    }
+}
+
+// UV-сфера: stacks поясов от полюса до полюса, slices долек; оттенок идет по долготе.
+// На шве по долготе вершины дублируются, чтобы UV не перескакивал с 1 на 0.
+constexpr MeshSize sphereMeshSize(int stacks, int slices) {
+    return { (stacks + 1) * (slices + 1), stacks * slices * 6 };
+}
+
+constexpr void generateSphere(float radius, int stacks, int slices, float* vertices, unsigned int* indices) {
+    float* vertex = vertices;
+    MeshRotation theta(MESH_PI / stacks);
+    for (int s = 0; s <= stacks; s++, theta.next()) {
+        float v = (float)s / stacks;
+        // Полюса точно на оси: на последнем поясе накопленный поворот дал бы sin(pi) ~ 1e-16
+        float ringRadius = s < stacks ? theta.sin() * radius : 0.0f;
+        float y = s < stacks ? theta.cos() * radius : -radius;
+        MeshRotation phi(2.0 * MESH_PI / slices);
+        for (int j = 0; j <= slices; j++, vertex += 8, phi.next()) {
+            if (j == slices) phi.restart();
+            float u = (float)j / slices;
+            vertex[0] = ringRadius * phi.cos();
+            vertex[1] = y;
+            vertex[2] = ringRadius * phi.sin();
+            hueToRgb(j < slices ? u : 0.0f, vertex + 3);
+            vertex[6] = u;
+            vertex[7] = v;
+        }
+    }
+    unsigned int* index = indices;
+    for (int s = 0; s < stacks; s++) {
+        for (int j = 0; j < slices; j++, index += 6) {
+            unsigned int a = s * (slices + 1) + j;
+            unsigned int b = a + slices + 1;
+            index[0] = a; index[1] = a + 1; index[2] = b;
+            index[3] = a + 1; index[4] = b + 1; index[5] = b;
+        }
+    }
+}
+
+// Тор в плоскости XZ: rings колец вокруг оси Y по большому радиусу, sides вершин по сечению.
+// Оттенок идет по кольцам, UV - (кольцо, сечение) с дублированными швами.
+constexpr MeshSize torusMeshSize(int rings, int sides) {
+    return { (rings + 1) * (sides + 1), rings * sides * 6 };
+}
+
+constexpr void generateTorus(float majorRadius, float minorRadius, int rings, int sides,
+    float* vertices, unsigned int* indices) {
+    float* vertex = vertices;
+    MeshRotation ring(2.0 * MESH_PI / rings);
+    for (int i = 0; i <= rings; i++, ring.next()) {
+        if (i == rings) ring.restart();
+        float u = (float)i / rings;
+        float rgb[3] = { 0, 0, 0 };
+        hueToRgb(i < rings ? u : 0.0f, rgb);
+        MeshRotation side(2.0 * MESH_PI / sides);
+        for (int j = 0; j <= sides; j++, vertex += 8, side.next()) {
+            if (j == sides) side.restart();
+            float v = (float)j / sides;
+            float distance = majorRadius + minorRadius * side.cos();
+            vertex[0] = distance * ring.cos();
+            vertex[1] = minorRadius * side.sin();
+            vertex[2] = distance * ring.sin();
+            vertex[3] = rgb[0];
+            vertex[4] = rgb[1];
+            vertex[5] = rgb[2];
+            vertex[6] = u;
+            vertex[7] = v;
+        }
+    }
+    unsigned int* index = indices;
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < sides; j++, index += 6) {
+            unsigned int a = i * (sides + 1) + j;
+            unsigned int next = a + sides + 1;
+            index[0] = a; index[1] = a + 1; index[2] = next;
+            index[3] = a + 1; index[4] = next + 1; index[5] = next;
+        }
+    }
+}
+
+// ==================== Меши фиксированного размера ====================
+// Массивы внутри объекта: constexpr-переменная с таким мешем целиком считается компилятором
+
+template <int VertexCount, int IndexCount, int FloatsPerVertex>
+struct StaticMesh {
+    static constexpr int vertexCount = VertexCount;
+    static constexpr int indexCount = IndexCount;
+    static constexpr int floatsPerVertex = FloatsPerVertex;
+    float vertices[VertexCount * FloatsPerVertex];
+    unsigned int indices[IndexCount];
+};
+
+template <int Segments>
+constexpr StaticMesh<circleMeshSize(Segments).vertexCount, circleMeshSize(Segments).indexCount, 6> makeCircleMesh() {
+    StaticMesh<circleMeshSize(Segments).vertexCount, circleMeshSize(Segments).indexCount, 6> mesh{};
+    generateCircle(Segments, mesh.vertices, mesh.indices);
+    return mesh;
+}
+
+constexpr StaticMesh<cubeMeshSize().vertexCount, cubeMeshSize().indexCount, 8> makeCubeMesh(float size) {
+    StaticMesh<cubeMeshSize().vertexCount, cubeMeshSize().indexCount, 8> mesh{};
+    generateCube(size, mesh.vertices, mesh.indices);
+    return mesh;
+}
+
+template <int Stacks, int Slices>
+constexpr StaticMesh<sphereMeshSize(Stacks, Slices).vertexCount, sphereMeshSize(Stacks, Slices).indexCount, 8>
+makeSphereMesh(float radius) {
+    StaticMesh<sphereMeshSize(Stacks, Slices).vertexCount, sphereMeshSize(Stacks, Slices).indexCount, 8> mesh{};
+    generateSphere(radius, Stacks, Slices, mesh.vertices, mesh.indices);
+    return mesh;
+}
+
+template <int Rings, int Sides>
+constexpr StaticMesh<torusMeshSize(Rings, Sides).vertexCount, torusMeshSize(Rings, Sides).indexCount, 8>
+makeTorusMesh(float majorRadius, float minorRadius) {
+    StaticMesh<torusMeshSize(Rings, Sides).vertexCount, torusMeshSize(Rings, Sides).indexCount, 8> mesh{};
+    generateTorus(majorRadius, minorRadius, Rings, Sides, mesh.vertices, mesh.indices);
+    return mesh;
+}
@@ -0,0 +1,374 @@
+﻿#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, int vertexStride) {
+    VertexCacheStats stats;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return stats;
+    }
+
+    // FIFO на метках времени: вершина в кэше, если после ее загрузки было не больше
+    // VERTEX_CACHE_SIZE промахов. Начальные метки 0 - все вершины вне кэша
+    vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = VERTEX_CACHE_SIZE + 1;
+
+    // Кэш выборки - 128 КБ строк по 64 байта с прямым отображением (порядка L1 + L2 текстурного блока)
+    const size_t lineSize = 64, lineCount = 2048;
+    vector<size_t> lineTags(lineCount, SIZE_MAX);
+    size_t fetchedBytes = 0;
+
+    vector<unsigned char> used(vertexCount, 0);
+    size_t usedVertices = 0, misses = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t v = indices[i];
+        if (timestamp - cacheTime[v] > (uint32_t)VERTEX_CACHE_SIZE) {
+            cacheTime[v] = timestamp++;
+            misses++;
+            if (vertexStride > 0) {
+                size_t first = (size_t)v * vertexStride / lineSize;
+                size_t last = ((size_t)v * vertexStride + vertexStride - 1) / lineSize;
+                for (size_t line = first; line <= last; line++) {
+                    if (lineTags[line % lineCount] != line) {
+                        lineTags[line % lineCount] = line;
+                        fetchedBytes += lineSize;
+                    }
+                }
+            }
+        }
+        usedVertices += used[v] ? 0 : 1;
+        used[v] = 1;
+    }
+
+    stats.acmr = (float)misses / triangleCount;
+    stats.atvr = (float)misses / usedVertices;
+    if (vertexStride > 0) {
+        stats.overfetch = (float)fetchedBytes / (usedVertices * vertexStride);
+    }
+    return stats;
+}
+
+// ==================== Кэш вершин: алгоритм Форсайта ====================
+const int FORSYTH_CACHE_SIZE = 32;   // Моделируемый LRU-кэш
+const int FORSYTH_MAX_VALENCE = 32;  // Дальше бонус за валентность не меняется заметно
+
+struct ForsythTables {
+    float cache[FORSYTH_CACHE_SIZE];
+    float valence[FORSYTH_MAX_VALENCE + 1];
+
+    ForsythTables() {
+        // Вершины последнего треугольника - чуть ниже остальных в начале кэша: иначе
+        // следующий треугольник тянулся бы к тому же ребру и лента вырождалась бы в веер
+        for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+            cache[i] = i < 3 ? 0.75f : pow(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+        }
+        // Вершины с немногими оставшимися треугольниками лучше закончить сразу
+        valence[0] = 0.0f;
+        for (int i = 1; i <= FORSYTH_MAX_VALENCE; i++) {
+            valence[i] = 2.0f / sqrt((float)i);
+        }
+    }
+};
+
+static float forsythScore(const ForsythTables& tables, int cachePosition, uint32_t liveTriangles) {
+    if (liveTriangles == 0) {
+        return -1.0f;
+    }
+    float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+    return score + tables.valence[min(liveTriangles, (uint32_t)FORSYTH_MAX_VALENCE)];
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    static const ForsythTables tables;
+    const uint32_t none = UINT32_MAX;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Невыведенные треугольники каждой вершины: adjacency[offsets[v] .. offsets[v] + live[v])
+    vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        live[indices[i]]++;
+    }
+    vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    vector<uint32_t> adjacency(triangleCount * 3);
+    vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        adjacency[cursor[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScore[v] = forsythScore(tables, -1, live[v]);
+    }
+    vector<float> triangleScore(triangleCount);
+    uint32_t best = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* triangle = &indices[t * 3];
+        triangleScore[t] = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]];
+        if (triangleScore[t] > triangleScore[best]) {
+            best = (uint32_t)t;
+        }
+    }
+
+    vector<unsigned char> emitted(triangleCount, 0);
+    vector<uint32_t> output(triangleCount * 3);
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3], newCache[FORSYTH_CACHE_SIZE + 3];
+    int cacheSize = 0;
+    size_t nextUnemitted = 0;
+
+    for (size_t written = 0; written < triangleCount; written++) {
+        if (best == none) {
+            // Тупик: у вершин кэша не осталось треугольников - берем первый невыведенный
+            while (emitted[nextUnemitted]) {
+                nextUnemitted++;
+            }
+            best = (uint32_t)nextUnemitted;
+        }
+        const uint32_t* triangle = &indices[(size_t)best * 3];
+        memcpy(&output[written * 3], triangle, 3 * sizeof(uint32_t));
+        emitted[best] = 1;
+
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = triangle[k];
+            uint32_t* list = &adjacency[offsets[v]];
+            uint32_t* found = find(list, list + live[v], best);
+            *found = list[--live[v]];
+        }
+
+        // Вершины треугольника - в начало LRU, остальные сдвигаются; вышедшие за размер вытеснены
+        int newSize = 0;
+        newCache[newSize++] = triangle[0];
+        newCache[newSize++] = triangle[1];
+        newCache[newSize++] = triangle[2];
+        for (int i = 0; i < cacheSize; i++) {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache[newSize++] = v;
+            }
+        }
+
+        for (int i = 0; i < newSize; i++) {
+            uint32_t v = newCache[i];
+            float score = forsythScore(tables, i < FORSYTH_CACHE_SIZE ? i : -1, live[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for (uint32_t j = offsets[v]; j < offsets[v] + live[v]; j++) {
+                triangleScore[adjacency[j]] += delta;
+            }
+        }
+
+        // Следующий - лучший среди треугольников вершин кэша
+        cacheSize = min(newSize, FORSYTH_CACHE_SIZE);
+        best = none;
+        float bestScore = -1.0f;
+        for (int i = 0; i < cacheSize; i++) {
+            uint32_t v = newCache[i];
+            cache[i] = v;
+            for (uint32_t j = offsets[v]; j < offsets[v] + live[v]; j++) {
+                uint32_t t = adjacency[j];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+// ==================== Перерисовка ====================
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride,
+    size_t vertexCount, float threshold) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Границы кластеров: жесткие - треугольник без общих вершин с кэшем (порядок до него
+    // ничего не дает ему), мягкие - ACMR кластера уже не хуже порога, и кэш сбрасывается
+    float meshAcmr = analyzeVertexCache(indices, triangleCount * 3, vertexCount, 0).acmr;
+    vector<uint32_t> clusterStarts;
+    vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = VERTEX_CACHE_SIZE + 1;
+    size_t clusterMisses = 0, clusterTriangles = 0;
+    bool split = true;
+    for (size_t t = 0; t < triangleCount; t++) {
+        int misses = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = indices[t * 3 + k];
+            if (timestamp - cacheTime[v] > (uint32_t)VERTEX_CACHE_SIZE) {
+                cacheTime[v] = timestamp++;
+                misses++;
+            }
+        }
+        if (split || misses == 3) {
+            clusterStarts.push_back((uint32_t)t);
+            clusterMisses = clusterTriangles = 0;
+        }
+        clusterMisses += misses;
+        clusterTriangles++;
+        split = clusterMisses <= threshold * meshAcmr * clusterTriangles;
+        if (split) {
+            timestamp += VERTEX_CACHE_SIZE + 1;
+        }
+    }
+    size_t clusterCount = clusterStarts.size();
+    clusterStarts.push_back((uint32_t)triangleCount);
+    if (clusterCount < 2) {
+        return;
+    }
+
+    // Нормаль (сумма векторных произведений, длина - удвоенная площадь) и центр кластера
+    vector<float> clusterData(clusterCount * 6, 0.0f);
+    double meshCenter[3] = { 0.0, 0.0, 0.0 }, meshArea = 0.0;
+    for (size_t c = 0; c < clusterCount; c++) {
+        float* normal = &clusterData[c * 6];
+        float* center = normal + 3;
+        float area = 0.0f;
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            const float* p0 = &positions[indices[t * 3] * positionStride];
+            const float* p1 = &positions[indices[t * 3 + 1] * positionStride];
+            const float* p2 = &positions[indices[t * 3 + 2] * positionStride];
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float triangleArea = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int axis = 0; axis < 3; axis++) {
+                normal[axis] += n[axis];
+                center[axis] += triangleArea * (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+            }
+            area += triangleArea;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            meshCenter[axis] += center[axis];
+            center[axis] = area > 0.0f ? center[axis] / area : 0.0f;
+        }
+        meshArea += area;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        meshCenter[axis] = meshArea > 0.0 ? meshCenter[axis] / meshArea : 0.0;
+    }
+
+    // Чем дальше кластер вынесен от центра меша вдоль своей нормали, тем раньше его рисовать
+    vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        const float* normal = &clusterData[c * 6];
+        const float* center = normal + 3;
+        float length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            key += (center[axis] - (float)meshCenter[axis]) * normal[axis];
+        }
+        sortKey[c] = length > 0.0f ? key / length : 0.0f;
+    }
+    vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        order[c] = (uint32_t)c;
+    }
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (uint32_t c : order) {
+        output.insert(output.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+    }
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+// ==================== Выборка вершин ====================
+size_t optimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    fill(remap, remap + vertexCount, UINT32_MAX);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        if (remap[indices[i]] == UINT32_MAX) {
+            remap[indices[i]] = next++;
+        }
+    }
+    return next;
+}
+
+void remapIndexBuffer(uint32_t* indices, size_t indexCount, const uint32_t* remap) {
+    for (size_t i = 0; i < indexCount; i++) {
+        indices[i] = remap[indices[i]];
+    }
+}
+
+void remapVertexBuffer(void* destination, const void* vertices, size_t vertexCount, size_t vertexStride,
+    const uint32_t* remap) {
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] != UINT32_MAX) {
+            memcpy((unsigned char*)destination + remap[v] * vertexStride,
+                (const unsigned char*)vertices + v * vertexStride, vertexStride);
+        }
+    }
+}
+
+// Перевыборка при порядке треугольников indices после перенумерации вершин (шаг 3)
+static float overfetchAfterRemap(const uint32_t* indices, size_t indexCount, size_t vertexCount, int vertexStride) {
+    vector<uint32_t> remap(vertexCount);
+    vector<uint32_t> remapped(indices, indices + indexCount);
+    size_t usedVertices = optimizeVertexFetchRemap(remap.data(), remapped.data(), remapped.size(), vertexCount);
+    remapIndexBuffer(remapped.data(), remapped.size(), remap.data());
+    return analyzeVertexCache(remapped.data(), remapped.size(), usedVertices, vertexStride).overfetch;
+}
+
+bool optimizeTriangleOrder(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride,
+    size_t vertexCount, int vertexStride) {
+    optimizeVertexCache(indices, indexCount, vertexCount);
+    // Кластеры перерисовки уносят треугольники далеко от соседей, и перенумерация вершин
+    // не всегда возвращает выборке локальность: тогда остается порядок шага 1
+    vector<uint32_t> cacheOrder(indices, indices + indexCount);
+    optimizeOverdraw(indices, indexCount, positions, positionStride, vertexCount);
+    bool overdrawOrder = overfetchAfterRemap(indices, indexCount, vertexCount, vertexStride)
+        <= overfetchAfterRemap(cacheOrder.data(), indexCount, vertexCount, vertexStride) * OVERDRAW_OVERFETCH_TOLERANCE;
+    if (!overdrawOrder) {
+        memcpy(indices, cacheOrder.data(), indexCount * sizeof(uint32_t));
+    }
+    return overdrawOrder;
+}
+
+void optimizeMesh(vector<float>& vertices, int floatsPerVertex, vector<uint32_t>& indices, MeshOptimizeReport* report) {
+    size_t vertexCount = vertices.size() / floatsPerVertex;
+    int stride = floatsPerVertex * (int)sizeof(float);
+    if (report) {
+        report->triangles = (int)(indices.size() / 3);
+        report->before = analyzeVertexCache(indices.data(), indices.size(), vertexCount, stride);
+    }
+    auto start = chrono::steady_clock::now();
+
+    bool overdrawOrder = optimizeTriangleOrder(indices.data(), indices.size(), vertices.data(), floatsPerVertex,
+        vertexCount, stride);
+
+    vector<uint32_t> remap(vertexCount);
+    size_t usedVertices = optimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertexCount);
+    remapIndexBuffer(indices.data(), indices.size(), remap.data());
+    vector<float> reordered(usedVertices * floatsPerVertex);
+    remapVertexBuffer(reordered.data(), vertices.data(), vertexCount, stride, remap.data());
+    vertices.swap(reordered);
+
+    if (report) {
+        report->overdrawOrder = overdrawOrder;
+        report->milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        report->after = analyzeVertexCache(indices.data(), indices.size(), usedVertices, stride);
+    }
+}
+
+void printOptimizeReport(const char* name, const MeshOptimizeReport& report) {
+    cout << "Mesh optimization (" << name << "): " << report.triangles << " triangles, ACMR "
+        << report.before.acmr << " -> " << report.after.acmr << ", ATVR "
+        << report.before.atvr << " -> " << report.after.atvr << ", overfetch "
+        << report.before.overfetch << " -> " << report.after.overfetch << ", overdraw order "
+        << (report.overdrawOrder ? "kept" : "dropped") << ", " << report.milliseconds << " ms" << endl;
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ==================== Оптимизация порядка треугольников и вершин ====================
+// Три шага перед загрузкой меша в буферы (в этом порядке):
+// 1. Кэш преобразованных вершин: треугольники переупорядочиваются жадно по Форсайту
+//    ("Linear-Speed Vertex Cache Optimisation") - следующим берется треугольник с наибольшей
+//    суммой оценок вершин, а оценка растет, если вершина недавно была в модели LRU-кэша
+//    на 32 вершины и если у нее осталось мало невыведенных треугольников.
+// 2. Перерисовка: порядок после шага 1 режется на кластеры (там, где кэш все равно
+//    сбрасывается, и там, где ACMR кластера не хуже threshold * ACMR меша), и кластеры
+//    сортируются так, чтобы первыми шли обращенные наружу: они чаще загораживают остальные.
+// 3. Выборка вершин: вершины перенумеровываются в порядке первого обращения,
+//    и выборка идет по буферу почти подряд.
+// Порядок шага 2 остается, только если перевыборка после шага 3 хуже, чем без шага 2,
+// не больше чем в OVERDRAW_OVERFETCH_TOLERANCE раз: на мешах в порядке генератора кластеры
+// разносят соседние треугольники, и перевыборка растет с 1.0 до 1.2 (optimizeTriangleOrder -
+// общий для optimizeMesh и импорта OBJ).
+// Оценка - ACMR (промахи на треугольник, 0.5..3) и ATVR (промахи на вершину, от 1)
+// на FIFO-кэше из 16 вершин, как у большинства GPU, и перевыборка байт вершин
+// через кэш строк по 64 байта.
+
+const int VERTEX_CACHE_SIZE = 16;  // FIFO-кэш для оценки
+const float OVERDRAW_OVERFETCH_TOLERANCE = 1.05f;
+
+struct VertexCacheStats {
+    float acmr = 0.0f;       // Промахов кэша на треугольник
+    float atvr = 0.0f;       // Промахов на используемую вершину
+    float overfetch = 0.0f;  // Прочитано байт вершин / размер используемых вершин
+};
+
+struct MeshOptimizeReport {
+    int triangles = 0;
+    VertexCacheStats before, after;
+    bool overdrawOrder = false;  // Оставлен порядок шага 2 (false - перевыборка выросла бы)
+    double milliseconds = 0.0;
+};
+
+// vertexStride - размер вершины в байтах (только для перевыборки)
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, int vertexStride);
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// positions - первые 3 float каждой вершины, positionStride - расстояние между вершинами в float.
+// threshold > 1 разрешает ухудшить ACMR ради более мелких кластеров
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride,
+    size_t vertexCount, float threshold = 1.05f);
+
+// remap[старый номер] = новый номер в порядке первого обращения (неиспользуемые - UINT32_MAX).
+// Возвращает число используемых вершин
+size_t optimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+void remapIndexBuffer(uint32_t* indices, size_t indexCount, const uint32_t* remap);
+// destination не должен совпадать с vertices; неиспользуемые вершины выбрасываются
+void remapVertexBuffer(void* destination, const void* vertices, size_t vertexCount, size_t vertexStride,
+    const uint32_t* remap);
+
+// Шаги 1 и 2 с проверкой перевыборки после шага 3 (vertexStride - размер вершины в байтах).
+// true - оставлен порядок шага 2, false - порядок шага 1
+bool optimizeTriangleOrder(uint32_t* indices, size_t indexCount, const float* positions, size_t positionStride,
+    size_t vertexCount, int vertexStride);
+
+// Все три шага для меша из float-вершин (позиция - первые 3 float); report может быть nullptr
+void optimizeMesh(std::vector<float>& vertices, int floatsPerVertex, std::vector<uint32_t>& indices,
+    MeshOptimizeReport* report);
+
+void printOptimizeReport(const char* name, const MeshOptimizeReport& report);
@@ -0,0 +1,278 @@
+﻿#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+// Квадрика плоскости ax + by + cz + d = 0 с весом - площадью треугольника
+struct Quadric {
+    double a2 = 0, b2 = 0, c2 = 0, d2 = 0, ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0;
+    double weight = 0;
+
+    void addPlane(double a, double b, double c, double d, double w) {
+        a2 += w * a * a; b2 += w * b * b; c2 += w * c * c; d2 += w * d * d;
+        ab += w * a * b; ac += w * a * c; ad += w * a * d;
+        bc += w * b * c; bd += w * b * d; cd += w * c * d;
+        weight += w;
+    }
+
+    void add(const Quadric& q) {
+        a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+        ab += q.ab; ac += q.ac; ad += q.ad;
+        bc += q.bc; bd += q.bd; cd += q.cd;
+        weight += q.weight;
+    }
+
+    // Сумма взвешенных квадратов расстояний от точки до плоскостей
+    double evaluate(const float* p) const {
+        double x = p[0], y = p[1], z = p[2];
+        double result = a2 * x * x + b2 * y * y + c2 * z * z + d2
+            + 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+        return max(result, 0.0);
+    }
+};
+
+// Среднеквадратичное расстояние, если вершины двух квадрик встанут в точку p
+static float collapseError(const Quadric& from, const Quadric& to, const float* p) {
+    Quadric sum = from;
+    sum.add(to);
+    return sum.weight > 0.0 ? (float)sqrt(sum.evaluate(p) / sum.weight) : 0.0f;
+}
+
+static void triangleNormal(const float* p0, const float* p1, const float* p2, float* normal) {
+    float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Треугольники каждой вершины: adjacency[offsets[v] .. offsets[v + 1])
+static void buildAdjacency(const vector<uint32_t>& indices, size_t vertexCount,
+    vector<uint32_t>& offsets, vector<uint32_t>& adjacency) {
+    offsets.assign(vertexCount + 1, 0);
+    for (uint32_t v : indices) {
+        offsets[v + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+    adjacency.resize(indices.size());
+    vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[cursor[indices[i]]++] = (uint32_t)(i / 3);
+    }
+}
+
+struct Collapse {
+    uint32_t from, to;
+    float error;
+};
+
+size_t simplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    size_t targetIndexCount, float targetError, float* resultError) {
+    vector<uint32_t> current(indices, indices + indexCount / 3 * 3);
+    float maxError = 0.0f;
+
+    // Позиции в долях наибольшего габарита: ошибка не зависит от единиц модели
+    float lower[3] = { 0.0f, 0.0f, 0.0f }, upper[3] = { 0.0f, 0.0f, 0.0f };
+    for (size_t v = 0; v < vertexCount; v++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float value = positions[v * positionStride + axis];
+            lower[axis] = v == 0 ? value : min(lower[axis], value);
+            upper[axis] = v == 0 ? value : max(upper[axis], value);
+        }
+    }
+    float extent = max(upper[0] - lower[0], max(upper[1] - lower[1], upper[2] - lower[2]));
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    vector<float> points(vertexCount * 3);
+    for (size_t v = 0; v < vertexCount; v++) {
+        for (int axis = 0; axis < 3; axis++) {
+            points[v * 3 + axis] = (positions[v * positionStride + axis] - lower[axis]) * scale;
+        }
+    }
+
+    vector<uint32_t> offsets, adjacency;
+    buildAdjacency(current, vertexCount, offsets, adjacency);
+
+    // Ребро a->b без обратного b->a - край меша или шов атрибутов: его концы закреплены
+    vector<unsigned char> locked(vertexCount, 0);
+    for (size_t i = 0; i < current.size(); i++) {
+        uint32_t a = current[i], b = current[i - i % 3 + (i + 1) % 3];
+        bool paired = false;
+        for (uint32_t j = offsets[b]; j < offsets[b + 1] && !paired; j++) {
+            const uint32_t* triangle = &current[(size_t)adjacency[j] * 3];
+            for (int k = 0; k < 3; k++) {
+                paired = paired || (triangle[k] == b && triangle[(k + 1) % 3] == a);
+            }
+        }
+        if (!paired) {
+            locked[a] = locked[b] = 1;
+        }
+    }
+
+    vector<Quadric> quadrics(vertexCount);
+    for (size_t t = 0; t < current.size() / 3; t++) {
+        const float* p[3] = { &points[current[t * 3] * 3], &points[current[t * 3 + 1] * 3], &points[current[t * 3 + 2] * 3] };
+        float normal[3];
+        triangleNormal(p[0], p[1], p[2], normal);
+        double length = sqrt((double)normal[0] * normal[0] + (double)normal[1] * normal[1] + (double)normal[2] * normal[2]);
+        if (length == 0.0) {
+            continue;
+        }
+        double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        double d = -(a * p[0][0] + b * p[0][1] + c * p[0][2]);
+        for (int k = 0; k < 3; k++) {
+            quadrics[current[t * 3 + k]].addPlane(a, b, c, d, 0.5 * length);
+        }
+    }
+
+    vector<uint32_t> remap(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        remap[v] = (uint32_t)v;
+    }
+    vector<unsigned char> touched(vertexCount);
+    vector<Collapse> collapses;
+
+    while (current.size() > targetIndexCount) {
+        // Каждое внутреннее ребро встречается в двух треугольниках, в одном из них - как a < b
+        collapses.clear();
+        for (size_t i = 0; i < current.size(); i++) {
+            uint32_t a = current[i], b = current[i - i % 3 + (i + 1) % 3];
+            if (a >= b || (locked[a] && locked[b])) {
+                continue;
+            }
+            float toB = locked[a] ? INFINITY : collapseError(quadrics[a], quadrics[b], &points[b * 3]);
+            float toA = locked[b] ? INFINITY : collapseError(quadrics[a], quadrics[b], &points[a * 3]);
+            collapses.push_back(toB <= toA ? Collapse{ a, b, toB } : Collapse{ b, a, toA });
+        }
+        sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // Стягивание убирает в среднем два треугольника
+        size_t limit = max<size_t>((current.size() - targetIndexCount) / 6, 1);
+        size_t applied = 0;
+        fill(touched.begin(), touched.end(), 0);
+        for (const Collapse& collapse : collapses) {
+            if (applied >= limit || collapse.error > targetError) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            // Треугольники вокруг from, кроме исчезающих, не должны перевернуться
+            bool flips = false;
+            for (uint32_t j = offsets[collapse.from]; j < offsets[collapse.from + 1] && !flips; j++) {
+                const uint32_t* triangle = &current[(size_t)adjacency[j] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    continue;
+                }
+                const float* before[3];
+                const float* after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = &points[triangle[k] * 3];
+                    after[k] = triangle[k] == collapse.from ? &points[collapse.to * 3] : before[k];
+                }
+                float n0[3], n1[3];
+                triangleNormal(before[0], before[1], before[2], n0);
+                triangleNormal(after[0], after[1], after[2], n1);
+                float dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+                float lengths = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+                flips = dot < 0.25f * lengths;
+            }
+            if (flips) {
+                continue;
+            }
+
+            // Окрестность from за этот проход больше не меняется: проверка выше остается верной
+            for (uint32_t j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++) {
+                const uint32_t* triangle = &current[(size_t)adjacency[j] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxError = max(maxError, collapse.error);
+            applied++;
+        }
+        if (applied == 0) {
+            break;
+        }
+
+        // Стянутые вершины заменяются целевыми, выродившиеся треугольники выбрасываются
+        size_t kept = 0;
+        for (size_t t = 0; t < current.size() / 3; t++) {
+            uint32_t a = remap[current[t * 3]], b = remap[current[t * 3 + 1]], c = remap[current[t * 3 + 2]];
+            if (a != b && b != c && a != c) {
+                current[kept++] = a;
+                current[kept++] = b;
+                current[kept++] = c;
+            }
+        }
+        current.resize(kept);
+        buildAdjacency(current, vertexCount, offsets, adjacency);
+    }
+
+    copy(current.begin(), current.end(), destination);
+    if (resultError) {
+        *resultError = maxError;
+    }
+    return current.size();
+}
+
+int MeshLodChain::select(float pixelsPerExtent, float tolerancePixels) const {
+    for (int level = (int)levels.size() - 1; level > 0; level--) {
+        if (levels[level].error * pixelsPerExtent <= tolerancePixels) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+MeshLodChain buildLodChain(vector<uint32_t>& indices, const float* positions, size_t positionStride,
+    size_t vertexCount, bool optimizeLevels, int maxLevels, size_t minTriangles) {
+    MeshLodChain chain;
+    MeshLod base;
+    base.indexCount = (int)indices.size();
+    chain.levels.push_back(base);
+
+    // Ошибки уровней складываются: каждый упрощается из предыдущего
+    float error = 0.0f;
+    while ((int)chain.levels.size() < maxLevels) {
+        const MeshLod& previous = chain.levels.back();
+        size_t target = (size_t)previous.indexCount / 6 * 3;
+        if (target / 3 < minTriangles) {
+            break;
+        }
+        vector<uint32_t> simplified(previous.indexCount);
+        float levelError = 0.0f;
+        size_t count = simplifyMesh(simplified.data(), &indices[previous.firstIndex], previous.indexCount,
+            positions, positionStride, vertexCount, target, 1.0f, &levelError);
+        if (count > (size_t)previous.indexCount / 10 * 9) {
+            break;
+        }
+        if (optimizeLevels) {
+            optimizeVertexCache(simplified.data(), count, vertexCount);
+        }
+        error += levelError;
+
+        MeshLod level;
+        level.firstIndex = (int)indices.size();
+        level.indexCount = (int)count;
+        level.error = error;
+        indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
+        chain.levels.push_back(level);
+    }
+    return chain;
+}
+
+void printLodChain(const char* name, const MeshLodChain& chain) {
+    cout << "Mesh LOD chain (" << name << "): " << chain.levels.size() << " levels" << endl;
+    for (size_t level = 0; level < chain.levels.size(); level++) {
+        cout << "  LOD " << level << ": " << chain.triangles((int)level) << " triangles, error "
+            << chain.levels[level].error << " of extent" << endl;
+    }
+}
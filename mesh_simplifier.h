@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ==================== Упрощение мешей (квадрики ошибки) ====================
+// Стягивание ребер по Гарланду-Хекберту: у каждой вершины квадрика - сумма квадратов расстояний
+// до плоскостей ее треугольников (с весом по площади), ребро a->b стоит столько, сколько
+// квадрика a + b дает в точке b. Вершина переезжает только в соседнюю, поэтому новых вершин
+// нет: все уровни детализации рисуются из одного вершинного буфера, различаются только индексы.
+// Стягивания идут проходами: ребра сортируются по цене, и за проход каждая окрестность
+// меняется не больше одного раза. Стягивание, переворачивающее треугольник, пропускается.
+// Вершины на открытых ребрах и на швах (та же позиция с другими UV или нормалью - в индексах
+// это тоже открытые ребра) не двигаются: края и швы текстуры остаются на месте.
+// Ошибка - среднеквадратичное расстояние до исходных плоскостей в долях наибольшего габарита меша.
+
+// Пишет в destination (не больше indexCount индексов) упрощенные треугольники и возвращает
+// их число индексов. Останавливается на targetIndexCount или когда следующее стягивание
+// дало бы ошибку больше targetError; resultError - наибольшая ошибка сделанных стягиваний
+size_t simplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+struct MeshLod {
+    int firstIndex = 0;
+    int indexCount = 0;
+    float error = 0.0f;  // В долях наибольшего габарита меша
+};
+
+struct MeshLodChain {
+    std::vector<MeshLod> levels;  // 0 - исходный меш, дальше все грубее
+
+    // Самый грубый уровень, чья ошибка на экране не больше tolerancePixels
+    // (pixelsPerExtent - сколько пикселей занимает наибольший габарит меша)
+    int select(float pixelsPerExtent, float tolerancePixels) const;
+    int triangles(int level) const { return levels[level].indexCount / 3; }
+};
+
+// Строит уровни вдвое меньше предыдущего, пока их не станет maxLevels, треугольников -
+// меньше minTriangles или упрощение не застрянет (меньше 10% сокращения). Индексы уровней
+// дописываются в indices за исходными; optimizeLevels - порядок треугольников каждого уровня
+// под кэш вершин (вершинный буфер общий, поэтому только optimizeVertexCache)
+MeshLodChain buildLodChain(std::vector<uint32_t>& indices, const float* positions, size_t positionStride,
+    size_t vertexCount, bool optimizeLevels, int maxLevels = 12, size_t minTriangles = 256);
+
+void printLodChain(const char* name, const MeshLodChain& chain);
@@ -0,0 +1,245 @@
+﻿#include "mip_builder.h"
+#include "math3d.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+const char* mipFilterName(MipFilter filter) {
+    return filter == MIP_FILTER_KAISER ? "kaiser" : "box";
+}
+
+int mipLevelCount(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = max(1, width / 2);
+        height = max(1, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+// ==================== Таблицы sRGB ====================
+static const int LINEAR_TABLE_SIZE = 1 << 14;
+
+struct ColorTables {
+    float srgbToLinear[256];
+    float identity[256];
+    unsigned char linearToSrgb[LINEAR_TABLE_SIZE + 1];
+    unsigned char linearToByte[LINEAR_TABLE_SIZE + 1];
+
+    ColorTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+            identity[i] = c;
+        }
+        for (int i = 0; i <= LINEAR_TABLE_SIZE; i++) {
+            float l = (float)i / LINEAR_TABLE_SIZE;
+            float s = l <= 0.0031308f ? l * 12.92f : 1.055f * pow(l, 1.0f / 2.4f) - 0.055f;
+            linearToSrgb[i] = (unsigned char)(s * 255.0f + 0.5f);
+            linearToByte[i] = (unsigned char)(l * 255.0f + 0.5f);
+        }
+    }
+};
+
+static const ColorTables& colorTables() {
+    static ColorTables tables;
+    return tables;
+}
+
+// ==================== Веса фильтра ====================
+// Для каждого пикселя уровня по одной оси - taps индексов источника и весов
+struct AxisTaps {
+    int taps = 0;
+    vector<int> index;
+    vector<float> weight;
+};
+
+static float besselI0(float x) {
+    // Ряд sum((x/2)^2k / (k!)^2) сходится быстро для alpha порядка 4
+    float sum = 1.0f, term = 1.0f, q = x * x * 0.25f;
+    for (int k = 1; k < 20; k++) {
+        term *= q / (float)(k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static AxisTaps buildAxisTaps(int sourceSize, int targetSize, MipFilter filter) {
+    AxisTaps axis;
+    float scale = (float)sourceSize / targetSize;
+    // При уменьшении ширина ядра - в пикселях результата, при увеличении - в пикселях источника
+    float support = max(scale, 1.0f);
+    const float radius = 2.0f;
+    const float alpha = 4.0f;
+
+    // Для box при целом масштабе отрезок ложится ровно на scale пикселей, иначе задевает еще один
+    int boxTaps = (int)ceil(scale) + (scale != floor(scale) ? 1 : 0);
+    axis.taps = filter == MIP_FILTER_KAISER ? (int)ceil(2.0f * radius * support) + 1 : boxTaps;
+    axis.index.resize((size_t)targetSize * axis.taps);
+    axis.weight.resize((size_t)targetSize * axis.taps);
+
+    for (int x = 0; x < targetSize; x++) {
+        int* index = &axis.index[(size_t)x * axis.taps];
+        float* weight = &axis.weight[(size_t)x * axis.taps];
+        float sum = 0.0f;
+
+        if (filter == MIP_FILTER_KAISER) {
+            float center = (x + 0.5f) * scale;
+            int first = (int)floor(center - radius * support + 0.5f);
+            for (int k = 0; k < axis.taps; k++) {
+                int i = first + k;
+                float t = (i + 0.5f - center) / support;
+                float w = 0.0f;
+                if (fabs(t) < radius) {
+                    float sinc = t == 0.0f ? 1.0f : sin(MATH3D_PI * t) / (MATH3D_PI * t);
+                    float r = t / radius;
+                    w = sinc * besselI0(alpha * sqrt(1.0f - r * r)) / besselI0(alpha);
+                }
+                index[k] = ((i % sourceSize) + sourceSize) % sourceSize;
+                weight[k] = w;
+                sum += w;
+            }
+        }
+        else {
+            // Доля покрытия каждого пикселя источника отрезком [x * scale, (x + 1) * scale]
+            float begin = x * scale, end = (x + 1) * scale;
+            int first = (int)floor(begin);
+            for (int k = 0; k < axis.taps; k++) {
+                int i = first + k;
+                float w = max(0.0f, min(end, (float)i + 1.0f) - max(begin, (float)i));
+                index[k] = min(i, sourceSize - 1);
+                weight[k] = w;
+                sum += w;
+            }
+        }
+
+        for (int k = 0; k < axis.taps; k++) {
+            weight[k] /= sum;
+        }
+    }
+    return axis;
+}
+
+// ==================== Проходы фильтра ====================
+// accumulator += weight * row (n значений)
+static inline void accumulateRow(float* accumulator, const float* row, float weight, int n) {
+    int i = 0;
+#ifdef MATH3D_SSE
+    __m128 w = _mm_set1_ps(weight);
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_loadu_ps(accumulator + i);
+        _mm_storeu_ps(accumulator + i, _mm_add_ps(a, _mm_mul_ps(w, _mm_loadu_ps(row + i))));
+    }
+#endif
+    for (; i < n; i++) {
+        accumulator[i] += weight * row[i];
+    }
+}
+
+// По горизонтали и обратно в байты; число каналов известно при компиляции, чтобы циклы развернулись
+template <int CHANNELS>
+static void horizontalPass(const float* column, const AxisTaps& horizontal, int width,
+    const unsigned char* const encode[4], unsigned char* out) {
+    for (int x = 0; x < width; x++) {
+        const int* index = &horizontal.index[(size_t)x * horizontal.taps];
+        const float* weight = &horizontal.weight[(size_t)x * horizontal.taps];
+        float sum[CHANNELS] = {};
+        for (int k = 0; k < horizontal.taps; k++) {
+            const float* texel = column + (size_t)index[k] * CHANNELS;
+            for (int ch = 0; ch < CHANNELS; ch++) {
+                sum[ch] += weight[k] * texel[ch];
+            }
+        }
+        for (int ch = 0; ch < CHANNELS; ch++) {
+            // Kaiser дает небольшие выбросы за [0, 1] - они обрезаются
+            float v = min(max(sum[ch], 0.0f), 1.0f);
+            out[x * CHANNELS + ch] = encode[ch][(int)(v * LINEAR_TABLE_SIZE + 0.5f)];
+        }
+    }
+}
+
+static void resampleLevel(const TextureImage& source, TextureImage& target, int width, int height,
+    MipFilter filter, bool srgb, ThreadPool& pool) {
+    const ColorTables& tables = colorTables();
+    int channels = source.channels;
+    target.width = width;
+    target.height = height;
+    target.channels = channels;
+    target.pixels.resize((size_t)target.width * target.height * channels);
+
+    AxisTaps horizontal = buildAxisTaps(source.width, target.width, filter);
+    AxisTaps vertical = buildAxisTaps(source.height, target.height, filter);
+
+    // Таблицы по каналам: цвет - sRGB, альфа (последний канал RGBA и яркость-альфа) - линейная
+    int alphaChannel = channels == 4 || channels == 2 ? channels - 1 : -1;
+    const float* decode[4];
+    const unsigned char* encode[4];
+    for (int ch = 0; ch < 4; ch++) {
+        bool color = srgb && ch != alphaChannel;
+        decode[ch] = color ? tables.srgbToLinear : tables.identity;
+        encode[ch] = color ? tables.linearToSrgb : tables.linearToByte;
+    }
+
+    int rowValues = source.width * channels;
+    int grain = max(1, 32768 / target.width);
+    pool.parallelFor(target.height, grain, [&](int begin, int end) {
+        // Кольцо строк источника в линейных float: соседние строки уровня делят большую часть taps,
+        // и каждая строка источника декодируется один раз, пока не вытеснена
+        int ringSize = vertical.taps + 1;
+        vector<float> ring((size_t)ringSize * rowValues);
+        vector<int> ringRow(ringSize, -1);
+        vector<float> column(rowValues);
+
+        for (int y = begin; y < end; y++) {
+            // По вертикали: взвешенная сумма целых строк
+            fill(column.begin(), column.end(), 0.0f);
+            for (int k = 0; k < vertical.taps; k++) {
+                float w = vertical.weight[(size_t)y * vertical.taps + k];
+                if (w == 0.0f) {
+                    continue;
+                }
+                int row = vertical.index[(size_t)y * vertical.taps + k];
+                int slot = row % ringSize;
+                float* linear = &ring[(size_t)slot * rowValues];
+                if (ringRow[slot] != row) {
+                    const unsigned char* in = &source.pixels[(size_t)row * rowValues];
+                    for (int ch = 0; ch < channels; ch++) {
+                        const float* table = decode[ch];
+                        for (int i = ch; i < rowValues; i += channels) {
+                            linear[i] = table[in[i]];
+                        }
+                    }
+                    ringRow[slot] = row;
+                }
+                accumulateRow(column.data(), linear, w, rowValues);
+            }
+
+            unsigned char* out = &target.pixels[(size_t)y * target.width * channels];
+            switch (channels) {
+            case 1: horizontalPass<1>(column.data(), horizontal, target.width, encode, out); break;
+            case 2: horizontalPass<2>(column.data(), horizontal, target.width, encode, out); break;
+            case 3: horizontalPass<3>(column.data(), horizontal, target.width, encode, out); break;
+            default: horizontalPass<4>(column.data(), horizontal, target.width, encode, out); break;
+            }
+        }
+    });
+}
+
+void buildMipChain(const TextureImage& base, vector<TextureImage>& mips, MipFilter filter, bool srgb,
+    ThreadPool& pool) {
+    mips.assign(mipLevelCount(base.width, base.height) - 1, TextureImage());
+    const TextureImage* source = &base;
+    for (TextureImage& level : mips) {
+        resampleLevel(*source, level, max(1, source->width / 2), max(1, source->height / 2), filter, srgb, pool);
+        source = &level;
+    }
+}
+
+void resampleImage(const TextureImage& source, int width, int height, TextureImage& target, MipFilter filter,
+    bool srgb, ThreadPool& pool) {
+    resampleLevel(source, target, width, height, filter, srgb, pool);
+}
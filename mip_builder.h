@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include "texture_image.h"
+
+#include <vector>
+
+class ThreadPool;
+
+// ==================== Построение мипмапов на CPU ====================
+// Каждый уровень получается из предыдущего разделимым фильтром: сначала по столбцам
+// (накопление строк - SIMD), затем по строкам. Цвета в sRGB переводятся в линейное
+// пространство, фильтруются и кодируются обратно; альфа-канал всегда линейный.
+// Координаты за краем заворачиваются, как при GL_REPEAT. Строки уровня делятся между потоками пула.
+
+enum MipFilter {
+    MIP_FILTER_BOX,     // Среднее по покрытию 2x2 (для нечетных сторон - с дробными весами)
+    MIP_FILTER_KAISER,  // sinc с окном Кайзера, радиус 2 пикселя уровня: резче и без муара
+};
+
+const char* mipFilterName(MipFilter filter);
+
+// Число уровней вместе с базовым, до 1x1
+int mipLevelCount(int width, int height);
+
+// mips[0] - уровень 1 (вдвое меньше base), последний - 1x1; base в mips не входит
+void buildMipChain(const TextureImage& base, std::vector<TextureImage>& mips, MipFilter filter, bool srgb,
+    ThreadPool& pool);
+
+// Тот же фильтр для произвольного размера (в обе стороны) - приведение изображения к размеру
+// слоя массива текстур
+void resampleImage(const TextureImage& source, int width, int height, TextureImage& target, MipFilter filter,
+    bool srgb, ThreadPool& pool);
@@ -0,0 +1,605 @@
+﻿#include "obj_importer.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+static double millisecondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// ==================== Разбор чисел ====================
+// strtof зависит от локали и заметно медленнее: мантисса копится в uint64 (до 18 значащих цифр),
+// порядок применяется одним умножением в double - для результата во float этого с запасом хватает
+
+static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const double negativePowersOf10[] = {
+    1e-0, 1e-1, 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7, 1e-8, 1e-9, 1e-10, 1e-11,
+    1e-12, 1e-13, 1e-14, 1e-15, 1e-16, 1e-17, 1e-18, 1e-19, 1e-20, 1e-21, 1e-22
+};
+static const uint64_t MANTISSA_LIMIT = 100000000000000000ull;  // 1e17: еще одна цифра помещается
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
+
+static inline const char* skipLine(const char* p, const char* end) {
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    return newline ? newline + 1 : end;
+}
+
+static const char* parseFloat(const char* p, const char* end, float& value) {
+    p = skipBlanks(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (mantissa < MANTISSA_LIMIT) {
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+        else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (mantissa < MANTISSA_LIMIT) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        int power = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            power = min(power * 10 + (*p - '0'), 1000);
+        }
+        exponent += negativeExponent ? -power : power;
+    }
+
+    double result = (double)mantissa;
+    while (exponent > 22) { result *= 1e22; exponent -= 22; }
+    while (exponent < -22) { result *= 1e-22; exponent += 22; }
+    result *= exponent >= 0 ? powersOf10[exponent] : negativePowersOf10[-exponent];
+    value = (float)(negative ? -result : result);
+    return p;
+}
+
+static inline const char* parseInt(const char* p, const char* end, int& value, bool& present) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    const char* start = p;
+    long long result = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        result = min(result * 10 + (*p - '0'), (long long)INT32_MAX);
+    }
+    present = p != start;
+    value = (int)(negative ? -result : result);
+    return p;
+}
+
+// ==================== Куски файла ====================
+
+enum ObjLineKind { OBJ_OTHER, OBJ_POSITION, OBJ_TEXCOORD, OBJ_NORMAL, OBJ_FACE };
+
+static ObjLineKind classifyLine(const char*& p, const char* end) {
+    p = skipBlanks(p, end);
+    if (end - p < 2) {
+        return OBJ_OTHER;
+    }
+    if (p[0] == 'v') {
+        if (isBlank(p[1])) { p += 2; return OBJ_POSITION; }
+        if (end - p >= 3 && isBlank(p[2])) {
+            if (p[1] == 't') { p += 3; return OBJ_TEXCOORD; }
+            if (p[1] == 'n') { p += 3; return OBJ_NORMAL; }
+        }
+    }
+    else if (p[0] == 'f' && isBlank(p[1])) {
+        p += 2;
+        return OBJ_FACE;
+    }
+    return OBJ_OTHER;
+}
+
+// Число вершин в строке грани (токены до конца строки)
+static int countFaceCorners(const char* p, const char* end) {
+    int count = 0;
+    while (true) {
+        p = skipBlanks(p, end);
+        if (p >= end || *p == '\n' || *p == '\r' || *p == '#') {
+            return count;
+        }
+        count++;
+        while (p < end && !isBlank(*p) && *p != '\n' && *p != '\r') p++;
+    }
+}
+
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    int positions = 0, texcoords = 0, normals = 0, triangles = 0;
+    int positionBase = 0, texcoordBase = 0, normalBase = 0, triangleBase = 0;
+    float lower[3] = { 0.0f, 0.0f, 0.0f }, upper[3] = { 0.0f, 0.0f, 0.0f };
+    float uvMin = 0.0f, uvMax = 0.0f;
+    bool badIndex = false;
+};
+
+static void countChunk(ObjChunk& chunk) {
+    for (const char* p = chunk.begin; p < chunk.end; p = skipLine(p, chunk.end)) {
+        const char* line = p;
+        switch (classifyLine(line, chunk.end)) {
+        case OBJ_POSITION: chunk.positions++; break;
+        case OBJ_TEXCOORD: chunk.texcoords++; break;
+        case OBJ_NORMAL: chunk.normals++; break;
+        case OBJ_FACE: chunk.triangles += max(countFaceCorners(line, chunk.end) - 2, 0); break;
+        default: break;
+        }
+    }
+}
+
+// Индекс OBJ (с 1, отрицательный - от последнего определенного) в индекс массива; -1 - ошибка
+static inline int resolveIndex(int index, int definedSoFar, int total) {
+    int resolved = index > 0 ? index - 1 : definedSoFar + index;
+    return index != 0 && resolved >= 0 && resolved < total ? resolved : -1;
+}
+
+// ==================== ObjImporter ====================
+
+bool ObjImporter::load(const char* path, ThreadPool& pool) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cout << "Failed to open mesh " << path << endl;
+        return false;
+    }
+    return parse((const char*)file.data(), file.size(), pool);
+}
+
+bool ObjImporter::parse(const char* text, size_t size, ThreadPool& pool) {
+    auto start = chrono::steady_clock::now();
+    release();
+    importStats = ObjImportStats();
+    importStats.fileBytes = size;
+
+    // Куски по границам строк: несколько на поток, чтобы выровнять нагрузку
+    int chunkCount = (int)max<size_t>(1, min<size_t>(pool.threadCount() * 4, size / MIN_CHUNK_BYTES));
+    vector<ObjChunk> chunks;
+    const char* end = text + size;
+    const char* chunkStart = text;
+    for (int i = 1; i <= chunkCount && chunkStart < end; i++) {
+        const char* chunkEnd = i == chunkCount ? end : skipLine(max(chunkStart, text + size * i / chunkCount), end);
+        ObjChunk chunk;
+        chunk.begin = chunkStart;
+        chunk.end = chunkEnd;
+        chunks.push_back(chunk);
+        chunkStart = chunkEnd;
+    }
+    importStats.chunks = (int)chunks.size();
+
+    pool.parallelFor((int)chunks.size(), 1, [&](int begin, int chunkEnd) {
+        for (int i = begin; i < chunkEnd; i++) countChunk(chunks[i]);
+    });
+
+    int totalPositions = 0, totalTexcoords = 0, totalNormals = 0, totalTriangles = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.positionBase = totalPositions;
+        chunk.texcoordBase = totalTexcoords;
+        chunk.normalBase = totalNormals;
+        chunk.triangleBase = totalTriangles;
+        totalPositions += chunk.positions;
+        totalTexcoords += chunk.texcoords;
+        totalNormals += chunk.normals;
+        totalTriangles += chunk.triangles;
+    }
+    if (totalPositions == 0 || totalTriangles == 0) {
+        cout << "OBJ has no triangles" << endl;
+        return false;
+    }
+    positions.resize((size_t)totalPositions * 3);
+    texcoords.resize((size_t)totalTexcoords * 2);
+    normals.resize((size_t)totalNormals * 3);
+    corners.resize((size_t)totalTriangles * 9);
+
+    // Второй проход: каждый кусок пишет в свою часть общих массивов
+    pool.parallelFor((int)chunks.size(), 1, [&](int begin, int chunkEnd) {
+        for (int c = begin; c < chunkEnd; c++) {
+            ObjChunk& chunk = chunks[c];
+            int position = chunk.positionBase, texcoord = chunk.texcoordBase, normal = chunk.normalBase;
+            int32_t* corner = &corners[(size_t)chunk.triangleBase * 9];
+            bool firstPosition = true, firstTexcoord = true;
+            for (const char* p = chunk.begin; p < chunk.end; p = skipLine(p, chunk.end)) {
+                const char* line = p;
+                ObjLineKind kind = classifyLine(line, chunk.end);
+                if (kind == OBJ_POSITION) {
+                    float* out = &positions[(size_t)position++ * 3];
+                    for (int axis = 0; axis < 3; axis++) {
+                        line = parseFloat(line, chunk.end, out[axis]);
+                        chunk.lower[axis] = firstPosition ? out[axis] : min(chunk.lower[axis], out[axis]);
+                        chunk.upper[axis] = firstPosition ? out[axis] : max(chunk.upper[axis], out[axis]);
+                    }
+                    firstPosition = false;
+                }
+                else if (kind == OBJ_TEXCOORD) {
+                    float* out = &texcoords[(size_t)texcoord++ * 2];
+                    line = parseFloat(line, chunk.end, out[0]);
+                    line = parseFloat(line, chunk.end, out[1]);
+                    chunk.uvMin = firstTexcoord ? min(out[0], out[1]) : min(chunk.uvMin, min(out[0], out[1]));
+                    chunk.uvMax = firstTexcoord ? max(out[0], out[1]) : max(chunk.uvMax, max(out[0], out[1]));
+                    firstTexcoord = false;
+                }
+                else if (kind == OBJ_NORMAL) {
+                    float* out = &normals[(size_t)normal++ * 3];
+                    for (int axis = 0; axis < 3; axis++) {
+                        line = parseFloat(line, chunk.end, out[axis]);
+                    }
+                }
+                else if (kind == OBJ_FACE) {
+                    // Веер: (первый, предыдущий, текущий)
+                    int32_t first[3] = { 0, 0, 0 }, previous[3] = { 0, 0, 0 };
+                    for (int k = 0;; k++) {
+                        line = skipBlanks(line, chunk.end);
+                        if (line >= chunk.end || *line == '\n' || *line == '\r' || *line == '#') {
+                            break;
+                        }
+                        int32_t current[3] = { -1, -1, -1 };
+                        int value = 0;
+                        bool present = false;
+                        line = parseInt(line, chunk.end, value, present);
+                        current[0] = resolveIndex(value, position, totalPositions);
+                        chunk.badIndex |= current[0] < 0;
+                        if (line < chunk.end && *line == '/') {
+                            line = parseInt(line + 1, chunk.end, value, present);
+                            if (present) current[1] = resolveIndex(value, texcoord, totalTexcoords);
+                            chunk.badIndex |= present && current[1] < 0;
+                            if (line < chunk.end && *line == '/') {
+                                line = parseInt(line + 1, chunk.end, value, present);
+                                if (present) current[2] = resolveIndex(value, normal, totalNormals);
+                                chunk.badIndex |= present && current[2] < 0;
+                            }
+                        }
+                        while (line < chunk.end && !isBlank(*line) && *line != '\n' && *line != '\r') line++;
+                        current[0] = max(current[0], 0);
+
+                        if (k == 0) {
+                            copy(current, current + 3, first);
+                        }
+                        else if (k >= 2) {
+                            copy(first, first + 3, corner);
+                            copy(previous, previous + 3, corner + 3);
+                            copy(current, current + 3, corner + 6);
+                            corner += 9;
+                        }
+                        copy(current, current + 3, previous);
+                    }
+                }
+            }
+        }
+    });
+
+    bool firstChunk = true;
+    bool anyTexcoords = false;
+    float uvMin = 0.0f, uvMax = 0.0f;
+    for (const ObjChunk& chunk : chunks) {
+        if (chunk.badIndex) {
+            cout << "OBJ references a missing vertex" << endl;
+            release();
+            return false;
+        }
+        if (chunk.positions > 0) {
+            for (int axis = 0; axis < 3; axis++) {
+                lower[axis] = firstChunk ? chunk.lower[axis] : min(lower[axis], chunk.lower[axis]);
+                upper[axis] = firstChunk ? chunk.upper[axis] : max(upper[axis], chunk.upper[axis]);
+            }
+            firstChunk = false;
+        }
+        if (chunk.texcoords > 0) {
+            uvMin = anyTexcoords ? min(uvMin, chunk.uvMin) : chunk.uvMin;
+            uvMax = anyTexcoords ? max(uvMax, chunk.uvMax) : chunk.uvMax;
+            anyTexcoords = true;
+        }
+    }
+    uvInUnitRange = !anyTexcoords || (uvMin >= 0.0f && uvMax <= 1.0f);
+
+    importStats.positions = totalPositions;
+    importStats.texcoords = totalTexcoords;
+    importStats.normals = totalNormals;
+    importStats.triangles = totalTriangles;
+    importStats.parseMs = millisecondsSince(start);
+
+    auto dedupeStart = chrono::steady_clock::now();
+    deduplicate();
+    importStats.vertices = vertexCount();
+    importStats.dedupeMs = millisecondsSince(dedupeStart);
+    return true;
+}
+
+// Хеш-таблица с ключом "номер позиции" без хеширования: у каждой позиции цепочка вершин,
+// различающихся UV и нормалью (обычно одна-две). Грани ссылаются на близкие позиции,
+// поэтому обращения к таблице идут почти подряд, а не вразброс, как при хешировании тройки
+void ObjImporter::deduplicate() {
+    const uint32_t none = UINT32_MAX;
+    size_t cornerCount = corners.size() / 3;
+    vector<uint32_t> firstVertex(importStats.positions, none);
+    vector<uint32_t> nextVertex;  // Следующая вершина с той же позицией
+    nextVertex.reserve(importStats.positions);
+    vertexCorners.clear();
+    vertexCorners.reserve((size_t)importStats.positions * 3);
+    indices.resize(cornerCount);
+
+    for (size_t i = 0; i < cornerCount; i++) {
+        const int32_t* corner = &corners[i * 3];
+        uint32_t vertex = firstVertex[corner[0]];
+        while (vertex != none) {
+            const int32_t* existing = &vertexCorners[(size_t)vertex * 3];
+            if (existing[1] == corner[1] && existing[2] == corner[2]) {
+                break;
+            }
+            vertex = nextVertex[vertex];
+        }
+        if (vertex == none) {
+            vertex = (uint32_t)nextVertex.size();
+            nextVertex.push_back(firstVertex[corner[0]]);
+            firstVertex[corner[0]] = vertex;
+            vertexCorners.insert(vertexCorners.end(), corner, corner + 3);
+        }
+        indices[i] = vertex;
+    }
+    corners.clear();
+    corners.shrink_to_fit();
+}
+
+void ObjImporter::optimize(int vertexStride, MeshOptimizeReport& report) {
+    size_t count = vertexCount();
+    report.triangles = indexCount() / 3;
+    report.before = analyzeVertexCache(indices.data(), indices.size(), count, vertexStride);
+    auto start = chrono::steady_clock::now();
+
+    report.overdrawOrder = optimizeTriangleOrder(indices.data(), indices.size(), vertexPositions().data(), 3, count,
+        vertexStride);
+
+    // Вершины здесь - тройки номеров атрибутов, их и переставляем
+    vector<uint32_t> remap(count);
+    size_t used = optimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), count);
+    remapIndexBuffer(indices.data(), indices.size(), remap.data());
+    vector<int32_t> reordered(used * 3);
+    remapVertexBuffer(reordered.data(), vertexCorners.data(), count, 3 * sizeof(int32_t), remap.data());
+    vertexCorners.swap(reordered);
+
+    report.milliseconds = millisecondsSince(start);
+    report.after = analyzeVertexCache(indices.data(), indices.size(), used, vertexStride);
+    importStats.vertices = vertexCount();
+}
+
+vector<float> ObjImporter::vertexPositions() const {
+    size_t count = vertexCount();
+    vector<float> result(count * 3);
+    for (size_t v = 0; v < count; v++) {
+        memcpy(&result[v * 3], &positions[(size_t)vertexCorners[v * 3] * 3], 3 * sizeof(float));
+    }
+    return result;
+}
+
+void ObjImporter::buildLods(bool optimizeLevels) {
+    auto start = chrono::steady_clock::now();
+    lodChain = buildLodChain(indices, vertexPositions().data(), 3, vertexCount(), optimizeLevels);
+    importStats.lodMs = millisecondsSince(start);
+}
+
+bool ObjImporter::save(const char* path) const {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        cout << "Failed to create " << path << endl;
+        return false;
+    }
+    // Новые номера атрибутов - в порядке первого обращения вершин
+    vector<int32_t> renumber[3] = {
+        vector<int32_t>(positions.size() / 3, -1),
+        vector<int32_t>(texcoords.size() / 2, -1),
+        vector<int32_t>(normals.size() / 3, -1)
+    };
+    const vector<float>* sources[3] = { &positions, &texcoords, &normals };
+    const int components[3] = { 3, 2, 3 };
+    const char* prefixes[3] = { "v", "vt", "vn" };
+
+    string buffer;
+    char line[160];
+    auto flush = [&](bool force) {
+        if (force || buffer.size() > (1 << 20)) {
+            fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+    };
+    for (int attribute = 0; attribute < 3; attribute++) {
+        int32_t next = 0;
+        for (size_t v = 0; v < (size_t)vertexCount(); v++) {
+            int32_t source = vertexCorners[v * 3 + attribute];
+            if (source < 0 || renumber[attribute][source] >= 0) {
+                continue;
+            }
+            renumber[attribute][source] = next++;
+            const float* value = &(*sources[attribute])[(size_t)source * components[attribute]];
+            int length = components[attribute] == 3
+                ? snprintf(line, sizeof(line), "%s %.9g %.9g %.9g\n", prefixes[attribute], value[0], value[1], value[2])
+                : snprintf(line, sizeof(line), "%s %.9g %.9g\n", prefixes[attribute], value[0], value[1]);
+            buffer.append(line, length);
+            flush(false);
+        }
+    }
+    size_t faceIndices = lodChain.levels.empty() ? indices.size() : (size_t)lodChain.levels[0].indexCount;
+    for (size_t i = 0; i + 2 < faceIndices; i += 3) {
+        buffer += 'f';
+        for (int k = 0; k < 3; k++) {
+            const int32_t* corner = &vertexCorners[(size_t)indices[i + k] * 3];
+            int length = snprintf(line, sizeof(line), " %d", renumber[0][corner[0]] + 1);
+            if (corner[1] >= 0) {
+                length += snprintf(line + length, sizeof(line) - length, "/%d", renumber[1][corner[1]] + 1);
+            }
+            if (corner[2] >= 0) {
+                length += snprintf(line + length, sizeof(line) - length, corner[1] >= 0 ? "/%d" : "//%d",
+                    renumber[2][corner[2]] + 1);
+            }
+            buffer.append(line, length);
+        }
+        buffer += '\n';
+        flush(false);
+    }
+    flush(true);
+    bool written = fclose(file) == 0;
+    if (!written) {
+        cout << "Failed to write " << path << endl;
+    }
+    return written;
+}
+
+VertexFormat ObjImporter::outputFormat(bool quantize) const {
+    return quantize && uvInUnitRange ? VERTEX_PACKED_COLOR_UV : VERTEX_FLOAT_COLOR_UV;
+}
+
+GLenum ObjImporter::indexType() const {
+    return vertexCount() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+Mat4 ObjImporter::write(VertexFormat format, void* vertexData, void* indexData, ThreadPool& pool) const {
+    float center[3], extent[3], inverseExtent[3];
+    float largest = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        center[axis] = 0.5f * (lower[axis] + upper[axis]);
+        extent[axis] = max(0.5f * (upper[axis] - lower[axis]), 1e-20f);
+        inverseExtent[axis] = 1.0f / extent[axis];
+        largest = max(largest, upper[axis] - lower[axis]);
+    }
+    bool packed = format == VERTEX_PACKED_COLOR_UV;
+    int stride = vertexStride(format);
+
+    pool.parallelFor(vertexCount(), 16384, [&](int begin, int end) {
+        for (int v = begin; v < end; v++) {
+            const int32_t* corner = &vertexCorners[(size_t)v * 3];
+            const float* position = &positions[(size_t)corner[0] * 3];
+            float uv[2] = { 0.0f, 0.0f };
+            if (corner[1] >= 0) {
+                uv[0] = texcoords[(size_t)corner[1] * 2];
+                uv[1] = texcoords[(size_t)corner[1] * 2 + 1];
+            }
+            float color[3] = { 1.0f, 1.0f, 1.0f };
+            if (corner[2] >= 0) {
+                for (int axis = 0; axis < 3; axis++) {
+                    color[axis] = 0.5f + 0.5f * normals[(size_t)corner[2] * 3 + axis];
+                }
+            }
+
+            unsigned char* out = (unsigned char*)vertexData + (size_t)v * stride;
+            if (packed) {
+                int16_t quantized[4] = { 0, 0, 0, 0 };
+                for (int axis = 0; axis < 3; axis++) {
+                    quantized[axis] = toSnorm16((position[axis] - center[axis]) * inverseExtent[axis]);
+                }
+                uint8_t rgba[4] = { toUnorm8(color[0]), toUnorm8(color[1]), toUnorm8(color[2]), 255 };
+                uint16_t texcoord[2] = { toUnorm16(uv[0]), toUnorm16(uv[1]) };
+                memcpy(out + PackedColorUVLayout::offsetOf<PosSnorm16>(), quantized, sizeof(quantized));
+                memcpy(out + PackedColorUVLayout::offsetOf<ColorRGBA8>(), rgba, sizeof(rgba));
+                memcpy(out + PackedColorUVLayout::offsetOf<UVUnorm16>(), texcoord, sizeof(texcoord));
+            }
+            else {
+                float vertex[8] = { position[0], position[1], position[2], color[0], color[1], color[2], uv[0], uv[1] };
+                memcpy(out, vertex, sizeof(vertex));
+            }
+        }
+    });
+
+    bool shortIndices = indexType() == GL_UNSIGNED_SHORT;
+    pool.parallelFor(indexCount(), 65536, [&](int begin, int end) {
+        if (shortIndices) {
+            uint16_t* out = (uint16_t*)indexData;
+            for (int i = begin; i < end; i++) out[i] = (uint16_t)indices[i];
+        }
+        else {
+            memcpy((uint32_t*)indexData + begin, &indices[begin], (size_t)(end - begin) * sizeof(uint32_t));
+        }
+    });
+
+    // Вписывание в куб со стороной 1 по наибольшему габариту, центр - в начало координат
+    float fit = largest > 0.0f ? 1.0f / largest : 1.0f;
+    Mat4 fitToCube = Mat4::scale(fit, fit, fit) * Mat4::translation(-center[0], -center[1], -center[2]);
+    return packed ? fitToCube * Mat4::translation(center[0], center[1], center[2])
+        * Mat4::scale(extent[0], extent[1], extent[2]) : fitToCube;
+}
+
+MeshRange ObjImporter::upload(GeometryArena& arena, bool quantize, ThreadPool& pool) {
+    auto start = chrono::steady_clock::now();
+    VertexFormat format = outputFormat(quantize);
+    MeshRange mesh = arena.allocate(format, vertexCount(), indexCount(), indexType());
+    MeshMapping mapping = arena.map(mesh);
+    if (!mapping.vertices || !mapping.indices) {
+        cout << "Failed to map geometry buffers for the imported mesh" << endl;
+        arena.unmap(mesh);
+        return MeshRange();
+    }
+    mesh.dequantize = write(format, mapping.vertices, mapping.indices, pool);
+    arena.unmap(mesh);
+
+    importStats.format = format;
+    importStats.floatBytes = (size_t)vertexCount() * vertexStride(VERTEX_FLOAT_COLOR_UV)
+        + (size_t)indexCount() * sizeof(uint32_t);
+    importStats.uploadedBytes = (size_t)vertexCount() * vertexStride(format)
+        + (size_t)indexCount() * (indexType() == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+    importStats.uploadMs = millisecondsSince(start);
+    return mesh;
+}
+
+void ObjImporter::release() {
+    positions = vector<float>();
+    texcoords = vector<float>();
+    normals = vector<float>();
+    corners = vector<int32_t>();
+    vertexCorners = vector<int32_t>();
+    indices = vector<uint32_t>();
+    lodChain = MeshLodChain();
+}
+
+void ObjImporter::printStats(const char* name) const {
+    const ObjImportStats& s = importStats;
+    // Пропускная способность - только чтение файла и загрузка: упрощение для уровней
+    // детализации (если включено) на порядок дольше и печатается отдельно
+    double totalMs = s.parseMs + s.dedupeMs + s.uploadMs;
+    cout << "Imported " << name << ": " << s.fileBytes / (1024.0 * 1024.0) << " MB, " << s.triangles << " triangles, "
+        << s.vertices << " vertices (" << s.positions << " positions, " << s.texcoords << " uv, "
+        << s.normals << " normals)" << endl;
+    cout << "  parse " << s.parseMs << " ms (" << s.chunks << " chunks), dedupe " << s.dedupeMs << " ms, upload "
+        << s.uploadMs << " ms: " << s.fileBytes / (1024.0 * 1024.0) / (totalMs / 1000.0) << " MB/s, "
+        << s.triangles / (totalMs / 1000.0) / 1e6 << " M triangles/s" << endl;
+    if (s.lodMs > 0.0) {
+        cout << "  LODs built in " << s.lodMs << " ms" << endl;
+    }
+    if (s.uploadedBytes > 0) {
+        cout << "  geometry: " << s.floatBytes / 1024 << " KB as float + 32-bit indices -> " << s.uploadedBytes / 1024
+            << " KB " << vertexFormatName(s.format) << " (" << 100.0 * s.uploadedBytes / s.floatBytes << "%)" << endl;
+    }
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include "geometry_arena.h"
+#include "math3d.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "thread_pool.h"
+#include "vertex_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ==================== Импорт OBJ ====================
+// Файл отображается в память и режется на куски по границам строк. Первый параллельный проход
+// считает в каждом куске позиции, UV, нормали и треугольники; префиксные суммы дают куску
+// его место в общих массивах, и второй параллельный проход разбирает числа прямо туда
+// (отрицательные индексы OBJ разрешаются по счетчикам своего куска). Углы треугольников
+// с одинаковыми (позиция, UV, нормаль) склеиваются в одну вершину: у каждой позиции своя
+// цепочка уже созданных вершин, и угол сравнивается только с ней.
+// Вершины и индексы пишутся сразу в формате арены в отображенные GL-буферы - без PackedMesh.
+// За индексами меша лежат индексы его упрощенных уровней детализации (mesh_simplifier.h).
+// Многоугольники разбиваются веером; материалы, группы, линии и точки пропускаются.
+// Цвет вершины - нормаль, сдвинутая в [0, 1] (без нормалей - белый): у текстурных программ
+// сцен 2 и 3 он подкрашивает текстуру и показывает форму.
+
+struct ObjImportStats {
+    size_t fileBytes = 0;
+    int chunks = 0;
+    int positions = 0, texcoords = 0, normals = 0;
+    int triangles = 0, vertices = 0;
+    double parseMs = 0.0, dedupeMs = 0.0, lodMs = 0.0, uploadMs = 0.0;
+    size_t floatBytes = 0;     // Те же вершины во float (позиция, цвет, UV) и 32-битные индексы
+    size_t uploadedBytes = 0;  // Записано в буферы арены
+    VertexFormat format = VERTEX_FLOAT_COLOR_UV;
+};
+
+class ObjImporter {
+public:
+    // Разбор и склейка вершин; GL не нужен, можно звать из рабочего потока
+    bool load(const char* path, ThreadPool& pool);
+    bool parse(const char* text, size_t size, ThreadPool& pool);
+
+    // Формат записи: SNORM16/UNORM16, если разрешено и UV лежат в [0, 1], иначе float
+    VertexFormat outputFormat(bool quantize) const;
+    GLenum indexType() const;
+    int vertexCount() const { return (int)vertexCorners.size() / 3; }
+    int indexCount() const { return (int)indices.size(); }  // Вместе с уровнями детализации
+
+    // Переупорядочивает треугольники и вершины (mesh_optimizer.h) для вершин размером vertexStride
+    void optimize(int vertexStride, MeshOptimizeReport& report);
+
+    // Пишет меш обратно в OBJ: позиции, UV и нормали в порядке вершин, грани в текущем порядке.
+    // После optimize() повторный импорт дает тот же порядок без оптимизации
+    bool save(const char* path) const;
+
+    // Цепочка уровней детализации; после optimize(). optimizeLevels - как у buildLodChain
+    void buildLods(bool optimizeLevels);
+    const MeshLodChain& lods() const { return lodChain; }
+
+    // Пишет вершины в формате format и индексы типа indexType() в память (обычную или
+    // отображенный буфер) и возвращает матрицу, вписывающую меш в куб [-0.5, 0.5]^3
+    Mat4 write(VertexFormat format, void* vertexData, void* indexData, ThreadPool& pool) const;
+
+    // Поток контекста: место в арене, write() в отображенные буферы
+    MeshRange upload(GeometryArena& arena, bool quantize, ThreadPool& pool);
+
+    // Освобождает разобранные массивы (после upload они не нужны)
+    void release();
+
+    const ObjImportStats& stats() const { return importStats; }
+    void printStats(const char* name) const;
+
+private:
+    void deduplicate();
+    std::vector<float> vertexPositions() const;
+
+    std::vector<float> positions;  // 3 на позицию
+    std::vector<float> texcoords;  // 2 на UV
+    std::vector<float> normals;    // 3 на нормаль
+    std::vector<int32_t> corners;  // (позиция, UV, нормаль) на угол треугольника, -1 - нет
+    std::vector<int32_t> vertexCorners;  // То же для каждой итоговой вершины
+    std::vector<uint32_t> indices;
+    MeshLodChain lodChain;  // Пустая - уровней нет, все индексы - сам меш
+    float lower[3] = { 0.0f, 0.0f, 0.0f }, upper[3] = { 0.0f, 0.0f, 0.0f };
+    bool uvInUnitRange = true;
+    ObjImportStats importStats;
+};
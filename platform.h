@@ -0,0 +1,58 @@
+﻿#pragma once
+
+// ==================== Платформенный слой ====================
+// Подключение заголовков OpenGL и функции создания контекста.
+// На Windows используется окно Win32 + WGL + GLEW (см. lab12.cpp),
+// на Linux - внеэкранный контекст EGL (llvmpipe) с рендерингом в FBO.
+
+#ifdef _WIN32
+#include <windows.h>
+#include <GL/glew.h>
+#include <GL/wglew.h>
+#include <GL/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include <cstring>
+
+// Проверка расширения в core-профиле, где glGetString(GL_EXTENSIONS) недоступен
+inline bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Версия контекста не ниже major.minor
+inline bool hasGLVersion(int major, int minor) {
+    GLint contextMajor = 0, contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+// Адрес функции расширения, которой нет среди экспортов библиотеки OpenGL (eglGetProcAddress)
+void* getGLProcAddress(const char* name);
+
+// Создает внеэкранный контекст OpenGL 3.3 core и FBO размером width x height.
+// FBO остается привязанным, поэтому render() рисует в него без изменений.
+bool createHeadlessContext(int width, int height);
+void destroyHeadlessContext();
+
+// Пересоздает вложения FBO под новый размер
+bool resizeHeadlessFramebuffer(int width, int height);
+
+// Завершение кадра: дожидается выполнения всех команд GL,
+// чтобы время кадра включало реальную работу растеризатора
+void finishHeadlessFrame();
+
+// Сохраняет содержимое FBO в файл PPM (для проверки картинки)
+bool saveFramebufferPPM(const char* filename);
@@ -0,0 +1,169 @@
+﻿#include "platform.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <iostream>
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+
+// ==================== Внеэкранный контекст EGL ====================
+static EGLDisplay g_eglDisplay = EGL_NO_DISPLAY;
+static EGLContext g_eglContext = EGL_NO_CONTEXT;
+
+static GLuint g_fbo = 0;
+static GLuint g_colorRBO = 0;
+static GLuint g_depthRBO = 0;
+static int g_fboWidth = 0;
+static int g_fboHeight = 0;
+
+static EGLDisplay openDisplay() {
+    // Предпочитаем surfaceless-платформу Mesa: ей не нужны ни X-сервер, ни DRM-устройство
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY) {
+            return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+void* getGLProcAddress(const char* name) {
+    return (void*)eglGetProcAddress(name);
+}
+
+bool resizeHeadlessFramebuffer(int width, int height) {
+    if (g_fbo == 0) {
+        glGenFramebuffers(1, &g_fbo);
+        glGenRenderbuffers(1, &g_colorRBO);
+        glGenRenderbuffers(1, &g_depthRBO);
+    }
+
+    glBindRenderbuffer(GL_RENDERBUFFER, g_colorRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    // Глубина 24 бита + трафарет 8 бит, как в PIXELFORMATDESCRIPTOR оконной версии
+    glBindRenderbuffer(GL_RENDERBUFFER, g_depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, g_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, g_colorRBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, g_depthRBO);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        cout << "Framebuffer is incomplete: 0x" << hex << status << dec << endl;
+        return false;
+    }
+
+    g_fboWidth = width;
+    g_fboHeight = height;
+    return true;
+}
+
+bool createHeadlessContext(int width, int height) {
+    g_eglDisplay = openDisplay();
+    if (g_eglDisplay == EGL_NO_DISPLAY) {
+        cout << "Failed to get EGL display" << endl;
+        return false;
+    }
+
+    EGLint major, minor;
+    if (!eglInitialize(g_eglDisplay, &major, &minor)) {
+        cout << "Failed to initialize EGL: 0x" << hex << eglGetError() << dec << endl;
+        return false;
+    }
+    cout << "EGL version: " << major << "." << minor << endl;
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+
+    // Конфигурация нужна не всем драйверам: при EGL_KHR_no_config_context можно обойтись без нее
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(g_eglDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        config = nullptr;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        cout << "Failed to bind OpenGL API" << endl;
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    g_eglContext = eglCreateContext(g_eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+    if (g_eglContext == EGL_NO_CONTEXT) {
+        cout << "Failed to create OpenGL context: 0x" << hex << eglGetError() << dec << endl;
+        return false;
+    }
+
+    // Поверхность не создаем: весь вывод идет в FBO
+    if (!eglMakeCurrent(g_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, g_eglContext)) {
+        cout << "Failed to make OpenGL context current: 0x" << hex << eglGetError() << dec << endl;
+        return false;
+    }
+
+    return resizeHeadlessFramebuffer(width, height);
+}
+
+void destroyHeadlessContext() {
+    if (g_fbo != 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &g_fbo);
+        glDeleteRenderbuffers(1, &g_colorRBO);
+        glDeleteRenderbuffers(1, &g_depthRBO);
+        g_fbo = g_colorRBO = g_depthRBO = 0;
+    }
+
+    if (g_eglDisplay != EGL_NO_DISPLAY) {
+        eglMakeCurrent(g_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (g_eglContext != EGL_NO_CONTEXT) {
+            eglDestroyContext(g_eglDisplay, g_eglContext);
+        }
+        eglTerminate(g_eglDisplay);
+    }
+    g_eglContext = EGL_NO_CONTEXT;
+    g_eglDisplay = EGL_NO_DISPLAY;
+}
+
+void finishHeadlessFrame() {
+    glFinish();
+}
+
+bool saveFramebufferPPM(const char* filename) {
+    vector<unsigned char> pixels(g_fboWidth * g_fboHeight * 3);
+    glBindFramebuffer(GL_FRAMEBUFFER, g_fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, g_fboWidth, g_fboHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        cout << "Failed to open " << filename << endl;
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", g_fboWidth, g_fboHeight);
+    // OpenGL хранит строки снизу вверх, PPM - сверху вниз
+    for (int y = g_fboHeight - 1; y >= 0; y--) {
+        fwrite(&pixels[y * g_fboWidth * 3], 1, g_fboWidth * 3, file);
+    }
+    fclose(file);
+    return true;
+}
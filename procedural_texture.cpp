@@ -0,0 +1,218 @@
+﻿#include "procedural_texture.h"
+#include "math3d.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// ==================== 4 значения float ====================
+#ifdef MATH3D_SSE
+struct Float4 {
+    __m128 v;
+};
+static inline Float4 splat(float x) { return { _mm_set1_ps(x) }; }
+static inline Float4 ramp(float x) { return { _mm_setr_ps(x, x + 1.0f, x + 2.0f, x + 3.0f) }; }
+static inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+static inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+static inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+static inline Float4 sqrt4(Float4 a) { return { _mm_sqrt_ps(a.v) }; }
+
+// Округление до ближайшего целого (|x| < 2^31)
+static inline Float4 round4(Float4 a) { return { _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)) }; }
+
+static inline Float4 floor4(Float4 a) {
+    Float4 r = round4(a);
+    __m128 greater = _mm_cmpgt_ps(r.v, a.v);
+    return { _mm_sub_ps(r.v, _mm_and_ps(greater, _mm_set1_ps(1.0f))) };
+}
+
+// sin(x): приведение к [-pi/2, pi/2] по периоду pi (на нечетных периодах знак меняется),
+// затем нечетный многочлен 9-й степени. Погрешность около 4e-6 - меньше шага 8-битного канала.
+static inline Float4 fastSin(Float4 x) {
+    __m128i k = _mm_cvtps_epi32(_mm_mul_ps(x.v, _mm_set1_ps(1.0f / MATH3D_PI)));
+    __m128 kf = _mm_cvtepi32_ps(k);
+    // pi = hi + lo: так x - k * pi почти не теряет точности при больших x
+    __m128 r = _mm_sub_ps(x.v, _mm_mul_ps(kf, _mm_set1_ps(3.140625f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(9.67653589793e-4f)));
+    __m128 sign = _mm_castsi128_ps(_mm_slli_epi32(k, 31));
+
+    __m128 r2 = _mm_mul_ps(r, r);
+    __m128 p = _mm_set1_ps(2.7557319e-6f);
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-1.9841270e-4f));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(8.3333333e-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-1.6666667e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(1.0f));
+    return { _mm_xor_ps(_mm_mul_ps(p, r), sign) };
+}
+
+// Отбрасывает дробную часть, как приведение (unsigned char) в прежнем коде, и сохраняет 4 тексела RGB
+static inline void storeRGB(unsigned char* out, Float4 r, Float4 g, Float4 b, int count) {
+    // Упаковка с насыщением до 0..255 и сборка 0x00BBGGRR в каждой 32-битной ячейке
+    __m128i rg = _mm_packs_epi32(_mm_cvttps_epi32(r.v), _mm_cvttps_epi32(g.v));
+    __m128i b0 = _mm_packs_epi32(_mm_cvttps_epi32(b.v), _mm_setzero_si128());
+    __m128i rgBytes = _mm_packus_epi16(rg, b0);              // r0..r3 g0..g3 b0..b3 0..0
+    __m128i rgPairs = _mm_unpacklo_epi8(rgBytes, _mm_srli_si128(rgBytes, 4));  // r0 g0 r1 g1 ...
+    __m128i bZero = _mm_unpacklo_epi8(_mm_srli_si128(rgBytes, 8), _mm_setzero_si128());
+    alignas(16) uint32_t texels[4];
+    _mm_store_si128((__m128i*)texels, _mm_unpacklo_epi16(rgPairs, bZero));
+
+    if (count == 4) {
+        // 4 тексела по 3 байта = 12 байт двумя записями
+        uint64_t low = texels[0] | ((uint64_t)texels[1] << 24) | ((uint64_t)texels[2] << 48);
+        uint32_t high = (texels[2] >> 16) | (texels[3] << 8);
+        memcpy(out, &low, sizeof(low));
+        memcpy(out + 8, &high, sizeof(high));
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        memcpy(out + i * 3, &texels[i], 3);
+    }
+}
+#else
+struct Float4 {
+    float v[4];
+};
+static inline Float4 splat(float x) { return { { x, x, x, x } }; }
+static inline Float4 ramp(float x) { return { { x, x + 1.0f, x + 2.0f, x + 3.0f } }; }
+static inline Float4 operator+(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+static inline Float4 operator-(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+static inline Float4 operator*(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+static inline Float4 sqrt4(Float4 a) { for (int i = 0; i < 4; i++) a.v[i] = sqrt(a.v[i]); return a; }
+static inline Float4 floor4(Float4 a) { for (int i = 0; i < 4; i++) a.v[i] = floor(a.v[i]); return a; }
+
+static inline Float4 fastSin(Float4 x) {
+    for (int i = 0; i < 4; i++) {
+        float k = nearbyint(x.v[i] * (1.0f / MATH3D_PI));
+        float r = x.v[i] - k * 3.140625f - k * 9.67653589793e-4f;
+        float r2 = r * r;
+        float p = (((2.7557319e-6f * r2 - 1.9841270e-4f) * r2 + 8.3333333e-3f) * r2 - 1.6666667e-1f) * r2 + 1.0f;
+        x.v[i] = ((long long)k & 1) ? -p * r : p * r;
+    }
+    return x;
+}
+
+static inline void storeRGB(unsigned char* out, Float4 r, Float4 g, Float4 b, int count) {
+    for (int i = 0; i < count; i++) {
+        out[i * 3] = (unsigned char)min(max((int)r.v[i], 0), 255);
+        out[i * 3 + 1] = (unsigned char)min(max((int)g.v[i], 0), 255);
+        out[i * 3 + 2] = (unsigned char)min(max((int)b.v[i], 0), 255);
+    }
+}
+#endif
+
+// ==================== Узоры ====================
+// x, y - координаты в эталонной текстуре 256x256 (x - столбец, y - строка)
+
+static inline void shadeWater(Float4 x, Float4 y, Float4& r, Float4& g, Float4& b) {
+    Float4 wave = fastSin(y * splat(0.05f) + x * splat(0.02f)) * splat(0.2f) + splat(0.5f);
+    r = splat(100.0f) + wave * splat(50.0f);
+    g = splat(200.0f) + wave * splat(50.0f);
+    b = splat(150.0f) + wave * splat(100.0f);
+}
+
+static inline void shadeWood(Float4 x, Float4 y, Float4& r, Float4& g, Float4& b) {
+    Float4 grain = fastSin(y * splat(0.1f)) * splat(0.3f) + splat(0.7f);
+    Float4 dx = x - splat(128.0f);
+    Float4 dy = y - splat(128.0f);
+    Float4 rings = fastSin(sqrt4(dx * dx + dy * dy) * splat(0.05f)) * splat(0.2f) + splat(0.5f);
+    Float4 pattern = (grain + rings) * splat(0.5f);
+    r = pattern * splat(139.0f);
+    g = pattern * splat(69.0f);
+    b = pattern * splat(19.0f);
+}
+
+static inline void shadeMarble(Float4 x, Float4 y, Float4& r, Float4& g, Float4& b) {
+    // Прожилки - синус, фаза которого искривлена двумя низкочастотными синусами
+    Float4 phase = x * splat(0.04f) + fastSin(y * splat(0.03f)) * splat(4.0f)
+        + fastSin((x + y) * splat(0.011f)) * splat(2.0f);
+    Float4 vein = fastSin(phase) * splat(0.5f) + splat(0.5f);
+    vein = vein * vein;  // Светлый фон и узкие темные прожилки
+    r = splat(235.0f) - vein * splat(145.0f);
+    g = splat(235.0f) - vein * splat(145.0f);
+    b = splat(240.0f) - vein * splat(140.0f);
+}
+
+static inline void shadeChecker(Float4 x, Float4 y, Float4& r, Float4& g, Float4& b) {
+    const float cell = PROCEDURAL_REFERENCE_SIZE / 8.0f;
+    Float4 sum = floor4(x * splat(1.0f / cell)) + floor4(y * splat(1.0f / cell));
+    Float4 parity = sum - floor4(sum * splat(0.5f)) * splat(2.0f);  // 0 или 1
+    r = splat(60.0f) + parity * splat(140.0f);
+    g = r;
+    b = r;
+}
+
+static inline void shadePlasma(Float4 x, Float4 y, Float4& r, Float4& g, Float4& b) {
+    Float4 dx = x - splat(128.0f);
+    Float4 dy = y - splat(128.0f);
+    Float4 v = fastSin(x * splat(0.06f)) + fastSin(y * splat(0.05f)) + fastSin((x + y) * splat(0.04f))
+        + fastSin(sqrt4(dx * dx + dy * dy) * splat(0.08f));
+    Float4 phase = v * splat(MATH3D_PI * 0.5f);  // v в [-4, 4] - два оборота палитры
+    r = splat(127.5f) + fastSin(phase) * splat(127.0f);
+    g = splat(127.5f) + fastSin(phase + splat(2.0944f)) * splat(127.0f);
+    b = splat(127.5f) + fastSin(phase + splat(4.1888f)) * splat(127.0f);
+}
+
+// Одна строка текстуры блоками по 4 тексела
+template <void (*Shade)(Float4, Float4, Float4&, Float4&, Float4&)>
+static void shadeRow(unsigned char* out, int width, float y, float scaleX) {
+    Float4 fy = splat(y);
+    Float4 scale = splat(scaleX);
+    for (int j = 0; j < width; j += 4) {
+        Float4 r, g, b;
+        Shade(ramp((float)j) * scale, fy, r, g, b);
+        storeRGB(out + j * 3, r, g, b, min(4, width - j));
+    }
+}
+
+typedef void (*RowShader)(unsigned char* out, int width, float y, float scaleX);
+
+static RowShader rowShader(ProceduralPattern pattern) {
+    switch (pattern) {
+    case PATTERN_WATER: return shadeRow<shadeWater>;
+    case PATTERN_WOOD: return shadeRow<shadeWood>;
+    case PATTERN_MARBLE: return shadeRow<shadeMarble>;
+    case PATTERN_CHECKER: return shadeRow<shadeChecker>;
+    case PATTERN_PLASMA: return shadeRow<shadePlasma>;
+    default: return nullptr;
+    }
+}
+
+const char* proceduralPatternName(ProceduralPattern pattern) {
+    static const char* names[PATTERN_COUNT] = { "water", "wood", "marble", "checker", "plasma" };
+    return pattern >= 0 && pattern < PATTERN_COUNT ? names[pattern] : "unknown";
+}
+
+// ==================== Генерация ====================
+bool generateProceduralTexture(ProceduralPattern pattern, int width, int height, TextureImage& image,
+    ThreadPool& pool) {
+    RowShader shade = rowShader(pattern);
+    if (!shade || width < 1 || height < 1
+        || width > MAX_PROCEDURAL_TEXTURE_SIZE || height > MAX_PROCEDURAL_TEXTURE_SIZE) {
+        return false;
+    }
+
+    image.width = width;
+    image.height = height;
+    image.channels = 3;
+    image.pixels.resize((size_t)width * height * 3);
+
+    float scaleX = (float)PROCEDURAL_REFERENCE_SIZE / width;
+    float scaleY = (float)PROCEDURAL_REFERENCE_SIZE / height;
+    unsigned char* pixels = image.pixels.data();
+
+    // Примерно 64K текселей на задачу: достаточно крупно, чтобы не платить за планирование
+    int rowsPerTask = max(1, 65536 / width);
+    pool.parallelFor(height, rowsPerTask, [=](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            shade(pixels + (size_t)i * width * 3, width, i * scaleY, scaleX);
+        }
+    });
+    return true;
+}
+
+bool generateProceduralTexture(ProceduralPattern pattern, int width, int height, TextureImage& image) {
+    return generateProceduralTexture(pattern, width, height, image, sharedThreadPool());
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include "texture_image.h"
+
+class ThreadPool;
+
+// ==================== Процедурные текстуры ====================
+// Узоры задаются в координатах эталонной текстуры 256x256: при большем размере
+// картинка та же, только с большей детализацией. Строки делятся между потоками пула,
+// внутри строки по 4 текселя считаются SIMD с полиномиальным синусом.
+
+enum ProceduralPattern {
+    PATTERN_WATER,    // Синие волны (прежняя createWaterTexture)
+    PATTERN_WOOD,     // Волокна и годичные кольца (прежняя createWoodTexture)
+    PATTERN_MARBLE,   // Светлый мрамор с изогнутыми прожилками
+    PATTERN_CHECKER,  // Шахматная доска 8x8
+    PATTERN_PLASMA,   // Сумма синусов с радужной палитрой
+    PATTERN_COUNT
+};
+
+const int PROCEDURAL_REFERENCE_SIZE = 256;
+// Увеличивается при изменении узоров: по нему устаревают сжатые копии в кэше текстур
+const int PROCEDURAL_TEXTURE_VERSION = 1;
+const int MAX_PROCEDURAL_TEXTURE_SIZE = 8192;
+
+const char* proceduralPatternName(ProceduralPattern pattern);
+
+// RGB, 3 байта на тексель. Возвращает false, если размер вне 1..MAX_PROCEDURAL_TEXTURE_SIZE
+bool generateProceduralTexture(ProceduralPattern pattern, int width, int height, TextureImage& image,
+    ThreadPool& pool);
+bool generateProceduralTexture(ProceduralPattern pattern, int width, int height, TextureImage& image);
@@ -0,0 +1,192 @@
+﻿#include "program_cache.h"
+#include "shader_program.h"
+#include "texture_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// Заголовок файла с бинарником программы
+struct ProgramBinaryHeader {
+    uint32_t tag;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;  // binaryFormat из glGetProgramBinary
+    uint32_t length;
+};
+
+static const uint32_t PROGRAM_CACHE_TAG = 0x5032314C;  // "L12P"
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+ProgramCache& sharedProgramCache() {
+    static ProgramCache cache;
+    return cache;
+}
+
+// Сборка программ в потоках драйвера; false - расширения нет
+static bool enableParallelCompile() {
+    if (!hasGLExtension("GL_KHR_parallel_shader_compile")) {
+        return false;
+    }
+#ifdef _WIN32
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+#else
+    // libOpenGL не экспортирует функции расширений - адрес берется у EGL
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads =
+        (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)getGLProcAddress("glMaxShaderCompilerThreadsKHR");
+    if (!maxShaderCompilerThreads) {
+        return false;
+    }
+    maxShaderCompilerThreads(0xFFFFFFFF);  // Решает драйвер
+#endif
+    return true;
+}
+
+void ProgramCache::open(const char* cacheDirectory) {
+    directory = cacheDirectory ? cacheDirectory : "";
+    parallel = enableParallelCompile();
+
+    GLint formats = 0;
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    binaries = formats > 0;
+
+    // Бинарник годится только для того же драйвера: его строки входят в ключ
+    driverHash = hashBytes("", 0);
+    const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+    for (GLenum name : strings) {
+        const char* value = (const char*)glGetString(name);
+        if (value) {
+            driverHash = hashBytes(value, strlen(value) + 1, driverHash);
+        }
+    }
+}
+
+GLuint ProgramCache::acquire(const char* vertexSrc, const char* fragmentSrc) {
+    auto start = chrono::steady_clock::now();
+    counters.requests++;
+
+    string sources = string(vertexSrc) + '\0' + fragmentSrc;
+    auto found = programs.find(sources);
+    if (found != programs.end()) {
+        counters.ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return found->second;
+    }
+
+    GLuint program = 0;
+    bool useFiles = binaries && !directory.empty();
+    uint64_t key = hashBytes(sources.data(), sources.size(), driverHash);
+    char name[32];
+    snprintf(name, sizeof(name), "program-%016llx.bin", (unsigned long long)key);
+    string path = directory + "/" + name;
+
+    if (useFiles && loadBinary(path, key, program)) {
+        counters.loaded++;
+    }
+    else {
+        program = linkProgram(vertexSrc, fragmentSrc, useFiles);
+        counters.compiled++;
+        if (useFiles) {
+            pendingSaves.push_back({ program, path, key });
+        }
+    }
+
+    programs.emplace(move(sources), program);
+    counters.unique++;
+    counters.ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return program;
+}
+
+bool ProgramCache::isReady(GLuint program) const {
+    if (!parallel) {
+        return true;
+    }
+    GLint done = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+void ProgramCache::flush() {
+    auto start = chrono::steady_clock::now();
+    for (const PendingSave& save : pendingSaves) {
+        saveBinary(save.path, save.key, save.program);
+    }
+    pendingSaves.clear();
+    counters.ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+bool ProgramCache::loadBinary(const string& path, uint64_t key, GLuint& program) {
+    ifstream file(path, ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    ProgramBinaryHeader header = {};
+    file.read((char*)&header, sizeof(header));
+    if (!file || header.tag != PROGRAM_CACHE_TAG || header.version != PROGRAM_CACHE_VERSION || header.key != key) {
+        return false;
+    }
+    vector<char> binary(header.length);
+    file.read(binary.data(), binary.size());
+    if (!file) {
+        return false;
+    }
+
+    // Драйвер вправе отвергнуть бинарник - тогда программа просто собирается заново
+    while (glGetError() != GL_NO_ERROR) {}
+    program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (glGetError() != GL_NO_ERROR || !success) {
+        cout << "Program binary rejected by the driver, recompiling: " << path << endl;
+        glDeleteProgram(program);
+        program = 0;
+        file.close();
+        error_code error;
+        filesystem::remove(path, error);
+        counters.rejected++;
+        return false;
+    }
+    return true;
+}
+
+bool ProgramCache::saveBinary(const string& path, uint64_t key, GLuint program) {
+    GLint success = 0, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0) {
+        return false;
+    }
+
+    vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramBinaryHeader header = { PROGRAM_CACHE_TAG, PROGRAM_CACHE_VERSION, key, format, (uint32_t)length };
+
+    error_code error;
+    filesystem::create_directories(filesystem::path(path).parent_path(), error);
+
+    // Как и в кэше текстур: сначала временный файл, затем переименование
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary, ios::binary);
+        if (!file) {
+            return false;
+        }
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            return false;
+        }
+    }
+    filesystem::rename(temporary, path, error);
+    return !error;
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "platform.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ==================== Кэш шейдерных программ ====================
+// Программы с одинаковыми исходниками создаются один раз и разделяются между ShaderProgram.
+// Если драйвер умеет отдавать бинарники (ARB_get_program_binary), скомпонованная программа
+// сохраняется в файл, имя которого - хеш исходников и строк драйвера; при следующем запуске
+// она загружается через glProgramBinary без компиляции. Бинарник, отвергнутый драйвером
+// (обновление драйвера, другой GPU), удаляется, и программа собирается из исходников.
+// С KHR_parallel_shader_compile сборка идет в потоках драйвера: acquire() не ждет ее,
+// а бинарники новых программ сохраняются в flush(), когда программы уже готовы.
+
+struct ProgramCacheStats {
+    int requests = 0;  // Вызовы acquire()
+    int unique = 0;    // Созданные программы
+    int loaded = 0;    // Из них загружены из бинарника
+    int compiled = 0;  // Собраны из исходников
+    int rejected = 0;  // Бинарник был, но драйвер его не принял
+    double ms = 0.0;   // Время в acquire()
+};
+
+class ProgramCache {
+public:
+    // directory == nullptr - только дедупликация в памяти, без файлов. Нужен текущий контекст GL
+    void open(const char* directory);
+
+    // Программа для пары исходников: из памяти, из бинарника или новая
+    GLuint acquire(const char* vertexSrc, const char* fragmentSrc);
+
+    // Собрана ли программа (без ожидания; без параллельной компиляции - всегда true)
+    bool isReady(GLuint program) const;
+
+    // Сохраняет бинарники программ, собранных из исходников после прошлого вызова
+    void flush();
+
+    bool supportsBinaries() const { return binaries; }
+    bool compilesInParallel() const { return parallel; }
+    const ProgramCacheStats& stats() const { return counters; }
+
+private:
+    bool loadBinary(const std::string& path, uint64_t key, GLuint& program);
+    bool saveBinary(const std::string& path, uint64_t key, GLuint program);
+
+    struct PendingSave {
+        GLuint program;
+        std::string path;
+        uint64_t key;
+    };
+
+    std::string directory;
+    bool binaries = false;
+    bool parallel = false;
+    std::vector<PendingSave> pendingSaves;
+    uint64_t driverHash = 0;
+    std::unordered_map<std::string, GLuint> programs;
+    ProgramCacheStats counters;
+};
+
+// Общий кэш для createProgram()
+ProgramCache& sharedProgramCache();
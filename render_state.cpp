@@ -0,0 +1,147 @@
+﻿#include "render_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// Больше местоположений драйверы не выдают на практике; такие переменные просто не кэшируются
+static const GLint MAX_SHADOWED_LOCATION = 1024;
+
+void RenderState::useProgram(GLuint id) {
+    if (id == program) {
+        stats.programSkips++;
+        return;
+    }
+    glUseProgram(id);
+    program = id;
+    programUniforms = &uniforms[id];
+    stats.programBinds++;
+}
+
+// У каждого блока свои привязки на каждую цель, поэтому и тени раздельные
+void RenderState::bind(GLenum target, GLuint* shadow, int unit, GLuint texture) {
+    if (shadow[unit] == texture) {
+        stats.textureSkips++;
+        return;
+    }
+    if (activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+        stats.unitSwitches++;
+    }
+    glBindTexture(target, texture);
+    shadow[unit] = texture;
+    stats.textureBinds++;
+}
+
+void RenderState::bindTexture(int unit, GLuint texture) {
+    bind(GL_TEXTURE_2D, textures, unit, texture);
+}
+
+void RenderState::bindTextureArray(int unit, GLuint texture) {
+    bind(GL_TEXTURE_2D_ARRAY, textureArrays, unit, texture);
+}
+
+void RenderState::bindVertexArray(GLuint id) {
+    if (id == vao) {
+        stats.vaoSkips++;
+        return;
+    }
+    glBindVertexArray(id);
+    vao = id;
+    stats.vaoBinds++;
+}
+
+bool RenderState::updateShadow(GLint location, const float* values, int count) {
+    if (!programUniforms || location >= MAX_SHADOWED_LOCATION) {
+        stats.uniformUpdates++;
+        return true;
+    }
+    if ((size_t)location >= programUniforms->size()) {
+        programUniforms->resize(location + 1);
+    }
+    UniformShadow& shadow = (*programUniforms)[location];
+    if (shadow.valid && memcmp(shadow.values, values, count * sizeof(float)) == 0) {
+        stats.uniformSkips++;
+        return false;
+    }
+    memcpy(shadow.values, values, count * sizeof(float));
+    shadow.valid = true;
+    stats.uniformUpdates++;
+    return true;
+}
+
+void RenderState::setUniform(GLint location, int value) {
+    float bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (updateShadow(location, &bits, 1)) {
+        glUniform1i(location, value);
+    }
+}
+
+void RenderState::setUniform(GLint location, float value) {
+    if (updateShadow(location, &value, 1)) {
+        glUniform1f(location, value);
+    }
+}
+
+void RenderState::setUniform(GLint location, const Mat4& value) {
+    if (updateShadow(location, value.data(), 16)) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, value.data());
+    }
+}
+
+void RenderState::forgetProgram(GLuint id) {
+    if (program == id) {
+        program = UNKNOWN;
+        programUniforms = nullptr;
+    }
+    uniforms.erase(id);
+}
+
+void RenderState::forgetTexture(GLuint texture) {
+    for (int unit = 0; unit < RENDER_STATE_TEXTURE_UNITS; unit++) {
+        if (textures[unit] == texture) {
+            textures[unit] = UNKNOWN;
+        }
+        if (textureArrays[unit] == texture) {
+            textureArrays[unit] = UNKNOWN;
+        }
+    }
+}
+
+void RenderState::forgetVertexArray(GLuint id) {
+    if (vao == id) {
+        vao = UNKNOWN;
+    }
+}
+
+void RenderState::invalidate() {
+    program = UNKNOWN;
+    programUniforms = nullptr;
+    for (int unit = 0; unit < RENDER_STATE_TEXTURE_UNITS; unit++) {
+        textures[unit] = UNKNOWN;
+        textureArrays[unit] = UNKNOWN;
+    }
+    activeUnit = -1;
+    vao = UNKNOWN;
+    uniforms.clear();
+}
+
+void RenderState::printStats(int frames) const {
+    const RenderStateCounters& s = stats;
+    double perFrame = 1.0 / max(frames, 1);
+    cout << "  GL state per frame: " << s.draws * perFrame << " draws, "
+        << s.programBinds * perFrame << " glUseProgram (" << s.programSkips * perFrame << " skipped), "
+        << s.textureBinds * perFrame << " glBindTexture (" << s.textureSkips * perFrame << " skipped, "
+        << s.unitSwitches * perFrame << " glActiveTexture), "
+        << s.vaoBinds * perFrame << " glBindVertexArray (" << s.vaoSkips * perFrame << " skipped), "
+        << s.uniformUpdates * perFrame << " glUniform (" << s.uniformSkips * perFrame << " skipped)" << endl;
+}
+
+RenderState& renderState() {
+    static RenderState state;
+    return state;
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include "platform.h"
+#include "math3d.h"
+
+#include <unordered_map>
+#include <vector>
+
+// ==================== Кэш состояния OpenGL ====================
+// Тень привязанной программы, 2D-текстур и массивов текстур по блокам, VAO и значений uniform-переменных
+// (по программе и местоположению: значения хранятся в программе и переживают ее смену).
+// Вызов уходит драйверу, только если значение меняется, пропущенные считаются.
+// Весь код, меняющий эти привязки, идет через кэш; удаленный объект нужно забыть (forget*),
+// иначе glGen* может вернуть то же имя для нового объекта, а кэш решит, что он уже привязан.
+
+const int RENDER_STATE_TEXTURE_UNITS = 8;
+
+struct RenderStateCounters {
+    long long programBinds = 0, programSkips = 0;
+    long long textureBinds = 0, textureSkips = 0;
+    long long unitSwitches = 0;  // glActiveTexture
+    long long vaoBinds = 0, vaoSkips = 0;
+    long long uniformUpdates = 0, uniformSkips = 0;
+    long long draws = 0;
+};
+
+class RenderState {
+public:
+    void useProgram(GLuint program);
+    void bindTexture(int unit, GLuint texture);  // GL_TEXTURE_2D
+    void bindTextureArray(int unit, GLuint texture);  // GL_TEXTURE_2D_ARRAY
+    void bindVertexArray(GLuint vao);
+
+    // В текущую программу
+    void setUniform(GLint location, int value);
+    void setUniform(GLint location, float value);
+    void setUniform(GLint location, const Mat4& value);
+
+    void countDraw() { stats.draws++; }
+
+    void forgetProgram(GLuint program);
+    void forgetTexture(GLuint texture);
+    void forgetVertexArray(GLuint vao);
+
+    // Привязки неизвестны (после кода, который обходит кэш) - следующие вызовы уйдут драйверу
+    void invalidate();
+
+    const RenderStateCounters& counters() const { return stats; }
+    void resetCounters() { stats = RenderStateCounters(); }
+    // Вызовы GL и пропуски, в среднем на кадр
+    void printStats(int frames) const;
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+
+    // Значения uniform-переменных одной программы по местоположению
+    struct UniformShadow {
+        bool valid = false;
+        float values[16];
+    };
+
+    // true - значение новое и его нужно отправить
+    bool updateShadow(GLint location, const float* values, int count);
+    void bind(GLenum target, GLuint* shadow, int unit, GLuint texture);
+
+    GLuint program = UNKNOWN;
+    GLuint textures[RENDER_STATE_TEXTURE_UNITS] = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN };
+    GLuint textureArrays[RENDER_STATE_TEXTURE_UNITS] = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN };
+    int activeUnit = -1;
+    GLuint vao = UNKNOWN;
+    std::unordered_map<GLuint, std::vector<UniformShadow>> uniforms;
+    std::vector<UniformShadow>* programUniforms = nullptr;  // Тени текущей программы
+    RenderStateCounters stats;
+};
+
+// Кэш текущего контекста (контекст один, все вызовы - из его потока)
+RenderState& renderState();
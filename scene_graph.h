@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "math3d.h"
+
+#include <cstdint>
+#include <vector>
+
+// ==================== Граф сцены ====================
+// Узлы лежат в плоских массивах (SoA) в топологическом порядке: родитель всегда раньше
+// потомка, поэтому полный пересчет - один проход по массиву. setLocal() только помечает
+// узел и кладет его в список измененных; update() пересчитывает мировые матрицы
+// измененных узлов и их поддеревьев, так что стоимость кадра зависит от числа изменений,
+// а не от размера графа. Дети узла связаны списком (firstChild/nextSibling).
+// Обход поддерева идет вразброс по памяти и выигрывает у полного пересчета, только пока
+// изменено несколько процентов узлов: начиная с 1/32 update() вызывает updateAll().
+
+class SceneGraph {
+public:
+    // parent - уже добавленный узел или -1 (корень). Возвращает номер узла
+    int addNode(int parent, const Mat4& local = Mat4::identity());
+    void reserve(size_t nodeCount);
+    void clear();
+
+    void setLocal(int node, const Mat4& local);
+    const Mat4& local(int node) const { return locals[node]; }
+    // Актуальна после update()
+    const Mat4& world(int node) const { return worlds[node]; }
+    int parent(int node) const { return parents[node]; }
+    int size() const { return (int)parents.size(); }
+    size_t dirtyCount() const { return dirtyNodes.size(); }
+
+    // Пересчитывает измененные узлы и их поддеревья; возвращает число пересчитанных узлов
+    int update();
+    // Пересчет всех узлов с нуля (сравнение и сброс после массовых изменений)
+    void updateAll();
+
+private:
+    int updateSubtree(int root);
+
+    std::vector<int> parents;
+    std::vector<int> firstChild;
+    std::vector<int> nextSibling;
+    std::vector<Mat4> locals;
+    std::vector<Mat4> worlds;
+    std::vector<uint8_t> dirty;  // Узел в dirtyNodes и еще не пересчитан
+    std::vector<int> dirtyNodes;
+    std::vector<int> stack;      // Обход поддерева без рекурсии
+};
@@ -0,0 +1,176 @@
+﻿#include "shader_program.h"
+#include "program_cache.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+GLuint linkProgram(const char* vertexSrc, const char* fragmentSrc, bool retrievable) {
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSrc);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSrc);
+    GLuint program = glCreateProgram();
+
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+
+    // Шейдеры остаются прикрепленными до удаления программы: по ним checkProgram() найдет журнал ошибок
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    return program;
+}
+
+bool checkProgram(GLuint program) {
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success) {
+        return true;
+    }
+
+    GLuint shaders[2];
+    GLsizei shaderCount = 0;
+    glGetAttachedShaders(program, 2, &shaderCount, shaders);
+    for (GLsizei i = 0; i < shaderCount; i++) {
+        GLint compiled;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            char infoLog[512];
+            glGetShaderInfoLog(shaders[i], 512, nullptr, infoLog);
+            cout << "Shader compilation error:\n" << infoLog << endl;
+        }
+    }
+
+    char infoLog[512];
+    glGetProgramInfoLog(program, 512, nullptr, infoLog);
+    cout << "Program linking error:\n" << infoLog << endl;
+    return false;
+}
+
+GLuint createProgram(const char* vertexSrc, const char* fragmentSrc) {
+    return sharedProgramCache().acquire(vertexSrc, fragmentSrc);
+}
+
+// ==================== ShaderProgram ====================
+bool ShaderProgram::create(const char* vertexSrc, const char* fragmentSrc) {
+    begin(vertexSrc, fragmentSrc);
+    return finish();
+}
+
+void ShaderProgram::begin(const char* vertexSrc, const char* fragmentSrc) {
+    program = createProgram(vertexSrc, fragmentSrc);
+}
+
+bool ShaderProgram::isReady() const {
+    return sharedProgramCache().isReady(program);
+}
+
+bool ShaderProgram::finish() {
+    if (!checkProgram(program)) {
+        return false;
+    }
+    reflect();
+    return true;
+}
+
+void ShaderProgram::reflect() {
+    uniforms.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    vector<char> name(maxLength + 1);
+    for (GLint i = 0; i < count; i++) {
+        UniformInfo info;
+        GLsizei length = 0;
+        glGetActiveUniform(program, i, (GLsizei)name.size(), &length, &info.size, &info.type, name.data());
+        info.name.assign(name.data(), length);
+        // У переменных из uniform-блоков нет местоположения, они живут в буфере
+        info.location = glGetUniformLocation(program, info.name.c_str());
+        if (info.location >= 0) {
+            uniforms.push_back(info);
+        }
+    }
+}
+
+GLint ShaderProgram::findLocation(const char* name, GLenum expectedType) const {
+    for (const UniformInfo& info : uniforms) {
+        if (info.name != name) {
+            continue;
+        }
+        if (info.type != expectedType) {
+            cout << "Uniform " << name << " has type 0x" << hex << info.type
+                << ", expected 0x" << expectedType << dec << endl;
+            return -1;
+        }
+        return info.location;
+    }
+    // Неиспользуемые переменные компилятор выбрасывает - это не ошибка
+    return -1;
+}
+
+UniformFloat ShaderProgram::floatUniform(const char* name) const {
+    UniformFloat uniform;
+    uniform.location = findLocation(name, GL_FLOAT);
+    return uniform;
+}
+
+UniformInt ShaderProgram::intUniform(const char* name) const {
+    UniformInt uniform;
+    uniform.location = findLocation(name, GL_INT);
+    return uniform;
+}
+
+UniformMat4 ShaderProgram::mat4Uniform(const char* name) const {
+    UniformMat4 uniform;
+    uniform.location = findLocation(name, GL_FLOAT_MAT4);
+    return uniform;
+}
+
+void ShaderProgram::setSampler(const char* name, int unit, GLenum type) const {
+    GLint location = findLocation(name, type);
+    if (location >= 0) {
+        renderState().useProgram(program);
+        renderState().setUniform(location, unit);
+    }
+}
+
+void ShaderProgram::bindUniformBlock(const char* blockName, GLuint bindingPoint) const {
+    GLuint blockIndex = glGetUniformBlockIndex(program, blockName);
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, blockIndex, bindingPoint);
+    }
+}
+
+// ==================== UniformBuffer ====================
+void UniformBuffer::create(GLsizeiptr size, GLuint bindingPoint) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+    shadow.clear();
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size) {
+    if ((GLsizeiptr)shadow.size() == size && memcmp(shadow.data(), data, size) == 0) {
+        return;
+    }
+    shadow.assign((const unsigned char*)data, (const unsigned char*)data + size);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
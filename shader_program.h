@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include "platform.h"
+#include "math3d.h"
+#include "render_state.h"
+
+#include <string>
+#include <vector>
+
+// ==================== Шейдерные программы ====================
+// Компиляция и компоновка только отправляются драйверу: статус не запрашивается, чтобы
+// при KHR_parallel_shader_compile программа собиралась в фоне. Ошибки печатает checkProgram()
+GLuint compileShader(GLenum type, const char* source);
+
+// retrievable - драйвер должен сохранить бинарник для glGetProgramBinary
+GLuint linkProgram(const char* vertexSrc, const char* fragmentSrc, bool retrievable = false);
+
+// Дожидается компоновки; при ошибке печатает журналы шейдеров и программы
+bool checkProgram(GLuint program);
+
+// Программа из общего кэша (см. program_cache.h): одинаковые пары исходников дают одну программу
+GLuint createProgram(const char* vertexSrc, const char* fragmentSrc);
+
+// Типизированные дескрипторы uniform-переменных. Местоположение ищется один раз
+// после компоновки; запись в отсутствующую переменную (location = -1) игнорируется.
+// Значения идут через renderState(): то же значение повторно не отправляется.
+struct UniformFloat {
+    GLint location = -1;
+    void set(float value) const { if (location >= 0) renderState().setUniform(location, value); }
+};
+
+struct UniformInt {
+    GLint location = -1;
+    void set(int value) const { if (location >= 0) renderState().setUniform(location, value); }
+};
+
+struct UniformMat4 {
+    GLint location = -1;
+    void set(const Mat4& value) const { if (location >= 0) renderState().setUniform(location, value); }
+};
+
+// Программа с таблицей активных uniform-переменных, прочитанной сразу после компоновки
+class ShaderProgram {
+public:
+    bool create(const char* vertexSrc, const char* fragmentSrc);
+
+    // То же в два шага: begin() запускает сборку, finish() ждет ее и читает uniform-переменные.
+    // Между ними поток свободен для другой работы, isReady() - готова ли программа без ожидания
+    void begin(const char* vertexSrc, const char* fragmentSrc);
+    bool isReady() const;
+    bool finish();
+
+    GLuint id() const { return program; }
+    void use() const { renderState().useProgram(program); }
+
+    UniformFloat floatUniform(const char* name) const;
+    UniformInt intUniform(const char* name) const;
+    UniformMat4 mat4Uniform(const char* name) const;
+
+    // Значение сэмплера не меняется между кадрами, поэтому задается один раз;
+    // type - GL_SAMPLER_2D или GL_SAMPLER_2D_ARRAY
+    void setSampler(const char* name, int unit, GLenum type = GL_SAMPLER_2D) const;
+
+    // Привязка uniform-блока к общей точке (GLSL 3.30 не поддерживает layout(binding))
+    void bindUniformBlock(const char* blockName, GLuint bindingPoint) const;
+
+private:
+    struct UniformInfo {
+        std::string name;
+        GLenum type;
+        GLint size;
+        GLint location;
+    };
+
+    void reflect();
+    GLint findLocation(const char* name, GLenum expectedType) const;
+
+    GLuint program = 0;
+    std::vector<UniformInfo> uniforms;
+};
+
+// ==================== Буфер uniform-переменных ====================
+// Матрицы камеры, общие для всех программ (блок Camera в шейдерах, раскладка std140)
+const GLuint CAMERA_BLOCK_BINDING = 0;
+
+struct CameraBlock {
+    Mat4 view;
+    Mat4 projection;
+};
+
+class UniformBuffer {
+public:
+    void create(GLsizeiptr size, GLuint bindingPoint);
+
+    // Загружает данные, только если они изменились с прошлого вызова
+    void update(const void* data, GLsizeiptr size);
+
+    GLuint id() const { return buffer; }
+
+private:
+    GLuint buffer = 0;
+    std::vector<unsigned char> shadow;
+};
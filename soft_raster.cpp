@@ -0,0 +1,430 @@
+﻿#include "soft_raster.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_RASTER_SSE 1
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+static const int TILE_SIZE = 64;
+static const int MAX_VARYINGS = 5;  // ourColor (3) + TexCoord (2)
+
+// ==================== Четыре float за раз ====================
+// Тонкая обертка над SSE со скалярной заменой для остальных платформ
+#ifdef SOFT_RASTER_SSE
+struct Float4 {
+    __m128 v;
+};
+static inline Float4 splat(float x) { return { _mm_set1_ps(x) }; }
+static inline Float4 ramp(float x) { return { _mm_setr_ps(x, x + 1.0f, x + 2.0f, x + 3.0f) }; }
+static inline Float4 load4(const float* p) { return { _mm_loadu_ps(p) }; }
+static inline void store4(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+static inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+static inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+static inline Float4 operator/(Float4 a, Float4 b) { return { _mm_div_ps(a.v, b.v) }; }
+static inline int maskGreaterEqual(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+static inline int maskGreater(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+static inline int maskLess(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+#else
+struct Float4 {
+    float v[4];
+};
+static inline Float4 splat(float x) { return { { x, x, x, x } }; }
+static inline Float4 ramp(float x) { return { { x, x + 1.0f, x + 2.0f, x + 3.0f } }; }
+static inline Float4 load4(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+static inline void store4(float* p, Float4 a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+static inline Float4 operator+(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+static inline Float4 operator*(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+static inline Float4 operator/(Float4 a, Float4 b) { for (int i = 0; i < 4; i++) a.v[i] /= b.v[i]; return a; }
+static inline int maskGreaterEqual(Float4 a, Float4 b) {
+    int mask = 0;
+    for (int i = 0; i < 4; i++) if (a.v[i] >= b.v[i]) mask |= 1 << i;
+    return mask;
+}
+static inline int maskGreater(Float4 a, Float4 b) {
+    int mask = 0;
+    for (int i = 0; i < 4; i++) if (a.v[i] > b.v[i]) mask |= 1 << i;
+    return mask;
+}
+static inline int maskLess(Float4 a, Float4 b) {
+    int mask = 0;
+    for (int i = 0; i < 4; i++) if (a.v[i] < b.v[i]) mask |= 1 << i;
+    return mask;
+}
+#endif
+
+// ==================== Геометрия ====================
+struct ClipVertex {
+    float x, y, z, w;
+    float varyings[MAX_VARYINGS];
+};
+
+struct SetupTriangle {
+    // Функции ребер E(x, y) = a * (x - x0) + b * (y - y0); ребро i противолежит вершине i,
+    // поэтому E_i / area - барицентрический вес вершины i. (x0, y0) - конец ребра, первый по (x, y):
+    // соседний треугольник считает общее ребро от той же точки и получает ровно -E,
+    // так что пиксель на ребре достается ровно одному из них (без щелей вдоль диагоналей)
+    float edgeA[3], edgeB[3], edgeX[3], edgeY[3];
+    bool topLeft[3];
+    float z[3];
+    float invW[3];
+    float varyingsOverW[3][MAX_VARYINGS];
+    float invArea;
+    int minX, minY, maxX, maxY;  // Включительно
+    int drawIndex;
+};
+
+// Отсечение многоугольника плоскостью w + sign * z >= 0 (sign = 1 - ближняя, -1 - дальняя)
+static int clipPolygon(const ClipVertex* in, int count, ClipVertex* out, float sign) {
+    int outCount = 0;
+    for (int i = 0; i < count; i++) {
+        const ClipVertex& current = in[i];
+        const ClipVertex& next = in[(i + 1) % count];
+        float currentDistance = current.w + sign * current.z;
+        float nextDistance = next.w + sign * next.z;
+
+        if (currentDistance >= 0.0f) {
+            out[outCount++] = current;
+        }
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+            float t = currentDistance / (currentDistance - nextDistance);
+            ClipVertex& v = out[outCount++];
+            v.x = current.x + (next.x - current.x) * t;
+            v.y = current.y + (next.y - current.y) * t;
+            v.z = current.z + (next.z - current.z) * t;
+            v.w = current.w + (next.w - current.w) * t;
+            for (int k = 0; k < MAX_VARYINGS; k++) {
+                v.varyings[k] = current.varyings[k] + (next.varyings[k] - current.varyings[k]) * t;
+            }
+        }
+    }
+    return outCount;
+}
+
+// Перевод в оконные координаты и расчет функций ребер
+static bool setupTriangle(const ClipVertex* v0, const ClipVertex* v1, const ClipVertex* v2,
+    int width, int height, int drawIndex, SetupTriangle& tri) {
+    const ClipVertex* verts[3] = { v0, v1, v2 };
+    float sx[3], sy[3];
+    for (int i = 0; i < 3; i++) {
+        float invW = 1.0f / verts[i]->w;
+        sx[i] = (verts[i]->x * invW * 0.5f + 0.5f) * width;
+        sy[i] = (verts[i]->y * invW * 0.5f + 0.5f) * height;
+        tri.z[i] = verts[i]->z * invW * 0.5f + 0.5f;
+        tri.invW[i] = invW;
+        for (int k = 0; k < MAX_VARYINGS; k++) {
+            tri.varyingsOverW[i][k] = verts[i]->varyings[k] * invW;
+        }
+    }
+
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+    if (area == 0.0f || !isfinite(area)) {
+        return false;
+    }
+    // Отсечение граней в сценах выключено, поэтому разворачиваем обход по часовой стрелке
+    if (area < 0.0f) {
+        swap(sx[1], sx[2]);
+        swap(sy[1], sy[2]);
+        swap(tri.z[1], tri.z[2]);
+        swap(tri.invW[1], tri.invW[2]);
+        for (int k = 0; k < MAX_VARYINGS; k++) {
+            swap(tri.varyingsOverW[1][k], tri.varyingsOverW[2][k]);
+        }
+        area = -area;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        tri.edgeA[i] = sy[a] - sy[b];
+        tri.edgeB[i] = sx[b] - sx[a];
+        int origin = sx[a] < sx[b] || (sx[a] == sx[b] && sy[a] < sy[b]) ? a : b;
+        tri.edgeX[i] = sx[origin];
+        tri.edgeY[i] = sy[origin];
+        // Правило верхнего левого ребра: пиксель на общем ребре закрашивается ровно один раз
+        tri.topLeft[i] = tri.edgeA[i] > 0.0f || (tri.edgeA[i] == 0.0f && tri.edgeB[i] < 0.0f);
+    }
+    tri.invArea = 1.0f / area;
+
+    tri.minX = max(0, (int)floor(min({ sx[0], sx[1], sx[2] })));
+    tri.minY = max(0, (int)floor(min({ sy[0], sy[1], sy[2] })));
+    tri.maxX = min(width - 1, (int)ceil(max({ sx[0], sx[1], sx[2] })));
+    tri.maxY = min(height - 1, (int)ceil(max({ sy[0], sy[1], sy[2] })));
+    tri.drawIndex = drawIndex;
+    return tri.minX <= tri.maxX && tri.minY <= tri.maxY;
+}
+
+static void transformAndSetup(const SoftDrawCall& draw, int drawIndex, int width, int height,
+    vector<SetupTriangle>& triangles) {
+    Mat4 mvp = draw.projection * draw.view * draw.model;
+
+    vector<ClipVertex> clipVertices(draw.vertexCount);
+    for (int i = 0; i < draw.vertexCount; i++) {
+        const float* src = draw.vertices + i * draw.floatsPerVertex;
+        Vec4 clip = mvp * Vec4(src[0], src[1], src[2], 1.0f);
+        ClipVertex& v = clipVertices[i];
+        v.x = clip.x;
+        v.y = clip.y;
+        v.z = clip.z;
+        v.w = clip.w;
+        for (int k = 0; k < MAX_VARYINGS; k++) {
+            v.varyings[k] = 3 + k < draw.floatsPerVertex ? src[3 + k] : 0.0f;
+        }
+    }
+
+    for (int i = 0; i + 2 < draw.indexCount; i += 3) {
+        ClipVertex polygon[8], clipped[8];
+        polygon[0] = clipVertices[draw.indices[i]];
+        polygon[1] = clipVertices[draw.indices[i + 1]];
+        polygon[2] = clipVertices[draw.indices[i + 2]];
+
+        int count = clipPolygon(polygon, 3, clipped, 1.0f);
+        count = clipPolygon(clipped, count, polygon, -1.0f);
+
+        for (int k = 1; k + 1 < count; k++) {
+            SetupTriangle tri;
+            if (setupTriangle(&polygon[0], &polygon[k], &polygon[k + 1], width, height, drawIndex, tri)) {
+                triangles.push_back(tri);
+            }
+        }
+    }
+}
+
+// ==================== Фрагментные шейдеры ====================
+static void fetchTexel(const TextureImage& tex, int x, int y, float out[4]) {
+    const unsigned char* p = &tex.pixels[(y * tex.width + x) * tex.channels];
+    const float scale = 1.0f / 255.0f;
+    out[0] = p[0] * scale;
+    out[1] = tex.channels >= 3 ? p[1] * scale : 0.0f;
+    out[2] = tex.channels >= 3 ? p[2] * scale : 0.0f;
+    out[3] = tex.channels == 4 ? p[3] * scale : 1.0f;
+}
+
+// Билинейная выборка с GL_REPEAT, как у GL_LINEAR
+static void sampleTexture(const TextureImage& tex, float u, float v, float out[4]) {
+    float x = u * tex.width - 0.5f;
+    float y = v * tex.height - 0.5f;
+    float fx = floor(x), fy = floor(y);
+    float tx = x - fx, ty = y - fy;
+
+    int x0 = ((int)fx % tex.width + tex.width) % tex.width;
+    int y0 = ((int)fy % tex.height + tex.height) % tex.height;
+    int x1 = (x0 + 1) % tex.width;
+    int y1 = (y0 + 1) % tex.height;
+
+    float c00[4], c10[4], c01[4], c11[4];
+    fetchTexel(tex, x0, y0, c00);
+    fetchTexel(tex, x1, y0, c10);
+    fetchTexel(tex, x0, y1, c01);
+    fetchTexel(tex, x1, y1, c11);
+    for (int i = 0; i < 4; i++) {
+        float bottom = c00[i] + (c10[i] - c00[i]) * tx;
+        float top = c01[i] + (c11[i] - c01[i]) * tx;
+        out[i] = bottom + (top - bottom) * ty;
+    }
+}
+
+static inline float mixf(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+static uint32_t packColor(const float c[4]) {
+    uint32_t result = 0;
+    for (int i = 0; i < 4; i++) {
+        float clamped = min(max(c[i], 0.0f), 1.0f);
+        result |= (uint32_t)(clamped * 255.0f + 0.5f) << (i * 8);
+    }
+    return result;
+}
+
+static uint32_t shadeFragment(const SoftDrawCall& draw, const float* varyings) {
+    const float* color = varyings;
+    float u = varyings[3], v = varyings[4];
+    float out[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    switch (draw.shader) {
+    case SOFT_SHADER_VERTEX_COLOR:
+        out[0] = color[0]; out[1] = color[1]; out[2] = color[2]; out[3] = 1.0f;
+        break;
+    case SOFT_SHADER_TINTED_TEXTURE: {
+        float tex[4];
+        sampleTexture(*draw.texture1, u, v, tex);
+        for (int i = 0; i < 3; i++) {
+            out[i] = mixf(tex[i], tex[i] * color[i], draw.colorInfluence);
+        }
+        out[3] = tex[3];
+        break;
+    }
+    case SOFT_SHADER_TWO_TEXTURES: {
+        float tex1[4], tex2[4];
+        sampleTexture(*draw.texture1, u, v, tex1);
+        sampleTexture(*draw.texture2, u, v, tex2);
+        for (int i = 0; i < 4; i++) {
+            out[i] = mixf(tex1[i], tex2[i], draw.mixRatio);
+        }
+        break;
+    }
+    }
+    return packColor(out);
+}
+
+// ==================== Растеризация тайла ====================
+static void rasterizeTriangle(const SetupTriangle& tri, const SoftDrawCall& draw,
+    int tileX0, int tileY0, int tileX1, int tileY1, SoftFramebuffer& fb) {
+    int startX = max(tri.minX, tileX0) & ~3;  // Начало группы из 4 пикселей
+    int endX = min(tri.maxX, tileX1 - 1);
+    int startY = max(tri.minY, tileY0);
+    int endY = min(tri.maxY, tileY1 - 1);
+
+    Float4 edgeA[3], edgeOffsetX[3];
+    for (int e = 0; e < 3; e++) {
+        edgeA[e] = splat(tri.edgeA[e]);
+        edgeOffsetX[e] = splat(-tri.edgeX[e]);
+    }
+    Float4 four = splat(4.0f);
+    Float4 zero = splat(0.0f);
+    Float4 invArea = splat(tri.invArea);
+
+    alignas(16) float varyings[MAX_VARYINGS][4];
+    alignas(16) float depthValues[4];
+
+    for (int y = startY; y <= endY; y++) {
+        float py = y + 0.5f;
+        Float4 px = ramp(startX + 0.5f);
+        Float4 rowTerm[3];
+        for (int e = 0; e < 3; e++) {
+            rowTerm[e] = splat(tri.edgeB[e] * (py - tri.edgeY[e]));
+        }
+
+        float* depthRow = &fb.depth[y * fb.width];
+        uint32_t* colorRow = &fb.color[y * fb.width];
+
+        for (int x = startX; x <= endX; x += 4, px = px + four) {
+            // Без накопления шага: значение в пикселе не зависит от того, где начался обход
+            Float4 edge[3];
+            for (int e = 0; e < 3; e++) {
+                edge[e] = edgeA[e] * (px + edgeOffsetX[e]) + rowTerm[e];
+            }
+            int mask = 0xF;
+            for (int e = 0; e < 3; e++) {
+                mask &= tri.topLeft[e] ? maskGreaterEqual(edge[e], zero) : maskGreater(edge[e], zero);
+            }
+            // Пиксели за правым краем тайла принадлежат соседнему тайлу
+            int lanesInside = tileX1 - x;
+            if (lanesInside < 4) {
+                mask &= (1 << lanesInside) - 1;
+            }
+
+            if (mask) {
+                Float4 b0 = edge[0] * invArea;
+                Float4 b1 = edge[1] * invArea;
+                Float4 b2 = edge[2] * invArea;
+                Float4 z = b0 * splat(tri.z[0]) + b1 * splat(tri.z[1]) + b2 * splat(tri.z[2]);
+                mask &= maskLess(z, load4(depthRow + x));
+
+                if (mask) {
+                    // Перспективно-корректная интерполяция: attr = sum(b * attr / w) / sum(b / w)
+                    Float4 oneOverW = b0 * splat(tri.invW[0]) + b1 * splat(tri.invW[1]) + b2 * splat(tri.invW[2]);
+                    Float4 w = splat(1.0f) / oneOverW;
+                    for (int k = 0; k < MAX_VARYINGS; k++) {
+                        Float4 value = b0 * splat(tri.varyingsOverW[0][k])
+                            + b1 * splat(tri.varyingsOverW[1][k])
+                            + b2 * splat(tri.varyingsOverW[2][k]);
+                        store4(varyings[k], value * w);
+                    }
+                    store4(depthValues, z);
+
+                    for (int lane = 0; lane < 4; lane++) {
+                        if (!(mask & (1 << lane))) {
+                            continue;
+                        }
+                        float fragment[MAX_VARYINGS];
+                        for (int k = 0; k < MAX_VARYINGS; k++) {
+                            fragment[k] = varyings[k][lane];
+                        }
+                        depthRow[x + lane] = depthValues[lane];
+                        colorRow[x + lane] = shadeFragment(draw, fragment);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void SoftFramebuffer::resize(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+    // Запас в 4 элемента: группа из 4 пикселей в конце последней строки читает глубину за ее краем
+    color.assign((size_t)width * height + 4, 0);
+    depth.assign((size_t)width * height + 4, 1.0f);
+}
+
+void softRender(SoftFramebuffer& fb, const float clearColor[4],
+    const SoftDrawCall* draws, int drawCount, ThreadPool& pool) {
+    vector<SetupTriangle> triangles;
+    for (int i = 0; i < drawCount; i++) {
+        transformAndSetup(draws[i], i, fb.width, fb.height, triangles);
+    }
+
+    // Раскладка треугольников по тайлам с сохранением порядка отправки
+    int tilesX = (fb.width + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesY = (fb.height + TILE_SIZE - 1) / TILE_SIZE;
+    vector<vector<int>> bins(tilesX * tilesY);
+    for (int i = 0; i < (int)triangles.size(); i++) {
+        const SetupTriangle& tri = triangles[i];
+        for (int ty = tri.minY / TILE_SIZE; ty <= tri.maxY / TILE_SIZE; ty++) {
+            for (int tx = tri.minX / TILE_SIZE; tx <= tri.maxX / TILE_SIZE; tx++) {
+                bins[ty * tilesX + tx].push_back(i);
+            }
+        }
+    }
+
+    uint32_t clearPacked = packColor(clearColor);
+
+    pool.parallelFor(tilesX * tilesY, 1, [&](int begin, int end) {
+        for (int tile = begin; tile < end; tile++) {
+            int tileX0 = (tile % tilesX) * TILE_SIZE;
+            int tileY0 = (tile / tilesX) * TILE_SIZE;
+            int tileX1 = min(tileX0 + TILE_SIZE, fb.width);
+            int tileY1 = min(tileY0 + TILE_SIZE, fb.height);
+
+            // Очистка тоже по тайлам, чтобы на 4K она распределялась между потоками
+            for (int y = tileY0; y < tileY1; y++) {
+                fill(&fb.color[y * fb.width + tileX0], &fb.color[y * fb.width + tileX1], clearPacked);
+                fill(&fb.depth[y * fb.width + tileX0], &fb.depth[y * fb.width + tileX1], 1.0f);
+            }
+
+            for (int index : bins[tile]) {
+                const SetupTriangle& tri = triangles[index];
+                rasterizeTriangle(tri, draws[tri.drawIndex], tileX0, tileY0, tileX1, tileY1, fb);
+            }
+        }
+    });
+}
+
+bool saveSoftFramebufferPPM(const SoftFramebuffer& fb, const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", fb.width, fb.height);
+    vector<unsigned char> row(fb.width * 3);
+    for (int y = fb.height - 1; y >= 0; y--) {
+        for (int x = 0; x < fb.width; x++) {
+            uint32_t c = fb.color[y * fb.width + x];
+            row[x * 3] = c & 0xFF;
+            row[x * 3 + 1] = (c >> 8) & 0xFF;
+            row[x * 3 + 2] = (c >> 16) & 0xFF;
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    fclose(file);
+    return true;
+}
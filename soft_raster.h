@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "math3d.h"
+#include "texture_image.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// ==================== Программный растеризатор ====================
+// Повторяет конвейер OpenGL из render(): вершинный шейдер projection * view * model,
+// отсечение по ближней/дальней плоскости, тест глубины GL_LESS и фрагментные шейдеры сцен.
+// Кадр делится на тайлы, тайлы обрабатываются пулом потоков,
+// функции ребер и интерполяция считаются по 4 пикселя за раз (SSE).
+
+// Фрагментные шейдеры, которые умеет растеризатор
+enum SoftShader {
+    SOFT_SHADER_VERTEX_COLOR,   // fragmentShaderSimple
+    SOFT_SHADER_TINTED_TEXTURE, // fragmentShaderSource
+    SOFT_SHADER_TWO_TEXTURES    // fragmentTwoTextures
+};
+
+// Аналог одного glDrawElements(GL_TRIANGLES, ...) с заполненными uniform-переменными.
+// Формат вершин как в VBO сцен: позиция (3), цвет (3), текстурные координаты (2, если есть).
+struct SoftDrawCall {
+    const float* vertices = nullptr;
+    int floatsPerVertex = 6;
+    int vertexCount = 0;
+    const unsigned int* indices = nullptr;
+    int indexCount = 0;
+
+    Mat4 model = Mat4::identity();
+    Mat4 view = Mat4::identity();
+    Mat4 projection = Mat4::identity();
+
+    SoftShader shader = SOFT_SHADER_VERTEX_COLOR;
+    const TextureImage* texture1 = nullptr;
+    const TextureImage* texture2 = nullptr;
+    float colorInfluence = 0.0f;
+    float mixRatio = 0.0f;
+};
+
+// Цвет в формате RGBA8, строки снизу вверх, как в FBO OpenGL
+struct SoftFramebuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+
+    void resize(int newWidth, int newHeight);
+};
+
+// Очищает кадр цветом clearColor и глубиной 1.0, затем рисует вызовы по порядку
+void softRender(SoftFramebuffer& framebuffer, const float clearColor[4],
+    const SoftDrawCall* draws, int drawCount, ThreadPool& pool);
+
+bool saveSoftFramebufferPPM(const SoftFramebuffer& framebuffer, const char* filename);
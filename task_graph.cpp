@@ -0,0 +1,196 @@
+﻿#include "task_graph.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+int TaskGraph::add(const char* name, TaskThread thread, function<void()> body, vector<int> dependencies) {
+    Task task;
+    task.name = name;
+    task.thread = thread;
+    task.wait = false;
+    task.body = move(body);
+    task.dependencies = move(dependencies);
+    tasks.push_back(move(task));
+    return (int)tasks.size() - 1;
+}
+
+int TaskGraph::addWait(const char* name, function<bool()> poll, vector<int> dependencies) {
+    int index = add(name, TASK_CONTEXT, nullptr, move(dependencies));
+    tasks[index].wait = true;
+    tasks[index].poll = move(poll);
+    return index;
+}
+
+double TaskGraph::elapsedMs() const {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Вызывается под lock
+void TaskGraph::submitWorker(int index) {
+    Task& task = tasks[index];
+    task.started = true;
+    task.startMs = elapsedMs();
+    workers->submit([this, index] {
+        tasks[index].body();
+        lock_guard<mutex> guard(lock);
+        complete(index, elapsedMs());
+        workerDone.notify_all();
+    });
+}
+
+// Вызывается под lock. Ставшие готовыми CPU-задачи уходят в пул сразу, в том потоке,
+// который завершил зависимость: иначе их запускал бы только цикл потока контекста,
+// а он может быть занят долгой задачей GL
+void TaskGraph::complete(int index, double endMs) {
+    tasks[index].done = true;
+    tasks[index].endMs = endMs;
+    for (int dependent : dependents[index]) {
+        Task& task = tasks[dependent];
+        if (--task.waitingFor == 0 && workers && task.thread == TASK_WORKER && !task.wait && !task.started) {
+            submitWorker(dependent);
+        }
+    }
+}
+
+void TaskGraph::run(ThreadPool& pool) {
+    start = chrono::steady_clock::now();
+    contextIdleMs = 0.0;
+
+    dependents.assign(tasks.size(), {});
+    for (size_t i = 0; i < tasks.size(); i++) {
+        tasks[i].waitingFor = (int)tasks[i].dependencies.size();
+        for (int dependency : tasks[i].dependencies) {
+            dependents[dependency].push_back((int)i);
+        }
+    }
+
+    // В пуле без рабочих потоков задачи submit() выполнялись бы только в wait() - тогда все здесь
+    workers = pool.threadCount() > 1 ? &pool : nullptr;
+
+    size_t finished = 0;
+    int lastContextTask = -1;
+    while (finished < tasks.size()) {
+        int contextTask = -1;
+        vector<int> pollTasks;
+        {
+            lock_guard<mutex> guard(lock);
+            finished = 0;
+            for (size_t i = 0; i < tasks.size(); i++) {
+                Task& task = tasks[i];
+                finished += task.done;
+                if (task.done || task.waitingFor > 0) {
+                    continue;
+                }
+                if (task.wait) {
+                    if (!task.started) {
+                        task.started = true;
+                        task.startMs = elapsedMs();
+                    }
+                    pollTasks.push_back((int)i);
+                }
+                else if (!task.started && task.thread == TASK_WORKER && workers) {
+                    // Задачи без зависимостей; остальные запускает complete()
+                    submitWorker((int)i);
+                }
+                else if (!task.started && contextTask < 0) {
+                    contextTask = (int)i;
+                }
+            }
+        }
+        if (finished == tasks.size()) {
+            break;
+        }
+
+        // Опрос ожиданий между задачами контекста: GL-работа идет, пока драйвер компилирует
+        bool progress = false;
+        for (int index : pollTasks) {
+            if (tasks[index].poll()) {
+                lock_guard<mutex> guard(lock);
+                complete(index, elapsedMs());
+                progress = true;
+            }
+        }
+
+        if (contextTask >= 0) {
+            Task& task = tasks[contextTask];
+            task.started = true;
+            task.startMs = elapsedMs();
+            task.previousOnContext = lastContextTask;
+            lastContextTask = contextTask;
+            task.body();
+            lock_guard<mutex> guard(lock);
+            complete(contextTask, elapsedMs());
+        }
+        else if (!progress) {
+            // Делать нечего: ждем рабочие потоки (при опросе - недолго, чтобы проверить условие снова)
+            double idleStart = elapsedMs();
+            unique_lock<mutex> guard(lock);
+            auto timeout = pollTasks.empty() ? chrono::milliseconds(50) : chrono::milliseconds(1);
+            workerDone.wait_for(guard, timeout);
+            contextIdleMs += elapsedMs() - idleStart;
+        }
+    }
+
+    pool.wait();
+    workers = nullptr;
+    totalMs = elapsedMs();
+}
+
+void TaskGraph::printReport(const string& title) const {
+    cout << title << ": " << totalMs << " ms, context thread idle " << contextIdleMs << " ms" << endl;
+    vector<int> order(tasks.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = (int)i;
+    }
+    stable_sort(order.begin(), order.end(), [this](int a, int b) { return tasks[a].startMs < tasks[b].startMs; });
+    for (int index : order) {
+        const Task& task = tasks[index];
+        char line[160];
+        snprintf(line, sizeof(line), "  %-24s %-7s %8.2f .. %8.2f ms  (%.2f ms)", task.name.c_str(),
+            task.wait ? "wait" : task.thread == TASK_WORKER ? "worker" : "context",
+            task.startMs, task.endMs, task.endMs - task.startMs);
+        cout << line << endl;
+    }
+
+    // Критический путь: от задачи, закончившейся последней, назад через то, что ее задержало позже всего -
+    // зависимость или предыдущую задачу в потоке контекста (поток один, задачи GL идут по очереди)
+    if (tasks.empty()) {
+        return;
+    }
+    int current = 0;
+    for (size_t i = 1; i < tasks.size(); i++) {
+        if (tasks[i].endMs > tasks[current].endMs) {
+            current = (int)i;
+        }
+    }
+    vector<int> path;
+    while (current >= 0) {
+        path.push_back(current);
+        vector<int> blockers = tasks[current].dependencies;
+        if (tasks[current].previousOnContext >= 0) {
+            blockers.push_back(tasks[current].previousOnContext);
+        }
+        int latest = -1;
+        for (int blocker : blockers) {
+            if (latest < 0 || tasks[blocker].endMs > tasks[latest].endMs) {
+                latest = blocker;
+            }
+        }
+        current = latest;
+    }
+    reverse(path.begin(), path.end());
+
+    double pathMs = 0.0;
+    cout << "  critical path: ";
+    for (size_t i = 0; i < path.size(); i++) {
+        const Task& task = tasks[path[i]];
+        pathMs += task.endMs - task.startMs;
+        cout << (i > 0 ? " -> " : "") << task.name << " (" << task.endMs - task.startMs << " ms)";
+    }
+    cout << ", " << pathMs << " ms of work" << endl;
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// ==================== Граф задач запуска ====================
+// Этапы инициализации с зависимостями. Задачи TASK_WORKER (только CPU: генерация мешей,
+// расстановка экземпляров) уходят в пул потоков, задачи TASK_CONTEXT выполняются в потоке
+// с контекстом OpenGL, который вызвал run(). Ожидание (addWait) тоже живет в этом потоке:
+// его условие опрашивается, пока выполняются остальные готовые задачи.
+// После run() у каждой задачи известны время начала и конца, по ним строится критический путь.
+
+enum TaskThread {
+    TASK_WORKER,
+    TASK_CONTEXT
+};
+
+class TaskGraph {
+public:
+    int add(const char* name, TaskThread thread, std::function<void()> body, std::vector<int> dependencies = {});
+
+    // Задача в потоке контекста, завершенная, когда poll() вернет true
+    int addWait(const char* name, std::function<bool()> poll, std::vector<int> dependencies = {});
+
+    void run(ThreadPool& pool);
+
+    // Таблица этапов и критический путь под заголовком title
+    void printReport(const std::string& title) const;
+
+private:
+    struct Task {
+        std::string name;
+        TaskThread thread;
+        bool wait;
+        std::function<void()> body;
+        std::function<bool()> poll;
+        std::vector<int> dependencies;
+
+        int waitingFor = 0;  // Незавершенные зависимости
+        int previousOnContext = -1;  // Задача, выполнявшаяся в потоке контекста перед этой
+        bool started = false;
+        bool done = false;
+        double startMs = 0.0, endMs = 0.0;
+    };
+
+    double elapsedMs() const;
+    void submitWorker(int index);
+    void complete(int index, double endMs);
+
+    std::vector<Task> tasks;
+    std::vector<std::vector<int>> dependents;
+    ThreadPool* workers = nullptr;  // Пул во время run(); nullptr - CPU-задачи идут в потоке контекста
+    std::chrono::steady_clock::time_point start;
+    double totalMs = 0.0;
+    double contextIdleMs = 0.0;
+
+    std::mutex lock;
+    std::condition_variable workerDone;
+};
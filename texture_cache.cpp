@@ -0,0 +1,324 @@
+﻿#include "texture_cache.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+
+// Увеличивается при изменении кодировщика или формата, чтобы старые файлы кэша не подхватывались
+static const uint32_t CACHE_VERSION = 2;
+static const uint32_t CACHE_TAG = 0x4332314C;  // "L12C"
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+string textureCachePath(const string& directory, const string& name, uint64_t key) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "-%016llx.dds", (unsigned long long)key);
+    return directory + "/" + name + suffix;
+}
+
+// ==================== Кодировщик BC1 ====================
+// Блок 4x4: два цвета RGB565 и 16 двухбитных индексов. Концы отрезка палитры -
+// проекции цветов блока на главную ось (PCA), затем одна итерация уточнения
+// методом наименьших квадратов по выбранным индексам.
+
+struct BlockColors {
+    float rgb[16][3];
+};
+
+static inline uint16_t packRGB565(const float c[3]) {
+    int r = (int)(min(max(c[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    int g = (int)(min(max(c[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+    int b = (int)(min(max(c[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void unpackRGB565(uint16_t packed, float c[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    c[0] = (float)((r << 3) | (r >> 2));
+    c[1] = (float)((g << 2) | (g >> 4));
+    c[2] = (float)((b << 3) | (b >> 2));
+}
+
+// Выбирает индексы для палитры из двух цветов и двух промежуточных; возвращает суммарную ошибку
+static float assignIndices(const BlockColors& block, uint16_t c0, uint16_t c1, uint32_t& indices) {
+    float palette[4][3];
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    for (int k = 0; k < 3; k++) {
+        palette[2][k] = (2.0f * palette[0][k] + palette[1][k]) / 3.0f;
+        palette[3][k] = (palette[0][k] + 2.0f * palette[1][k]) / 3.0f;
+    }
+
+    float totalError = 0.0f;
+    indices = 0;
+    for (int i = 0; i < 16; i++) {
+        float bestError = 1e30f;
+        int best = 0;
+        for (int p = 0; p < 4; p++) {
+            float dr = block.rgb[i][0] - palette[p][0];
+            float dg = block.rgb[i][1] - palette[p][1];
+            float db = block.rgb[i][2] - palette[p][2];
+            float error = dr * dr + dg * dg + db * db;
+            if (error < bestError) {
+                bestError = error;
+                best = p;
+            }
+        }
+        indices |= (uint32_t)best << (2 * i);
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+// Концы c0 > c1 включают четырехцветный режим; при c0 < c1 меняем их местами и переставляем индексы
+static void writeBlock(unsigned char* out, uint16_t c0, uint16_t c1, uint32_t indices) {
+    if (c0 < c1) {
+        swap(c0, c1);
+        indices ^= 0x55555555;  // 0 <-> 1, 2 <-> 3
+    }
+    else if (c0 == c1) {
+        indices = 0;
+    }
+    out[0] = (unsigned char)(c0 & 0xFF);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF);
+    out[3] = (unsigned char)(c1 >> 8);
+    memcpy(out + 4, &indices, 4);  // Little-endian, как и весь формат
+}
+
+static void encodeBlockBC1(const BlockColors& block, unsigned char* out) {
+    float mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        for (int k = 0; k < 3; k++) mean[k] += block.rgb[i][k];
+    }
+    for (int k = 0; k < 3; k++) mean[k] /= 16.0f;
+
+    float cov[6] = { 0, 0, 0, 0, 0, 0 };  // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++) {
+        float r = block.rgb[i][0] - mean[0], g = block.rgb[i][1] - mean[1], b = block.rgb[i][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    // Главная ось степенным методом
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = max(max(fabs(x), fabs(y)), fabs(z));
+        if (length < 1e-6f) break;  // Блок почти одноцветный
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+    float axisLength = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (int k = 0; k < 3; k++) axis[k] /= axisLength;
+
+    float minT = 1e30f, maxT = -1e30f;
+    for (int i = 0; i < 16; i++) {
+        float t = (block.rgb[i][0] - mean[0]) * axis[0] + (block.rgb[i][1] - mean[1]) * axis[1]
+            + (block.rgb[i][2] - mean[2]) * axis[2];
+        minT = min(minT, t);
+        maxT = max(maxT, t);
+    }
+    float end0[3], end1[3];
+    for (int k = 0; k < 3; k++) {
+        end0[k] = mean[k] + axis[k] * maxT;
+        end1[k] = mean[k] + axis[k] * minT;
+    }
+
+    uint16_t c0 = packRGB565(end0), c1 = packRGB565(end1);
+    uint32_t indices;
+    float error = assignIndices(block, c0, c1, indices);
+
+    // Уточнение: концы, минимизирующие ошибку при найденных индексах.
+    // Цвет пикселя = a * e0 + b * e1, веса (a, b) по индексу: (1,0) (0,1) (2/3,1/3) (1/3,2/3)
+    static const float weightA[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float aa = 0, ab = 0, bb = 0, ax[3] = { 0, 0, 0 }, bx[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++) {
+        float a = weightA[(indices >> (2 * i)) & 3], b = 1.0f - a;
+        aa += a * a; ab += a * b; bb += b * b;
+        for (int k = 0; k < 3; k++) {
+            ax[k] += a * block.rgb[i][k];
+            bx[k] += b * block.rgb[i][k];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (fabs(det) > 1e-6f) {
+        float refined0[3], refined1[3];
+        for (int k = 0; k < 3; k++) {
+            refined0[k] = (ax[k] * bb - bx[k] * ab) / det;
+            refined1[k] = (bx[k] * aa - ax[k] * ab) / det;
+        }
+        uint16_t r0 = packRGB565(refined0), r1 = packRGB565(refined1);
+        uint32_t refinedIndices;
+        float refinedError = assignIndices(block, r0, r1, refinedIndices);
+        if (refinedError < error) {
+            c0 = r0;
+            c1 = r1;
+            indices = refinedIndices;
+        }
+    }
+
+    writeBlock(out, c0, c1, indices);
+}
+
+// ==================== Сжатие уровней ====================
+static void readTexel(const TextureImage& image, int x, int y, float rgb[3]) {
+    const unsigned char* p = &image.pixels[((size_t)y * image.width + x) * image.channels];
+    if (image.channels >= 3) {
+        rgb[0] = p[0]; rgb[1] = p[1]; rgb[2] = p[2];
+    }
+    else {
+        rgb[0] = rgb[1] = rgb[2] = p[0];
+    }
+}
+
+static void compressLevel(const TextureImage& image, unsigned char* out, ThreadPool& pool) {
+    int blocksX = (image.width + 3) / 4;
+    int blocksY = (image.height + 3) / 4;
+    pool.parallelFor(blocksY, max(1, 1024 / blocksX), [&](int begin, int end) {
+        BlockColors block;
+        for (int by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                // Блоки на краю текстуры меньшего размера дополняются повтором крайних пикселей
+                for (int i = 0; i < 16; i++) {
+                    int x = min(bx * 4 + (i & 3), image.width - 1);
+                    int y = min(by * 4 + (i >> 2), image.height - 1);
+                    readTexel(image, x, y, block.rgb[i]);
+                }
+                encodeBlockBC1(block, out + ((size_t)by * blocksX + bx) * 8);
+            }
+        }
+    });
+}
+
+void compressTextureBC1(const TextureImage& base, const vector<TextureImage>& mips, CompressedTexture& texture,
+    ThreadPool& pool) {
+    texture = CompressedTexture();
+    texture.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    texture.blockBytes = 8;
+
+    // Раскладка уровней известна заранее: блоки пишутся сразу на свои места
+    size_t offset = 0;
+    for (size_t level = 0; level <= mips.size(); level++) {
+        const TextureImage& image = level == 0 ? base : mips[level - 1];
+        size_t size = (size_t)((image.width + 3) / 4) * ((image.height + 3) / 4) * 8;
+        texture.levels.push_back({ image.width, image.height, offset, size });
+        offset += size;
+    }
+    texture.storage.resize(offset);
+
+    for (size_t level = 0; level <= mips.size(); level++) {
+        compressLevel(level == 0 ? base : mips[level - 1], texture.storage.data() + texture.levels[level].offset, pool);
+    }
+}
+
+// ==================== Файл DDS ====================
+struct DDSPixelFormat {
+    uint32_t size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+};
+
+struct DDSHeader {
+    uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+    uint32_t reserved1[11];  // [0] - метка, [1] - версия кэша, [2], [3] - ключ
+    DDSPixelFormat format;
+    uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+static const uint32_t DDS_MAGIC = 0x20534444;   // "DDS "
+static const uint32_t FOURCC_DXT1 = 0x31545844; // "DXT1"
+
+bool saveCompressedTexture(const string& path, uint64_t key, const CompressedTexture& texture) {
+    if (texture.empty() || texture.format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT) {
+        return false;
+    }
+
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;  // CAPS HEIGHT WIDTH PIXELFORMAT MIPMAPCOUNT LINEARSIZE
+    header.width = texture.levels[0].width;
+    header.height = texture.levels[0].height;
+    header.pitchOrLinearSize = (uint32_t)texture.levels[0].size;
+    header.mipMapCount = (uint32_t)texture.levels.size();
+    header.reserved1[0] = CACHE_TAG;
+    header.reserved1[1] = CACHE_VERSION;
+    header.reserved1[2] = (uint32_t)key;
+    header.reserved1[3] = (uint32_t)(key >> 32);
+    header.format.size = sizeof(DDSPixelFormat);
+    header.format.flags = 0x4;  // FOURCC
+    header.format.fourCC = FOURCC_DXT1;
+    header.caps = 0x1000 | 0x8 | 0x400000;  // TEXTURE COMPLEX MIPMAP
+
+    error_code error;
+    filesystem::create_directories(filesystem::path(path).parent_path(), error);
+
+    // Сначала во временный файл: оборванная запись не оставит поврежденный кэш
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary, ios::binary);
+        if (!file) {
+            return false;
+        }
+        file.write((const char*)&DDS_MAGIC, 4);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)texture.blocks(), texture.totalSize());
+        if (!file) {
+            return false;
+        }
+    }
+    filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+bool loadCompressedTexture(const string& path, uint64_t key, CompressedTexture& texture) {
+    shared_ptr<MappedFile> mapping = make_shared<MappedFile>();
+    if (!mapping->open(path.c_str()) || mapping->size() < 4 + sizeof(DDSHeader)) {
+        return false;
+    }
+
+    uint32_t magic;
+    DDSHeader header;
+    memcpy(&magic, mapping->data(), 4);
+    memcpy(&header, mapping->data() + 4, sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || header.format.fourCC != FOURCC_DXT1
+        || header.reserved1[0] != CACHE_TAG || header.reserved1[1] != CACHE_VERSION
+        || header.reserved1[2] != (uint32_t)key || header.reserved1[3] != (uint32_t)(key >> 32)
+        || header.width == 0 || header.height == 0 || header.mipMapCount == 0 || header.mipMapCount > 32) {
+        return false;
+    }
+
+    CompressedTexture result;
+    result.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    result.blockBytes = 8;
+    size_t offset = 0;
+    int w = (int)header.width, h = (int)header.height;
+    for (uint32_t level = 0; level < header.mipMapCount; level++) {
+        size_t size = (size_t)((w + 3) / 4) * ((h + 3) / 4) * 8;
+        result.levels.push_back({ w, h, offset, size });
+        offset += size;
+        w = max(1, w / 2);
+        h = max(1, h / 2);
+    }
+    result.mappedOffset = 4 + sizeof(DDSHeader);
+    if (result.mappedOffset + offset > mapping->size()) {
+        return false;  // Файл обрезан
+    }
+    result.mapping = mapping;
+    texture = move(result);
+    return true;
+}
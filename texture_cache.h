@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "platform.h"
+#include "texture_image.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// ==================== Кэш сжатых текстур ====================
+// При первом запуске изображение сжимается в BC1 (DXT1) вместе с цепочкой мипмапов
+// и записывается в DDS-файл, имя которого содержит хеш источника. При следующих запусках
+// файл отображается в память, и блоки загружаются в OpenGL без декодирования.
+// Строки в кэше идут в порядке OpenGL (снизу вверх) - файлы предназначены только для этой программы.
+
+struct CompressedLevel {
+    int width, height;
+    size_t offset;  // От начала блоков
+    size_t size;
+};
+
+struct CompressedTexture {
+    GLenum format = 0;
+    int blockBytes = 0;  // 8 для BC1
+    std::vector<CompressedLevel> levels;
+
+    // Блоки лежат либо в отображенном файле, либо в storage (только что сжатая текстура)
+    std::shared_ptr<MappedFile> mapping;
+    size_t mappedOffset = 0;
+    std::vector<unsigned char> storage;
+
+    bool empty() const { return levels.empty(); }
+    const unsigned char* blocks() const { return mapping ? mapping->data() + mappedOffset : storage.data(); }
+    size_t totalSize() const { return empty() ? 0 : levels.back().offset + levels.back().size; }
+};
+
+// FNV-1a, 64 бита
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+
+std::string textureCachePath(const std::string& directory, const std::string& name, uint64_t key);
+
+// Сжимает в BC1 изображение и его мипмапы из buildMipChain() (блоки считаются в пуле потоков)
+void compressTextureBC1(const TextureImage& base, const std::vector<TextureImage>& mips, CompressedTexture& texture,
+    ThreadPool& pool);
+
+// Отображает файл кэша в память; false - файла нет, он поврежден или записан для другого ключа
+bool loadCompressedTexture(const std::string& path, uint64_t key, CompressedTexture& texture);
+bool saveCompressedTexture(const std::string& path, uint64_t key, const CompressedTexture& texture);
@@ -0,0 +1,12 @@
+﻿#pragma once
+
+#include <vector>
+
+// Изображение текстуры в памяти. Строки идут снизу вверх (первая строка - t = 0),
+// в том же порядке, в каком их принимает glTexImage2D.
+struct TextureImage {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+};
@@ -0,0 +1,495 @@
+﻿#include "texture_streamer.h"
+#include "render_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+void TextureStreamer::create(int decoderThreads, GLsizeiptr size) {
+    decoders.reset(new ThreadPool(max(1, decoderThreads)));
+    stagingSize = size;
+    compressionSupported = hasGLExtension("GL_EXT_texture_compression_s3tc");
+
+    for (StagingBuffer& staging : ring) {
+        glGenBuffers(1, &staging.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // Заглушка 2x2 - серая шахматка, заметная, но не режущая глаз
+    const unsigned char checker[] = {
+        96, 96, 96,  160, 160, 160,
+        160, 160, 160,  96, 96, 96,
+    };
+    glGenTextures(1, &placeholder);
+    renderState().bindTexture(0, placeholder);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, checker);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    // Та же шахматка для массивов: единственный слой, номер слоя GL ограничивает им
+    glGenTextures(1, &arrayPlaceholder);
+    renderState().bindTextureArray(0, arrayPlaceholder);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, 2, 2, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, checker);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    cout << "Texture streamer: " << decoders->threadCount() - 1 << " decoder threads, "
+        << RING_SIZE << " x " << stagingSize / 1024 << " KB staging"
+        << (compressionSupported ? ", BC1 supported" : "") << endl;
+}
+
+void TextureStreamer::destroy() {
+    if (decoders) {
+        decoders->wait();
+        decoders.reset();
+    }
+    for (unique_ptr<Entry>& entry : entries) {
+        if (entry->texture != 0) {
+            renderState().forgetTexture(entry->texture);
+            glDeleteTextures(1, &entry->texture);
+        }
+    }
+    entries.clear();
+    decodedQueue.clear();
+    uploadQueue.clear();
+    inFlight = 0;
+
+    for (StagingBuffer& staging : ring) {
+        if (staging.fence) {
+            glDeleteSync(staging.fence);
+        }
+        if (staging.buffer != 0) {
+            glDeleteBuffers(1, &staging.buffer);
+        }
+        staging = StagingBuffer();
+    }
+    if (placeholder != 0) {
+        renderState().forgetTexture(placeholder);
+        glDeleteTextures(1, &placeholder);
+        placeholder = 0;
+    }
+    if (arrayPlaceholder != 0) {
+        renderState().forgetTexture(arrayPlaceholder);
+        glDeleteTextures(1, &arrayPlaceholder);
+        arrayPlaceholder = 0;
+    }
+}
+
+int TextureStreamer::request(const char* label, TextureDecoder decode) {
+    int handle = (int)entries.size();
+    entries.emplace_back(new Entry());
+    Entry* entry = entries.back().get();
+    entry->label = label;
+    entry->requestTime = chrono::steady_clock::now();
+    inFlight++;
+
+    // Entry не перемещается (vector хранит указатели), поток декодера пишет только в нее
+    decoders->submit([this, entry, handle, decode] {
+        auto start = chrono::steady_clock::now();
+        entry->decodeOk = decode(entry->decoded);
+        entry->decodeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        lock_guard<mutex> guard(decodedLock);
+        decodedQueue.push_back(handle);
+    });
+    return handle;
+}
+
+int TextureStreamer::createArray(const char* label, int width, int height, int layers) {
+    int handle = (int)entries.size();
+    entries.emplace_back(new Entry());
+    Entry& entry = *entries.back();
+    entry.label = label;
+    entry.isArray = true;
+    entry.width = width;
+    entry.height = height;
+    entry.layers = layers;
+    entry.requestTime = chrono::steady_clock::now();
+    return handle;
+}
+
+int TextureStreamer::requestLayer(int array, int layer, const char* label, TextureDecoder decode) {
+    // Замена слоя: прежний запрос выбрасывается, а уже загруженное содержимое
+    // остается в массиве, пока его не перезапишет новый слой
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i]->array == array && entries[i]->layer == layer) {
+            release((int)i);
+        }
+    }
+    int handle = request(label, move(decode));
+    // Поток декодера эти поля не читает
+    entries[handle]->array = array;
+    entries[handle]->layer = layer;
+    return handle;
+}
+
+void TextureStreamer::release(int handle) {
+    if (handle < 0 || handle >= (int)entries.size() || entries[handle]->released) {
+        return;
+    }
+    Entry& entry = *entries[handle];
+    entry.released = true;
+    if (entry.array >= 0 && entry.state == READY) {
+        entries[entry.array]->layersReady--;
+    }
+    if (entry.isArray) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i]->array == handle) {
+                release((int)i);
+            }
+        }
+        entry.state = RELEASED;
+    }
+    if (entry.texture != 0) {
+        renderState().forgetTexture(entry.texture);
+        glDeleteTextures(1, &entry.texture);
+        entry.texture = 0;
+    }
+    if (entry.state == UPLOADING) {
+        uploadQueue.erase(find(uploadQueue.begin(), uploadQueue.end(), handle));
+        inFlight--;
+    }
+    // Пока идет декодирование, изображение принадлежит потоку декодера
+    if (entry.state != DECODING) {
+        entry.decoded = DecodedTexture();
+        entry.state = RELEASED;
+    }
+}
+
+GLuint TextureStreamer::texture(int handle) const {
+    if (handle < 0 || handle >= (int)entries.size()) {
+        return placeholder;
+    }
+    const Entry& entry = *entries[handle];
+    if (entry.state != READY) {
+        return entry.isArray ? arrayPlaceholder : placeholder;
+    }
+    return entry.texture;
+}
+
+bool TextureStreamer::isReady(int handle) const {
+    return handle >= 0 && handle < (int)entries.size() && entries[handle]->state == READY;
+}
+
+void TextureStreamer::update(double budgetMs) {
+    auto start = chrono::steady_clock::now();
+    frame++;
+
+    // Забираем изображения, которые декодеры успели подготовить
+    vector<int> decoded;
+    {
+        lock_guard<mutex> guard(decodedLock);
+        decoded.swap(decodedQueue);
+    }
+    for (int handle : decoded) {
+        Entry& entry = *entries[handle];
+        if (entry.released || !entry.decodeOk) {
+            if (!entry.released) {
+                cout << "Texture " << entry.label << " failed to decode" << endl;
+            }
+            entry.state = entry.released ? RELEASED : FAILED;
+            entry.decoded = DecodedTexture();
+            inFlight--;
+            continue;
+        }
+        if (entry.array >= 0 && !beginLayer(entry)) {
+            entry.state = FAILED;
+            entry.decoded = DecodedTexture();
+            inFlight--;
+            continue;
+        }
+        entry.state = UPLOADING;
+        uploadQueue.push_back(handle);
+    }
+
+    bool first = true;
+    while (!uploadQueue.empty()) {
+        double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (!first && elapsed >= budgetMs) {
+            break;
+        }
+        first = false;
+
+        Entry& entry = *entries[uploadQueue.front()];
+        if (!uploadBand(entry)) {
+            break;  // Все PBO кольца еще заняты GPU
+        }
+        if (uploadComplete(entry)) {
+            completeUpload(entry);
+            uploadQueue.pop_front();
+        }
+    }
+}
+
+// Следующий буфер кольца, если GPU закончил его читать; nullptr - все буферы заняты
+TextureStreamer::StagingBuffer* TextureStreamer::acquireStaging() {
+    StagingBuffer& staging = ring[nextStaging];
+    if (staging.fence) {
+        // Не ждем: занятый буфер просто откладывает загрузку до следующего кадра
+        GLenum status = glClientWaitSync(staging.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return nullptr;
+        }
+        glDeleteSync(staging.fence);
+        staging.fence = nullptr;
+    }
+    return &staging;
+}
+
+// Копирует bytes байт в буфер кольца; после этого буфер привязан к GL_PIXEL_UNPACK_BUFFER
+void TextureStreamer::fillStaging(StagingBuffer& staging, const unsigned char* source, GLsizeiptr bytes) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+    if (bytes > stagingSize) {
+        // Строка шире буфера кольца: буфер растет под нее
+        stagingSize = bytes;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingSize, nullptr, GL_STREAM_DRAW);
+    }
+    // Буфер свободен (fence пройден), поэтому синхронизация драйвера не нужна
+    void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    memcpy(dst, source, bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+void TextureStreamer::releaseStaging(StagingBuffer& staging) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextStaging = (nextStaging + 1) % RING_SIZE;
+}
+
+bool TextureStreamer::uploadComplete(const Entry& entry) const {
+    const CompressedTexture& compressed = entry.decoded.compressed;
+    if (!compressed.empty()) {
+        return entry.level == (int)compressed.levels.size();
+    }
+    return entry.level == 1 + (int)entry.decoded.mips.size();
+}
+
+// Слой готов к загрузке: первый слой выделяет память массива под свой формат,
+// остальные сверяются с ней. false - слой в массив не подходит
+bool TextureStreamer::beginLayer(Entry& entry) {
+    Entry& array = *entries[entry.array];
+    const DecodedTexture& decoded = entry.decoded;
+    const CompressedTexture& compressed = decoded.compressed;
+    int width = compressed.empty() ? decoded.image.width : compressed.levels[0].width;
+    int height = compressed.empty() ? decoded.image.height : compressed.levels[0].height;
+    int levels = compressed.empty() ? (int)decoded.mips.size() + 1 : (int)compressed.levels.size();
+    GLenum format = compressed.format;
+    if (compressed.empty()) {
+        format = GL_RGB;
+        if (decoded.image.channels == 4) format = GL_RGBA;
+        else if (decoded.image.channels == 1) format = GL_RED;
+    }
+
+    if (width != array.width || height != array.height) {
+        cout << "Texture " << entry.label << " is " << width << "x" << height << ", array " << array.label
+            << " needs " << array.width << "x" << array.height << endl;
+        return false;
+    }
+    if (array.texture != 0) {
+        if (format != array.format || levels != array.levels) {
+            cout << "Texture " << entry.label << " format or mip chain differs from array " << array.label << endl;
+            return false;
+        }
+        entry.firstUploadFrame = frame;
+        return true;
+    }
+
+    array.format = format;
+    array.levels = levels;
+    glGenTextures(1, &array.texture);
+    renderState().bindTextureArray(0, array.texture);
+    // Память под все уровни всех слоев сразу, слои приходят полосами
+    for (int level = 0; level < levels; level++) {
+        int levelWidth = max(1, width >> level);
+        int levelHeight = max(1, height >> level);
+        if (!compressed.empty()) {
+            GLsizei size = (GLsizei)compressed.levels[level].size * array.layers;
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, array.layers, 0,
+                size, nullptr);
+        }
+        else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, format, levelWidth, levelHeight, array.layers, 0, format,
+                GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels == 1 ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    entry.firstUploadFrame = frame;
+    return true;
+}
+
+void TextureStreamer::bindUploadTexture(const Entry& entry) {
+    if (entry.array >= 0) {
+        renderState().bindTextureArray(0, entries[entry.array]->texture);
+    }
+    else {
+        renderState().bindTexture(0, entry.texture);
+    }
+}
+
+// Копирует очередную полосу строк через PBO; false - свободного буфера в кольце нет
+bool TextureStreamer::uploadBand(Entry& entry) {
+    if (!entry.decoded.compressed.empty()) {
+        return uploadCompressedBand(entry);
+    }
+
+    StagingBuffer* staging = acquireStaging();
+    if (!staging) {
+        return false;
+    }
+
+    const DecodedTexture& decoded = entry.decoded;
+    GLenum format = GL_RGB;
+    if (decoded.image.channels == 4) format = GL_RGBA;
+    else if (decoded.image.channels == 1) format = GL_RED;
+
+    if (entry.array < 0 && entry.texture == 0) {
+        glGenTextures(1, &entry.texture);
+        renderState().bindTexture(0, entry.texture);
+        // Память под все уровни сразу, содержимое приходит полосами
+        for (int level = 0; level <= (int)decoded.mips.size(); level++) {
+            const TextureImage& image = level == 0 ? decoded.image : decoded.mips[level - 1];
+            glTexImage2D(GL_TEXTURE_2D, level, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)decoded.mips.size());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, decoded.mips.empty() ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        entry.firstUploadFrame = frame;
+    }
+
+    // Уровни по очереди: базовое изображение, затем мипмапы
+    const TextureImage& image = entry.level == 0 ? decoded.image : decoded.mips[entry.level - 1];
+    size_t rowBytes = (size_t)image.width * image.channels;
+    int rows = (int)max<GLsizeiptr>(1, stagingSize / (GLsizeiptr)rowBytes);
+    rows = min(rows, image.height - entry.rowsUploaded);
+    fillStaging(*staging, image.pixels.data() + rowBytes * entry.rowsUploaded, (GLsizeiptr)(rowBytes * rows));
+
+    bindUploadTexture(entry);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (entry.array >= 0) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, entry.level, 0, entry.rowsUploaded, entry.layer, image.width, rows, 1,
+            format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, entry.level, 0, entry.rowsUploaded, image.width, rows, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    releaseStaging(*staging);
+
+    entry.rowsUploaded += rows;
+    if (entry.rowsUploaded == image.height) {
+        entry.level++;
+        entry.rowsUploaded = 0;
+    }
+    return true;
+}
+
+// Сжатая текстура: так же по уровням, но внутри уровня - полосами по строкам блоков 4x4.
+// rowsUploaded здесь считает строки блоков текущего уровня
+bool TextureStreamer::uploadCompressedBand(Entry& entry) {
+    StagingBuffer* staging = acquireStaging();
+    if (!staging) {
+        return false;
+    }
+
+    const CompressedTexture& compressed = entry.decoded.compressed;
+    if (entry.array < 0 && entry.texture == 0) {
+        glGenTextures(1, &entry.texture);
+        renderState().bindTexture(0, entry.texture);
+        // Память под все уровни сразу, содержимое приходит полосами
+        for (size_t level = 0; level < compressed.levels.size(); level++) {
+            const CompressedLevel& info = compressed.levels[level];
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, compressed.format, info.width, info.height, 0,
+                (GLsizei)info.size, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)compressed.levels.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        entry.firstUploadFrame = frame;
+    }
+
+    const CompressedLevel& info = compressed.levels[entry.level];
+    size_t blockRowBytes = (size_t)((info.width + 3) / 4) * compressed.blockBytes;
+    int blockRows = (info.height + 3) / 4;
+    int band = (int)max<GLsizeiptr>(1, stagingSize / (GLsizeiptr)blockRowBytes);
+    band = min(band, blockRows - entry.rowsUploaded);
+    GLsizeiptr bandBytes = (GLsizeiptr)(blockRowBytes * band);
+    fillStaging(*staging, compressed.blocks() + info.offset + blockRowBytes * entry.rowsUploaded, bandBytes);
+
+    int y = entry.rowsUploaded * 4;
+    bindUploadTexture(entry);
+    if (entry.array >= 0) {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, entry.level, 0, y, entry.layer, info.width,
+            min(band * 4, info.height - y), 1, compressed.format, (GLsizei)bandBytes, nullptr);
+    }
+    else {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, entry.level, 0, y, info.width, min(band * 4, info.height - y),
+            compressed.format, (GLsizei)bandBytes, nullptr);
+    }
+    releaseStaging(*staging);
+
+    entry.rowsUploaded += band;
+    if (entry.rowsUploaded == blockRows) {
+        entry.level++;
+        entry.rowsUploaded = 0;
+    }
+    return true;
+}
+
+void TextureStreamer::completeUpload(Entry& entry) {
+    const CompressedTexture& compressed = entry.decoded.compressed;
+    entry.state = READY;
+    inFlight--;
+
+    double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - entry.requestTime).count();
+    cout << "Texture " << entry.label << " ready: ";
+    if (!compressed.empty()) {
+        // Для сравнения - та же цепочка мипмапов в RGB8
+        size_t uncompressed = 0;
+        for (const CompressedLevel& level : compressed.levels) {
+            uncompressed += (size_t)level.width * level.height * 3;
+        }
+        cout << compressed.levels[0].width << "x" << compressed.levels[0].height << " BC1, "
+            << compressed.levels.size() << " levels, " << compressed.totalSize() / 1024 << " KB (RGB8: "
+            << uncompressed / 1024 << " KB)";
+    }
+    else {
+        cout << entry.decoded.image.width << "x" << entry.decoded.image.height << ", "
+            << entry.decoded.mips.size() + 1 << " levels";
+    }
+    cout << ", decode " << entry.decodeMs << " ms, upload over " << frame - entry.firstUploadFrame + 1
+        << " frames, " << totalMs << " ms after request" << endl;
+    entry.decoded = DecodedTexture();  // Копия в памяти больше не нужна
+
+    if (entry.array >= 0) {
+        Entry& array = *entries[entry.array];
+        if (++array.layersReady == array.layers) {
+            array.state = READY;
+            cout << "Texture array " << array.label << " ready: " << array.layers << " layers "
+                << array.width << "x" << array.height << ", " << array.levels << " levels" << endl;
+        }
+    }
+}
+
+void TextureStreamer::finish() {
+    while (!idle()) {
+        decoders->wait();
+        update(1e9);
+    }
+}
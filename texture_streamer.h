@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include "platform.h"
+#include "texture_image.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ==================== Асинхронная загрузка текстур ====================
+// Декодирование (файл или процедурная генерация) идет в отдельном пуле потоков.
+// Готовые изображения копируются на потоке OpenGL через кольцо PBO полосами строк,
+// не дольше заданного бюджета за кадр. Пока текстура не загружена целиком,
+// texture() возвращает текстуру-заглушку.
+// Массив текстур (GL_TEXTURE_2D_ARRAY) грузится так же, послойно: каждый слой - отдельный
+// запрос со своим декодером. Память массива выделяется по первому готовому слою, остальные
+// должны совпасть с ним размером, форматом и числом мипмапов. Массив готов, когда готовы все слои.
+
+// Результат декодирования: изображение и его мипмапы (см. mip_builder.h),
+// либо готовые сжатые блоки со своими мипмапами (тогда image пустое)
+struct DecodedTexture {
+    TextureImage image;
+    std::vector<TextureImage> mips;
+    CompressedTexture compressed;
+};
+
+// Вызывается в потоке декодера; false - изображение получить не удалось
+typedef std::function<bool(DecodedTexture& decoded)> TextureDecoder;
+
+class TextureStreamer {
+public:
+    static const int RING_SIZE = 3;
+
+    // decoderThreads - потоки декодирования, stagingSize - размер одного PBO кольца
+    void create(int decoderThreads, GLsizeiptr stagingSize);
+    void destroy();
+
+    // Ставит текстуру в очередь; возвращает дескриптор для texture()/isReady()/release()
+    int request(const char* label, TextureDecoder decode);
+    // Удаляет текстуру; если она еще грузится, результат будет выброшен.
+    // Массив удаляется вместе со слоями
+    void release(int handle);
+
+    // Массив из layers слоев width x height; возвращает дескриптор для texture()/isReady()/release()
+    int createArray(const char* label, int width, int height, int layers);
+    // Ставит в очередь слой массива; decode должен вернуть изображение размера массива.
+    // Повторный запрос того же слоя заменяет его: до загрузки нового виден прежний
+    int requestLayer(int array, int layer, const char* label, TextureDecoder decode);
+
+    GLuint texture(int handle) const;
+    bool isReady(int handle) const;
+    // Есть ли GL_EXT_texture_compression_s3tc (известно после create(), можно спрашивать из декодеров)
+    bool supportsCompression() const { return compressionSupported; }
+    // Нет ни декодируемых, ни загружаемых текстур
+    bool idle() const { return inFlight == 0; }
+
+    // Раз в кадр на потоке OpenGL: копирует готовые изображения, пока не истечет budgetMs.
+    // За кадр всегда загружается хотя бы одна полоса, чтобы загрузка не стояла на месте
+    void update(double budgetMs);
+    // Дожидается всех текстур (запуск без окна, где кадры должны быть воспроизводимы)
+    void finish();
+
+private:
+    enum State { DECODING, UPLOADING, READY, FAILED, RELEASED };
+
+    struct Entry {
+        std::string label;
+        State state = DECODING;
+        // Массив: размер слоя, число слоев и сколько из них загружено
+        bool isArray = false;
+        int width = 0, height = 0, layers = 0;
+        int layersReady = 0;
+        int levels = 0;
+        GLenum format = 0;  // Внутренний формат: задается первым слоем
+        // Слой массива: дескриптор массива (-1 - обычная текстура) и номер слоя
+        int array = -1;
+        int layer = 0;
+        bool released = false;  // release() во время декодирования: результат выбрасывается
+        GLuint texture = 0;
+        DecodedTexture decoded;
+        bool decodeOk = false;
+        int rowsUploaded = 0;
+        int level = 0;  // Загружаемый уровень мипмапа
+        int firstUploadFrame = 0;
+        std::chrono::steady_clock::time_point requestTime;
+        double decodeMs = 0.0;
+    };
+
+    struct StagingBuffer {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+
+    StagingBuffer* acquireStaging();
+    void fillStaging(StagingBuffer& staging, const unsigned char* source, GLsizeiptr bytes);
+    void releaseStaging(StagingBuffer& staging);
+
+    bool beginLayer(Entry& entry);
+    void bindUploadTexture(const Entry& entry);
+    bool uploadBand(Entry& entry);
+    bool uploadCompressedBand(Entry& entry);
+    bool uploadComplete(const Entry& entry) const;
+    void completeUpload(Entry& entry);
+
+    std::unique_ptr<ThreadPool> decoders;
+    std::vector<std::unique_ptr<Entry>> entries;
+
+    std::mutex decodedLock;
+    std::vector<int> decodedQueue;  // Заполняется потоками декодера
+    std::deque<int> uploadQueue;    // Только поток OpenGL
+
+    StagingBuffer ring[RING_SIZE];
+    GLsizeiptr stagingSize = 0;
+    int nextStaging = 0;
+    GLuint placeholder = 0;
+    GLuint arrayPlaceholder = 0;
+    bool compressionSupported = false;
+    int inFlight = 0;
+    int frame = 0;
+};
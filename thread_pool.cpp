@@ -0,0 +1,141 @@
+﻿#include "thread_pool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(int workerCount) {
+    // Очередь с индексом workerCount принадлежит внешним потокам
+    for (int i = 0; i <= workerCount; i++) {
+        queues.push_back(make_unique<WorkQueue>());
+    }
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::push(int queueIndex, function<void()> task) {
+    {
+        lock_guard<mutex> guard(queues[queueIndex]->lock);
+        queues[queueIndex]->tasks.push_back(move(task));
+    }
+    queued++;
+    // Пустой захват мьютекса исключает потерю пробуждения между проверкой и ожиданием
+    { lock_guard<mutex> guard(sleepLock); }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::tryRunTask(int selfIndex) {
+    function<void()> task;
+    int queueCount = (int)queues.size();
+
+    // Своя очередь - с конца (самые "горячие" данные в кэше)
+    if (selfIndex >= 0) {
+        WorkQueue& own = *queues[selfIndex];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+
+    // Чужие очереди - с начала
+    for (int i = 1; !task && i <= queueCount; i++) {
+        WorkQueue& victim = *queues[(max(selfIndex, 0) + i) % queueCount];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+    queued--;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(int index) {
+    for (;;) {
+        if (tryRunTask(index)) {
+            continue;
+        }
+        unique_lock<mutex> guard(sleepLock);
+        wakeUp.wait(guard, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::submit(function<void()> task) {
+    pending++;
+    int queueIndex = (int)(nextQueue++ % queues.size());
+    push(queueIndex, [this, task = move(task)] {
+        task();
+        if (--pending == 0) {
+            lock_guard<mutex> guard(sleepLock);
+            allDone.notify_all();
+        }
+    });
+}
+
+void ThreadPool::wait() {
+    while (pending.load() > 0) {
+        if (tryRunTask(-1)) {
+            continue;
+        }
+        unique_lock<mutex> guard(sleepLock);
+        allDone.wait(guard, [this] { return pending.load() == 0 || queued.load() > 0; });
+    }
+}
+
+void ThreadPool::parallelFor(int count, int grain, const function<void(int begin, int end)>& body) {
+    if (count <= 0) {
+        return;
+    }
+    grain = max(grain, 1);
+    int chunkCount = (count + grain - 1) / grain;
+    if (workers.empty() || chunkCount == 1) {
+        body(0, count);
+        return;
+    }
+
+    // Диапазоны раскладываются по очередям потоков подряд,
+    // соседние диапазоны попадают в один поток, остальное добирается перехватом
+    atomic<int> remaining{ chunkCount };
+    int queueCount = (int)workers.size();
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        int begin = chunk * grain;
+        int end = min(begin + grain, count);
+        push((int)((long long)chunk * queueCount / chunkCount), [&body, &remaining, begin, end] {
+            body(begin, end);
+            remaining--;
+        });
+    }
+
+    while (remaining.load() > 0) {
+        if (!tryRunTask(-1)) {
+            this_thread::yield();
+        }
+    }
+}
+
+ThreadPool& sharedThreadPool() {
+    static ThreadPool pool(max(1, (int)thread::hardware_concurrency() - 1));
+    return pool;
+}
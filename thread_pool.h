@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ==================== Пул потоков с перехватом задач ====================
+// У каждого рабочего потока своя очередь: он берет задачи с ее конца,
+// а простаивающие потоки забирают задачи с начала чужих очередей.
+// Поток, вызвавший parallelFor()/wait(), тоже выполняет задачи.
+class ThreadPool {
+public:
+    // workerCount = 0 - все вычисления идут в вызывающем потоке
+    explicit ThreadPool(int workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Число потоков, участвующих в parallelFor (рабочие + вызывающий)
+    int threadCount() const { return (int)workers.size() + 1; }
+
+    // Асинхронная задача; дождаться ее можно через wait()
+    void submit(std::function<void()> task);
+    void wait();
+
+    // Вызывает body(begin, end) для диапазонов [0, count) длиной не больше grain
+    // и возвращается, когда все диапазоны обработаны
+    void parallelFor(int count, int grain, const std::function<void(int begin, int end)>& body);
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool tryRunTask(int selfIndex);
+    void push(int queueIndex, std::function<void()> task);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<int> queued{ 0 };   // Задачи, лежащие в очередях
+    std::atomic<int> pending{ 0 };  // Задачи submit(), еще не завершенные
+    std::atomic<unsigned> nextQueue{ 0 };
+
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::condition_variable allDone;
+    bool stopping = false;
+};
+
+// Общий пул на все ядра машины (создается при первом обращении)
+ThreadPool& sharedThreadPool();
@@ -0,0 +1,116 @@
+﻿#include "vertex_format.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+const char* vertexFormatName(VertexFormat format) {
+    switch (format) {
+    case VERTEX_FLOAT_COLOR: return "float pos+color";
+    case VERTEX_FLOAT_COLOR_UV: return "float pos+color+uv";
+    case VERTEX_PACKED_COLOR: return "snorm16 pos + rgba8 color";
+    case VERTEX_PACKED_COLOR_UV: return "snorm16 pos + rgba8 color + unorm16 uv";
+    default: return "unknown";
+    }
+}
+
+// Исходные массивы - 6 или 8 float на вершину, float-форматы копируют их как есть
+static_assert(FloatColorLayout::stride == 6 * sizeof(float), "float layout must match the source arrays");
+static_assert(FloatColorUVLayout::stride == 8 * sizeof(float), "float layout must match the source arrays");
+
+static constexpr VertexLayoutInfo formatLayouts[VERTEX_FORMAT_COUNT] = {
+    FloatColorLayout::info(),
+    FloatColorUVLayout::info(),
+    PackedColorLayout::info(),
+    PackedColorUVLayout::info(),
+};
+
+const VertexLayoutInfo& vertexLayout(VertexFormat format) {
+    return formatLayouts[format];
+}
+
+size_t unpackedMeshSize(int vertexCount, int floatsPerVertex, int indexCount) {
+    return (size_t)vertexCount * floatsPerVertex * sizeof(float) + (size_t)indexCount * sizeof(uint32_t);
+}
+
+static void packIndices(const unsigned int* indices, int indexCount, int vertexCount, PackedMesh& mesh) {
+    mesh.indexCount = indexCount;
+    mesh.indexType = vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    mesh.indices.resize((size_t)indexCount * mesh.indexSize());
+    if (mesh.indexType == GL_UNSIGNED_SHORT) {
+        uint16_t* out = (uint16_t*)mesh.indices.data();
+        for (int i = 0; i < indexCount; i++) {
+            out[i] = (uint16_t)indices[i];
+        }
+    }
+    else {
+        memcpy(mesh.indices.data(), indices, mesh.indices.size());
+    }
+}
+
+void packMesh(const float* vertices, int vertexCount, int floatsPerVertex,
+    const unsigned int* indices, int indexCount, bool quantize, PackedMesh& mesh) {
+    bool hasUV = floatsPerVertex >= 8;
+    mesh.vertexCount = vertexCount;
+    mesh.dequantize = Mat4::identity();
+    packIndices(indices, indexCount, vertexCount, mesh);
+
+    // Габариты позиций и проверка UV
+    float lower[3] = { 0.0f, 0.0f, 0.0f }, upper[3] = { 0.0f, 0.0f, 0.0f };
+    bool uvFits = true;
+    for (int v = 0; v < vertexCount; v++) {
+        const float* vertex = vertices + (size_t)v * floatsPerVertex;
+        for (int axis = 0; axis < 3; axis++) {
+            lower[axis] = v == 0 ? vertex[axis] : min(lower[axis], vertex[axis]);
+            upper[axis] = v == 0 ? vertex[axis] : max(upper[axis], vertex[axis]);
+        }
+        if (hasUV) {
+            uvFits = uvFits && vertex[6] >= 0.0f && vertex[6] <= 1.0f && vertex[7] >= 0.0f && vertex[7] <= 1.0f;
+        }
+    }
+
+    if (!quantize || !uvFits) {
+        mesh.format = hasUV ? VERTEX_FLOAT_COLOR_UV : VERTEX_FLOAT_COLOR;
+        mesh.vertices.resize((size_t)vertexCount * vertexStride(mesh.format));
+        for (int v = 0; v < vertexCount; v++) {
+            memcpy(&mesh.vertices[(size_t)v * vertexStride(mesh.format)], vertices + (size_t)v * floatsPerVertex,
+                vertexStride(mesh.format));
+        }
+        return;
+    }
+
+    // Позиция в SNORM16 относительно центра габаритов, по каждой оси своя полуширина
+    float center[3], extent[3], inverseExtent[3];
+    for (int axis = 0; axis < 3; axis++) {
+        center[axis] = 0.5f * (lower[axis] + upper[axis]);
+        extent[axis] = max(0.5f * (upper[axis] - lower[axis]), 1e-20f);
+        inverseExtent[axis] = 1.0f / extent[axis];
+    }
+    mesh.dequantize = Mat4::translation(center[0], center[1], center[2])
+        * Mat4::scale(extent[0], extent[1], extent[2]);
+
+    static_assert(PackedColorLayout::offsetOf<ColorRGBA8>() == PackedColorUVLayout::offsetOf<ColorRGBA8>(),
+        "packed layouts must share the position and color offsets");
+    mesh.format = hasUV ? VERTEX_PACKED_COLOR_UV : VERTEX_PACKED_COLOR;
+    int stride = vertexStride(mesh.format);
+    mesh.vertices.resize((size_t)vertexCount * stride);
+    for (int v = 0; v < vertexCount; v++) {
+        const float* vertex = vertices + (size_t)v * floatsPerVertex;
+        unsigned char* out = &mesh.vertices[(size_t)v * stride];
+
+        // Смещения одинаковы в обеих упакованных раскладках: UV просто дописаны в конец
+        int16_t position[4] = { 0, 0, 0, 0 };
+        for (int axis = 0; axis < 3; axis++) {
+            position[axis] = toSnorm16((vertex[axis] - center[axis]) * inverseExtent[axis]);
+        }
+        uint8_t color[4] = { toUnorm8(vertex[3]), toUnorm8(vertex[4]), toUnorm8(vertex[5]), 255 };
+        memcpy(out + PackedColorUVLayout::offsetOf<PosSnorm16>(), position, sizeof(position));
+        memcpy(out + PackedColorUVLayout::offsetOf<ColorRGBA8>(), color, sizeof(color));
+        if (hasUV) {
+            uint16_t uv[2] = { toUnorm16(vertex[6]), toUnorm16(vertex[7]) };
+            memcpy(out + PackedColorUVLayout::offsetOf<UVUnorm16>(), uv, sizeof(uv));
+        }
+    }
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "platform.h"
+#include "math3d.h"
+#include "vertex_layout.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ==================== Форматы вершин ====================
+// Исходные меши - массивы float (6 на вершину: позиция + цвет, 8: еще и UV) с 32-битными индексами.
+// Перед загрузкой они упаковываются: позиция - SNORM16 относительно габаритов меша,
+// цвет - RGBA8, UV - UNORM16, индексы - 16 бит, если вершин не больше 65536.
+// Обратное преобразование позиций (PackedMesh::dequantize) умножается на матрицу модели.
+
+enum VertexFormat {
+    VERTEX_FLOAT_COLOR,      // float3 позиция, float3 цвет - 24 байта
+    VERTEX_FLOAT_COLOR_UV,   // + float2 UV - 32 байта
+    VERTEX_PACKED_COLOR,     // short4 позиция (SNORM16), ubyte4 цвет (RGBA8) - 12 байт
+    VERTEX_PACKED_COLOR_UV,  // + ushort2 UV (UNORM16) - 16 байт
+    VERTEX_FORMAT_COUNT
+};
+
+using FloatColorLayout = Layout<Pos3f, Color3f>;
+using FloatColorUVLayout = Layout<Pos3f, Color3f, UV2f>;
+using PackedColorLayout = Layout<PosSnorm16, ColorRGBA8>;
+using PackedColorUVLayout = Layout<PosSnorm16, ColorRGBA8, UVUnorm16>;
+
+const char* vertexFormatName(VertexFormat format);
+const VertexLayoutInfo& vertexLayout(VertexFormat format);
+inline int vertexStride(VertexFormat format) { return vertexLayout(format).stride; }
+
+struct PackedMesh {
+    VertexFormat format = VERTEX_FLOAT_COLOR;
+    int vertexCount = 0;
+    int indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    std::vector<unsigned char> vertices;
+    std::vector<unsigned char> indices;
+
+    // Из координат SNORM16 в координаты меша (для float-форматов - единичная)
+    Mat4 dequantize = Mat4::identity();
+
+    int indexSize() const { return indexType == GL_UNSIGNED_SHORT ? 2 : 4; }
+    size_t size() const { return vertices.size() + indices.size(); }
+};
+
+// Квантование одного значения; округление к ближайшему без вызова lrintf (с errno он не встраивается)
+inline int16_t toSnorm16(float value) {
+    float scaled = std::min(std::max(value, -1.0f), 1.0f) * 32767.0f;
+    return (int16_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+}
+
+inline uint8_t toUnorm8(float value) {
+    return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+inline uint16_t toUnorm16(float value) {
+    return (uint16_t)(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f);
+}
+
+// Упаковывает меш; quantize = false - вершины остаются float (индексы все равно сжимаются).
+// UV вне [0, 1] не помещаются в UNORM16 - такой меш тоже остается float
+void packMesh(const float* vertices, int vertexCount, int floatsPerVertex,
+    const unsigned int* indices, int indexCount, bool quantize, PackedMesh& mesh);
+
+// Размер того же меша без упаковки: float-вершины и 32-битные индексы
+size_t unpackedMeshSize(int vertexCount, int floatsPerVertex, int indexCount);
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include "platform.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// ==================== Раскладки вершин ====================
+// Раскладка описывается списком атрибутов: Layout<Pos3f, Color3f, UV2f>. Размер вершины и смещения
+// атрибутов считаются при компиляции, а настройка VAO строится по ним же, без ручных
+// glVertexAttribPointer с магическими числами. Вершины могут лежать в буфере вперемешку
+// (interleaved, одна вершина - stride байт) или потоками (SoA: сначала все позиции, затем все цвета...).
+
+// Атрибут: положение в шейдере, число компонент, тип GL и размер в буфере (с выравниванием до 4 байт)
+template <GLuint Location, GLint Components, GLenum Type, GLboolean Normalized, int Size>
+struct VertexAttribute {
+    static constexpr GLuint location = Location;
+    static constexpr GLint components = Components;
+    static constexpr GLenum type = Type;
+    static constexpr GLboolean normalized = Normalized;
+    static constexpr int size = Size;
+};
+
+// Атрибуты шейдеров сцены: 0 - позиция, 1 - цвет, 2 - текстурные координаты
+using Pos3f = VertexAttribute<0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float)>;
+using Color3f = VertexAttribute<1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float)>;
+using UV2f = VertexAttribute<2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float)>;
+using PosSnorm16 = VertexAttribute<0, 3, GL_SHORT, GL_TRUE, 4 * sizeof(int16_t)>;  // Четвертый short - выравнивание
+using ColorRGBA8 = VertexAttribute<1, 3, GL_UNSIGNED_BYTE, GL_TRUE, 4>;
+using UVUnorm16 = VertexAttribute<2, 2, GL_UNSIGNED_SHORT, GL_TRUE, 2 * sizeof(uint16_t)>;
+
+const int MAX_VERTEX_ATTRIBUTES = 4;
+
+// То же описание во время выполнения - для пулов арены, формат которых известен только при загрузке
+struct VertexAttributeInfo {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    int size;
+    int offset;  // Внутри вершины при interleaved
+};
+
+struct VertexLayoutInfo {
+    int attributeCount;
+    int stride;
+    VertexAttributeInfo attributes[MAX_VERTEX_ATTRIBUTES];
+};
+
+enum VertexStreams {
+    STREAMS_INTERLEAVED,
+    STREAMS_SOA
+};
+
+template <typename... Attributes>
+struct Layout {
+    static_assert(sizeof...(Attributes) <= MAX_VERTEX_ATTRIBUTES, "too many vertex attributes");
+
+    static constexpr int attributeCount = sizeof...(Attributes);
+    static constexpr int stride = (0 + ... + Attributes::size);
+
+    static constexpr VertexLayoutInfo info() {
+        VertexLayoutInfo layout = {};
+        layout.attributeCount = attributeCount;
+        layout.stride = stride;
+        int index = 0, offset = 0;
+        ((layout.attributes[index++] = { Attributes::location, Attributes::components, Attributes::type,
+            Attributes::normalized, Attributes::size, offset }, offset += Attributes::size), ...);
+        return layout;
+    }
+
+    // Смещение атрибута внутри interleaved-вершины
+    template <typename Attribute>
+    static constexpr int offsetOf() {
+        constexpr VertexLayoutInfo layout = info();
+        for (int i = 0; i < layout.attributeCount; i++) {
+            if (layout.attributes[i].location == Attribute::location) {
+                return layout.attributes[i].offset;
+            }
+        }
+        return -1;
+    }
+};
+
+// Начало данных атрибута index в буфере на vertexCapacity вершин
+inline size_t vertexStreamOffset(const VertexLayoutInfo& layout, int index, VertexStreams streams,
+    size_t vertexCapacity) {
+    if (streams == STREAMS_INTERLEAVED) {
+        return layout.attributes[index].offset;
+    }
+    size_t offset = 0;
+    for (int i = 0; i < index; i++) {
+        offset += layout.attributes[i].size * vertexCapacity;
+    }
+    return offset;
+}
+
+// Атрибуты раскладки для привязанного GL_ARRAY_BUFFER (при SoA буфер рассчитан на vertexCapacity вершин)
+inline void setVertexAttributes(const VertexLayoutInfo& layout, VertexStreams streams, size_t vertexCapacity) {
+    for (int i = 0; i < layout.attributeCount; i++) {
+        const VertexAttributeInfo& attribute = layout.attributes[i];
+        GLsizei stride = streams == STREAMS_INTERLEAVED ? layout.stride : attribute.size;
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, stride,
+            (void*)vertexStreamOffset(layout, i, streams, vertexCapacity));
+        glEnableVertexAttribArray(attribute.location);
+    }
+}